@@ -0,0 +1,22 @@
+# -------------------------------------------------
+# TestCase storage benchmark
+# -------------------------------------------------
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+
+TARGET = casebench
+
+INCLUDEPATH += ../../common/
+
+SOURCES += main.cpp \
+           ../../common/datamodel.cpp \
+           ../../common/stringpool.cpp \
+           ../../common/uuid.cpp
+
+HEADERS += ../../common/datamodel.h \
+           ../../common/stringpool.h \
+           ../../common/uuid.h
+
+LIBS += -lboost_thread -lboost_system -lboost_serialization
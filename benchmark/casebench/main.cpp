@@ -0,0 +1,225 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+///
+/// TestCase storage benchmark
+///
+/// Builds a test case of recorded-like items, iterates over it as the
+/// playback does and looks every item up by uuid. The arena backed
+/// TestCase is compared with the previous layout (a ptr_list of items
+/// and a std::map index). The heap in use is measured with mallinfo2
+/// where available.
+///
+/// usage: casebench [items] [passes]
+///
+
+#include <datamodel.h>
+
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/ptr_container/ptr_list.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#endif
+
+using namespace DataModel;
+
+typedef std::chrono::steady_clock Clock;
+
+static const FieldKey widget = fieldKey("widget");
+static const FieldKey x = fieldKey("x");
+static const FieldKey y = fieldKey("y");
+static const FieldKey button = fieldKey("button");
+static const FieldKey modifiers = fieldKey("modifiers");
+
+static size_t heapInUse()
+{
+#ifdef HAVE_MALLINFO2
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+static TestItem* makeItem(int i)
+{
+    const char* widgets[] = {
+        "MainWindow/centralWidget/tabWidget/qt_tabwidget_stackedwidget/tab/pushButton",
+        "MainWindow/centralWidget/lineEdit",
+        "MainWindow/menuBar/menuFile/actionOpen",
+        "QFileDialog/listView/qt_scrollarea_viewport"
+    };
+
+    TestItem* ti = new TestItem(i % 2 ? 12 : 11, 0, i % 1000);
+    ti->setString(widget, widgets[i % 4]);
+    ti->setInt(x, (i * 13) % 800);
+    ti->setInt(y, (i * 7) % 600);
+    ti->setInt(button, 1);
+    ti->setInt(modifiers, 0);
+    return ti;
+}
+
+static double ms(Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static void report(const char* layout, size_t bytes, Clock::duration build,
+                   Clock::duration iterate, Clock::duration lookup, long long check)
+{
+    std::printf("%-10s %12.1f %10.2f %10.2f %10.2f   (%lld)\n", layout,
+                double(bytes) / (1024 * 1024), ms(build), ms(iterate), ms(lookup), check);
+}
+
+///
+/// previous layout
+///
+static void benchPtrList(size_t count, int passes)
+{
+    size_t heap0 = heapInUse();
+    Clock::time_point t0 = Clock::now();
+    boost::ptr_list<TestItem> items;
+    std::map<uuid_t, TestItem*> index;
+    std::vector<uuid_t> ids;
+    for (size_t i = 0; i < count; i++)
+    {
+        TestItem* ti = makeItem(i);
+        items.push_back(ti);
+        index.insert(std::make_pair(ti->uuid(), ti));
+        ids.push_back(ti->uuid());
+    }
+    Clock::duration build = Clock::now() - t0;
+    size_t bytes = heapInUse() - heap0;
+
+    long long sum = 0;
+    t0 = Clock::now();
+    for (int p = 0; p < passes; p++)
+        for (boost::ptr_list<TestItem>::const_iterator it = items.begin(); it != items.end(); ++it)
+            sum += it->getInt(x) + it->type();
+    Clock::duration iterate = Clock::now() - t0;
+
+    t0 = Clock::now();
+    for (size_t i = 0; i < ids.size(); i++)
+        sum += index.find(ids[i])->second->timestamp();
+    Clock::duration lookup = Clock::now() - t0;
+
+    report("ptr_list", bytes, build, iterate, lookup, sum);
+}
+
+///
+/// arena backed test case
+///
+static bool benchTestCase(size_t count, int passes)
+{
+    size_t heap0 = heapInUse();
+    Clock::time_point t0 = Clock::now();
+    TestCase* tc = new TestCase();
+    std::vector<uuid_t> ids;
+    for (size_t i = 0; i < count; i++)
+    {
+        TestItem* ti = makeItem(i);
+        ids.push_back(ti->uuid());
+        tc->addTestItem(ti);
+    }
+    Clock::duration build = Clock::now() - t0;
+    size_t bytes = heapInUse() - heap0;
+
+    long long sum = 0;
+    const TestCase::TestItemList& il = tc->testItemList();
+    t0 = Clock::now();
+    for (int p = 0; p < passes; p++)
+        for (TestCase::TestItemList::const_iterator it = il.begin(); it != il.end(); ++it)
+            sum += it->getInt(x) + it->type();
+    Clock::duration iterate = Clock::now() - t0;
+
+    t0 = Clock::now();
+    for (size_t i = 0; i < ids.size(); i++)
+        sum += tc->testItem(ids[i])->timestamp();
+    Clock::duration lookup = Clock::now() - t0;
+
+    report("arena", bytes, build, iterate, lookup, sum);
+
+    // checks: order, copy and erase, and the archive round trip
+    bool ok = tc->count() == count;
+    size_t n = 0;
+    for (TestCase::TestItemList::const_iterator it = il.begin(); ok && it != il.end(); ++it)
+        ok = it->uuid() == ids[n++];
+
+    TestItemList copy(il);
+    if (ok && count > 2)
+    {
+        TestItemList::iterator second = ++copy.begin();
+        const TestItem* third = &*++TestItemList::iterator(second);
+        copy.erase(second);
+        ok = copy.size() == count - 1 && &*++copy.begin() == third &&
+                third->uuid() == ids[2];
+        // the released slot is reused
+        copy.push_back(*third);
+        ok = ok && copy.size() == count;
+    }
+
+    std::ostringstream oss;
+    {
+        boost::archive::text_oarchive oa(oss);
+        const TestCase& c = *tc;
+        oa << c;
+    }
+    TestCase loaded;
+    {
+        std::istringstream iss(oss.str());
+        boost::archive::text_iarchive ia(iss);
+        ia >> loaded;
+    }
+    ok = ok && loaded.count() == tc->count() && loaded.testItem(ids[0]) &&
+            loaded.testItem(ids[0])->getInt(x) == tc->testItem(ids[0])->getInt(x);
+
+    delete tc;
+    if (!ok)
+        std::fprintf(stderr, "TestCase check failed\n");
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 50000;
+    if (count <= 0)
+        count = 50000;
+    int passes = argc > 2 ? std::atoi(argv[2]) : 20;
+    if (passes <= 0)
+        passes = 20;
+
+    std::printf("%d items, %d passes%s\n", count, passes,
+                heapInUse() ? "" : " (heap size not available)");
+    std::printf("%-10s %12s %10s %10s %10s\n", "layout", "heap MB", "build ms", "iter ms", "lookup ms");
+    benchPtrList(count, passes);
+    return benchTestCase(count, passes) ? 0 : 1;
+}
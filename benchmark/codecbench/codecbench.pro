@@ -0,0 +1,24 @@
+# -------------------------------------------------
+# TestItem codec microbenchmark
+# -------------------------------------------------
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+
+TARGET = codecbench
+
+INCLUDEPATH += ../../common/
+
+SOURCES += main.cpp \
+           ../../common/datamodel.cpp \
+           ../../common/stringpool.cpp \
+           ../../common/uuid.cpp \
+           ../../common/testitemcodec.cpp
+
+HEADERS += ../../common/datamodel.h \
+           ../../common/stringpool.h \
+           ../../common/uuid.h \
+           ../../common/testitemcodec.h
+
+LIBS += -lboost_thread -lboost_system -lboost_serialization
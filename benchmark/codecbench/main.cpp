@@ -0,0 +1,299 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+///
+/// TestItem codec microbenchmark
+///
+/// Compares the binary Protocol::TestItemCodec, self-contained and
+/// with a connection dictionary, with the boost text archive
+/// previously used on the wire. Every encoded item is decoded
+/// back and compared with the original first, so the benchmark also
+/// works as a round trip check of the codec.
+///
+/// usage: codecbench [iterations]
+///
+
+#include <datamodel.h>
+#include <testitemcodec.h>
+
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace DataModel;
+using namespace Protocol;
+
+typedef std::chrono::steady_clock Clock;
+
+///
+/// sample items (shaped like the recorded Qt events)
+///
+static void makeItems(std::vector<TestItem*>& items)
+{
+    const char* widgets[] = {
+        "MainWindow.centralWidget.tabWidget.qt_tabwidget_stackedwidget.tab.pushButton",
+        "MainWindow.centralWidget.lineEdit",
+        "MainWindow.menuBar.menuFile.actionOpen",
+        "QFileDialog.listView.qt_scrollarea_viewport"
+    };
+
+    // typed fields, as set by the QOE accessors
+    const FieldKey widget = fieldKey("widget");
+    const FieldKey x = fieldKey("x");
+    const FieldKey y = fieldKey("y");
+    const FieldKey gx = fieldKey("gx");
+    const FieldKey gy = fieldKey("gy");
+    const FieldKey button = fieldKey("button");
+    const FieldKey buttons = fieldKey("buttons");
+    const FieldKey modifiers = fieldKey("modifiers");
+    const FieldKey isSens = fieldKey("isSens");
+
+    for (int i = 0; i < 64; i++)
+    {
+        TestItem* ti = new TestItem(i % 2 ? 2 : 1, 10 + i % 7, i * 37);
+        ti->setString(widget, widgets[i % 4]);
+        int n = (i * 13) % 800;
+        ti->setInt(x, n);
+        ti->setInt(y, n);
+        ti->setInt(gx, n);
+        ti->setInt(gy, n);
+        ti->setInt(button, 1);
+        ti->setInt(buttons, 1);
+        ti->setInt(modifiers, i % 5 ? 0 : -33554432);
+        ti->setBool(isSens, false);
+        ti->addMetadata("recorded", "true");
+        items.push_back(ti);
+    }
+}
+
+static bool sameFields(const TestItem& a, const TestItem& b)
+{
+    if (a.fields().size() != b.fields().size())
+        return false;
+    for (size_t i = 0; i < a.fields().size(); i++)
+    {
+        const FieldValue* v = b.field(a.fields()[i].key);
+        if (!v || !(*v == a.fields()[i].value))
+            return false;
+    }
+    return true;
+}
+
+static bool sameItem(const TestItem& a, const TestItem& b)
+{
+    return a.uuid() == b.uuid() &&
+            a.type() == b.type() &&
+            a.subtype() == b.subtype() &&
+            a.timestamp() == b.timestamp() &&
+            a.dataMap() == b.dataMap() &&
+            sameFields(a, b) &&
+            a.metadataMap() == b.metadataMap();
+}
+
+///
+/// codec round trip and corruption checks
+///
+static bool checkCodec(const std::vector<TestItem*>& items)
+{
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        std::string buffer;
+        TestItemCodec::encode(*items[i], buffer);
+
+        TestItem decoded;
+        if (!TestItemCodec::decode(buffer.data(), buffer.size(), decoded) ||
+            !sameItem(*items[i], decoded))
+        {
+            std::fprintf(stderr, "round trip mismatch on item %u\n", unsigned(i));
+            return false;
+        }
+
+        // every truncation must be rejected
+        for (size_t len = 0; len < buffer.size(); len++)
+        {
+            TestItem t;
+            if (TestItemCodec::decode(buffer.data(), len, t))
+            {
+                std::fprintf(stderr, "truncated item %u accepted (%u bytes)\n",
+                             unsigned(i), unsigned(len));
+                return false;
+            }
+        }
+    }
+
+    // dictionary encoding: the items are decoded in the same order,
+    // the second pass only references strings already defined
+    TestItemCodec::Dictionary encoder, decoder;
+    for (int pass = 0; pass < 2; pass++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            std::string buffer;
+            TestItemCodec::encode(*items[i], encoder, buffer);
+
+            TestItem decoded;
+            if (!TestItemCodec::decode(buffer.data(), buffer.size(), decoder, decoded) ||
+                !sameItem(*items[i], decoded))
+            {
+                std::fprintf(stderr, "dictionary round trip mismatch on item %u\n", unsigned(i));
+                return false;
+            }
+        }
+
+    // without its dictionary the item is rejected
+    std::string buffer;
+    TestItemCodec::encode(*items[0], encoder, buffer);
+    TestItem t;
+    TestItemCodec::Dictionary empty;
+    if (TestItemCodec::decode(buffer.data(), buffer.size(), t) ||
+        TestItemCodec::decode(buffer.data(), buffer.size(), empty, t))
+    {
+        std::fprintf(stderr, "dictionary item accepted without its dictionary\n");
+        return false;
+    }
+    return true;
+}
+
+static double nsPerItem(Clock::duration d, size_t n)
+{
+    return std::chrono::duration<double, std::nano>(d).count() / n;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+    if (iterations <= 0)
+        iterations = 2000;
+
+    std::vector<TestItem*> items;
+    makeItems(items);
+    const size_t total = items.size() * iterations;
+
+    if (!checkCodec(items))
+        return 1;
+
+    /// binary codec
+    std::vector<std::string> encoded(items.size());
+    size_t codecBytes = 0;
+    Clock::time_point t0 = Clock::now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            encoded[i].clear();
+            TestItemCodec::encode(*items[i], encoded[i]);
+        }
+    Clock::duration codecEncode = Clock::now() - t0;
+    for (size_t i = 0; i < items.size(); i++)
+        codecBytes += encoded[i].size();
+
+    t0 = Clock::now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            TestItem ti;
+            TestItemCodec::decode(encoded[i].data(), encoded[i].size(), ti);
+        }
+    Clock::duration codecDecode = Clock::now() - t0;
+
+    /// binary codec with a dictionary (steady state, the strings are
+    /// defined in the first iteration)
+    TestItemCodec::Dictionary encoder, decoder;
+    size_t dictionaryBytes = 0;
+    t0 = Clock::now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            encoded[i].clear();
+            TestItemCodec::encode(*items[i], encoder, encoded[i]);
+        }
+    Clock::duration dictionaryEncode = Clock::now() - t0;
+    for (size_t i = 0; i < items.size(); i++)
+        dictionaryBytes += encoded[i].size();
+
+    // the decoder needs the definitions sent in the first iteration
+    TestItemCodec::Dictionary definitions;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        std::string first;
+        TestItem ti;
+        TestItemCodec::encode(*items[i], definitions, first);
+        TestItemCodec::decode(first.data(), first.size(), decoder, ti);
+    }
+
+    t0 = Clock::now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            TestItem ti;
+            TestItemCodec::decode(encoded[i].data(), encoded[i].size(), decoder, ti);
+        }
+    Clock::duration dictionaryDecode = Clock::now() - t0;
+
+    /// boost text archive
+    std::vector<std::string> archived(items.size());
+    size_t archiveBytes = 0;
+    t0 = Clock::now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            std::ostringstream oss;
+            boost::archive::text_oarchive oa(oss);
+            oa << *items[i];
+            archived[i] = oss.str();
+        }
+    Clock::duration archiveEncode = Clock::now() - t0;
+    for (size_t i = 0; i < items.size(); i++)
+        archiveBytes += archived[i].size();
+
+    t0 = Clock::now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            std::istringstream iss(archived[i]);
+            boost::archive::text_iarchive ia(iss);
+            TestItem ti;
+            ia >> ti;
+        }
+    Clock::duration archiveDecode = Clock::now() - t0;
+
+    std::printf("%-14s %12s %12s %12s\n", "format", "bytes/item", "encode ns", "decode ns");
+    std::printf("%-14s %12.1f %12.1f %12.1f\n", "codec",
+                double(codecBytes) / items.size(),
+                nsPerItem(codecEncode, total), nsPerItem(codecDecode, total));
+    std::printf("%-14s %12.1f %12.1f %12.1f\n", "dictionary",
+                double(dictionaryBytes) / items.size(),
+                nsPerItem(dictionaryEncode, total), nsPerItem(dictionaryDecode, total));
+    std::printf("%-14s %12.1f %12.1f %12.1f\n", "text_archive",
+                double(archiveBytes) / items.size(),
+                nsPerItem(archiveEncode, total), nsPerItem(archiveDecode, total));
+
+    for (size_t i = 0; i < items.size(); i++)
+        delete items[i];
+
+    return 0;
+}
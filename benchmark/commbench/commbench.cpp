@@ -0,0 +1,233 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "commbench.h"
+
+#include <protocol.h>
+#include <testitemcodec.h>
+#include <algorithm>
+#include <cstdio>
+
+using namespace CommBench;
+
+// time to wait for an echo before giving up (ms)
+static const int RESPONSE_TIMEOUT = 10000;
+
+/// ///////////////////////////////////////////
+/// /// ECHO PEER /////////////////////////////
+/// ///////////////////////////////////////////
+
+EchoPeer::EchoPeer(const Transport::Endpoint& endpoint)
+    : endpoint_(endpoint)
+{
+}
+
+EchoPeer::~EchoPeer()
+{
+    stop();
+}
+
+bool EchoPeer::start()
+{
+    comm_.reset(new Comm(endpoint_, false));
+    connect(comm_.get(), SIGNAL(receivedTestItem(DataModel::TestItemPtr, uint, int)),
+            this, SLOT(handleReceivedTestItem(DataModel::TestItemPtr, uint, int)));
+    connect(comm_.get(), SIGNAL(clientDisconnected(int)),
+            this, SLOT(handleDisconnected(int)));
+    return comm_->resetAndStart();
+}
+
+void EchoPeer::stop()
+{
+    if (comm_.get())
+        comm_->stop();
+    comm_.reset();
+}
+
+void EchoPeer::handleReceivedTestItem(DataModel::TestItemPtr ti, uint sequence, int)
+{
+    comm_->handleSendTestItem(*ti, sequence);
+}
+
+void EchoPeer::handleDisconnected(int)
+{
+    emit finished();
+}
+
+/// ///////////////////////////////////////////
+/// /// DRIVER ////////////////////////////////
+/// ///////////////////////////////////////////
+
+Driver::Driver(const Transport::Endpoint& endpoint)
+    : endpoint_(endpoint), connected_(false), failed_(false),
+      items_(0), count_(0), sent_(0), received_(0), window_(1), result_(0)
+{
+    timeout_.setSingleShot(true);
+    timeout_.setInterval(RESPONSE_TIMEOUT);
+    connect(&timeout_, SIGNAL(timeout()), this, SLOT(handleTimeout()));
+}
+
+Driver::~Driver()
+{
+    stop();
+}
+
+bool Driver::listen()
+{
+    comm_.reset(new Comm(endpoint_, true));
+    connect(comm_.get(), SIGNAL(receivedTestItem(DataModel::TestItemPtr, uint, int)),
+            this, SLOT(handleReceivedTestItem(DataModel::TestItemPtr, uint, int)));
+    connect(comm_.get(), SIGNAL(clientConnected(int)),
+            this, SLOT(handleClientConnected(int)));
+    connect(comm_.get(), SIGNAL(error(const std::string&)),
+            this, SLOT(handleError(const std::string&)));
+    connected_ = false;
+    failed_ = false;
+    return comm_->resetAndStart() && comm_->messageServer();
+}
+
+void Driver::stop()
+{
+    if (comm_.get())
+        comm_->stop();
+    comm_.reset();
+    connected_ = false;
+}
+
+Transport::Endpoint Driver::endpoint() const
+{
+    return comm_.get() ? comm_->endpoint() : endpoint_;
+}
+
+bool Driver::waitForPeer(int msecs)
+{
+    timeout_.start(msecs);
+    while (!connected_ && !failed_)
+        loop_.exec();
+    timeout_.stop();
+    timeout_.setInterval(RESPONSE_TIMEOUT);
+    return connected_ && !failed_;
+}
+
+bool Driver::run(const std::vector<DataModel::TestItem*>& items,
+                 size_t count, int window, Result& result)
+{
+    //frame sizes, as sent on the wire once the strings of the
+    //items are in the connection dictionary
+    Protocol::TestItemCodec::Dictionary strings;
+    frameSizes_.resize(items.size());
+    for (int pass = 0; pass < 2; pass++)
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            std::string data;
+            Protocol::TestItemCodec::encode(*items[i], strings, data);
+            frameSizes_[i] = Protocol::FRAME_HEADER_SIZE + data.size();
+        }
+
+    items_ = &items;
+    count_ = count;
+    window_ = window > 0 ? window : 1;
+    sent_ = 0;
+    received_ = 0;
+    failed_ = false;
+    sendTimes_.assign(count, Clock::time_point());
+
+    result_ = &result;
+    result.items = count;
+    result.window = window_;
+    result.bytes = 0;
+    result.latencies.clear();
+    result.latencies.reserve(count);
+
+    Clock::time_point t0 = Clock::now();
+    timeout_.start();
+    _fill();
+    while (received_ < count_ && !failed_)
+        loop_.exec();
+    timeout_.stop();
+    result.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::sort(result.latencies.begin(), result.latencies.end());
+    result_ = 0;
+    items_ = 0;
+    return !failed_;
+}
+
+void Driver::_fill()
+{
+    //sequence numbers start at 1, 0 means untagged
+    while (sent_ < count_ && sent_ - received_ < window_)
+    {
+        size_t i = sent_ % items_->size();
+        sendTimes_[sent_] = Clock::now();
+        sent_++;
+        result_->bytes += frameSizes_[i];
+        comm_->handleSendTestItem(*(*items_)[i], sent_);
+    }
+}
+
+///
+/// handlers
+///
+void Driver::handleReceivedTestItem(DataModel::TestItemPtr, uint sequence, int)
+{
+    Clock::time_point now = Clock::now();
+
+    if (!result_ || sequence == 0 || sequence > sent_)
+    {
+        std::fprintf(stderr, "unexpected echo (sequence %u)\n", sequence);
+        failed_ = true;
+        loop_.quit();
+        return;
+    }
+
+    result_->latencies.push_back(
+            std::chrono::duration<double, std::micro>(now - sendTimes_[sequence - 1]).count());
+    result_->bytes += frameSizes_[(sequence - 1) % frameSizes_.size()];
+    received_++;
+    timeout_.start();
+
+    _fill();
+    if (received_ == count_)
+        loop_.quit();
+}
+
+void Driver::handleClientConnected(int)
+{
+    connected_ = true;
+    loop_.quit();
+}
+
+void Driver::handleError(const std::string& s)
+{
+    std::fprintf(stderr, "comm error: %s\n", s.c_str());
+    failed_ = true;
+    loop_.quit();
+}
+
+void Driver::handleTimeout()
+{
+    std::fprintf(stderr, "timed out waiting for the peer\n");
+    failed_ = true;
+    loop_.quit();
+}
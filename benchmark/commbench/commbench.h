@@ -0,0 +1,140 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef COMMBENCH_H
+#define COMMBENCH_H
+
+#include <comm.h>
+#include <datamodel.h>
+#include <transport.h>
+#include <QObject>
+#include <QEventLoop>
+#include <QTimer>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CommBench
+{
+    typedef std::chrono::steady_clock Clock;
+
+    ///
+    /// measures of a run
+    ///
+    typedef struct
+    {
+        size_t items;
+        int window;
+        double seconds;
+        // frame bytes, both directions
+        size_t bytes;
+        // round trip times (us), sorted
+        std::vector<double> latencies;
+    } Result;
+
+    ///
+    /// echo peer
+    ///
+    /// Client side Comm that sends every received item back,
+    /// tagged with the same sequence number.
+    ///
+    class EchoPeer : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        EchoPeer(const Transport::Endpoint& endpoint);
+        ~EchoPeer();
+
+    public slots:
+        bool start();
+        void stop();
+        void handleReceivedTestItem(DataModel::TestItemPtr, uint sequence, int client);
+        void handleDisconnected(int client);
+
+    signals:
+        // the driver closed the connection
+        void finished();
+
+    private:
+        Transport::Endpoint endpoint_;
+        std::auto_ptr<Comm> comm_;
+    };
+
+    ///
+    /// driver
+    ///
+    /// Server side Comm that sends the items to the echo peer,
+    /// keeping up to window items in flight, and times the round
+    /// trip of each one. A window of 1 is stop-and-wait.
+    ///
+    class Driver : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        Driver(const Transport::Endpoint& endpoint);
+        ~Driver();
+
+        bool listen();
+        void stop();
+
+        // endpoint the peer has to connect to
+        Transport::Endpoint endpoint() const;
+
+        bool waitForPeer(int msecs);
+
+        // sends count items, cycling over the given ones
+        bool run(const std::vector<DataModel::TestItem*>& items,
+                 size_t count, int window, Result& result);
+
+    public slots:
+        void handleReceivedTestItem(DataModel::TestItemPtr, uint sequence, int client);
+        void handleClientConnected(int client);
+        void handleError(const std::string&);
+        void handleTimeout();
+
+    private:
+        void _fill();
+
+        Transport::Endpoint endpoint_;
+        std::auto_ptr<Comm> comm_;
+        bool connected_;
+        bool failed_;
+
+        QEventLoop loop_;
+        QTimer timeout_;
+
+        // current run
+        const std::vector<DataModel::TestItem*>* items_;
+        std::vector<size_t> frameSizes_;
+        std::vector<Clock::time_point> sendTimes_;
+        size_t count_;
+        size_t sent_;
+        size_t received_;
+        size_t window_;
+        Result* result_;
+    };
+}
+
+#endif // COMMBENCH_H
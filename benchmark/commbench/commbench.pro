@@ -0,0 +1,45 @@
+# -------------------------------------------------
+# Comm loopback benchmark
+# -------------------------------------------------
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+QT += network
+QT -= gui
+
+TARGET = commbench
+
+INCLUDEPATH += ../../common/
+
+SOURCES += main.cpp \
+           commbench.cpp \
+           ../../common/datamodel.cpp \
+           ../../common/stringpool.cpp \
+           ../../common/comm.cpp \
+           ../../common/messageclientserver.cpp \
+           ../../common/utilclasses.cpp \
+           ../../common/uuid.cpp \
+           ../../common/protocol.cpp \
+           ../../common/testitemcodec.cpp \
+           ../../common/transport.cpp \
+           ../../common/sockettransport.cpp \
+           ../../common/shmtransport.cpp
+
+HEADERS += commbench.h \
+           ../../common/datamodel.h \
+           ../../common/stringpool.h \
+           ../../common/comm.h \
+           ../../common/messageclientserver.h \
+           ../../common/utilclasses.h \
+           ../../common/uuid.h \
+           ../../common/protocol.h \
+           ../../common/testitemcodec.h \
+           ../../common/transport.h \
+           ../../common/sockettransport.h \
+           ../../common/shmtransport.h \
+           ../../common/ohtbaseconfig.h \
+           ../../common/debug.h
+
+LIBS += -lboost_thread -lboost_system -lboost_serialization
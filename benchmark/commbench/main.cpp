@@ -0,0 +1,272 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+///
+/// Comm loopback benchmark
+///
+/// Runs a Comm server (the driver) and a Comm client that echoes
+/// back every item, in another thread of the same process or in a
+/// child process, over each transport. The items are shaped like
+/// the recorded Qt events. Each run is made stop-and-wait (one item
+/// in flight) and streaming (window items in flight), and reports
+/// items/s, frame bytes/s (both directions) and the p50/p99 round
+/// trip time, as JSON on the standard output.
+///
+/// usage: commbench [items] [window] [transports] [modes]
+///   items       items per run (default 20000)
+///   window      items in flight when streaming (default 64)
+///   transports  comma separated, from tcp,local,shm (default all)
+///   modes       comma separated, from in-process,cross-process
+///               (default both)
+///
+/// The child process is this program, run as: commbench --echo endpoint
+///
+
+#include "commbench.h"
+
+#include <ohtbaseconfig.h>
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace CommBench;
+using namespace DataModel;
+
+// items sent before each measured run
+static const size_t WARMUP_ITEMS = 256;
+
+///
+/// sample items (shaped like the recorded Qt events)
+///
+static void makeItems(std::vector<TestItem*>& items)
+{
+    const char* widgets[] = {
+        "MainWindow.centralWidget.tabWidget.qt_tabwidget_stackedwidget.tab.pushButton",
+        "MainWindow.centralWidget.lineEdit",
+        "MainWindow.menuBar.menuFile.actionOpen",
+        "QFileDialog.listView.qt_scrollarea_viewport"
+    };
+
+    // typed fields, as set by the QOE accessors
+    const FieldKey widget = fieldKey("widget");
+    const FieldKey x = fieldKey("x");
+    const FieldKey y = fieldKey("y");
+    const FieldKey gx = fieldKey("gx");
+    const FieldKey gy = fieldKey("gy");
+    const FieldKey button = fieldKey("button");
+    const FieldKey buttons = fieldKey("buttons");
+    const FieldKey modifiers = fieldKey("modifiers");
+    const FieldKey isSens = fieldKey("isSens");
+
+    for (int i = 0; i < 64; i++)
+    {
+        TestItem* ti = new TestItem(i % 2 ? 2 : 1, 10 + i % 7, i * 37);
+        ti->setString(widget, widgets[i % 4]);
+        int n = (i * 13) % 800;
+        ti->setInt(x, n);
+        ti->setInt(y, n);
+        ti->setInt(gx, n);
+        ti->setInt(gy, n);
+        ti->setInt(button, 1);
+        ti->setInt(buttons, 1);
+        ti->setInt(modifiers, i % 5 ? 0 : -33554432);
+        ti->setBool(isSens, false);
+        ti->addMetadata("recorded", "true");
+        items.push_back(ti);
+    }
+}
+
+///
+/// echo child process
+///
+static int runEcho(const char* address)
+{
+    Transport::Endpoint endpoint;
+    if (!Transport::Endpoint::parse(address, endpoint))
+    {
+        std::fprintf(stderr, "invalid endpoint %s\n", address);
+        return 1;
+    }
+
+    EchoPeer peer(endpoint);
+    QObject::connect(&peer, SIGNAL(finished()), qApp, SLOT(quit()));
+    if (!peer.start())
+        return 1;
+    return qApp->exec();
+}
+
+///
+/// one transport and mode, both patterns
+///
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t i = size_t(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+static void printResult(const std::string& transport, const std::string& mode,
+                        const char* pattern, const Result& r, bool& first)
+{
+    std::printf("%s    {\"transport\": \"%s\", \"mode\": \"%s\", \"pattern\": \"%s\", "
+                "\"window\": %d, \"items\": %u, \"seconds\": %.6f, "
+                "\"items_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+                "\"latency_us\": {\"p50\": %.2f, \"p99\": %.2f}}",
+                first ? "" : ",\n",
+                transport.c_str(), mode.c_str(), pattern,
+                r.window, unsigned(r.items), r.seconds,
+                r.items / r.seconds, r.bytes / r.seconds,
+                percentile(r.latencies, 0.50), percentile(r.latencies, 0.99));
+    first = false;
+}
+
+static bool runBench(Transport::Endpoint::Kind kind, const std::string& transport,
+                     bool crossProcess, const std::vector<TestItem*>& items,
+                     size_t count, int window, bool& first)
+{
+    //a free port, or a name no other run uses
+    static int run = 0;
+    std::ostringstream address;
+    if (kind == Transport::Endpoint::TCP)
+        address << 0;
+    else
+        address << "ohtbench-" << QCoreApplication::applicationPid() << "-" << run++;
+
+    Driver driver(Transport::Endpoint(kind, address.str()));
+    if (!driver.listen())
+    {
+        std::fprintf(stderr, "%s: cannot listen\n", transport.c_str());
+        return false;
+    }
+
+    //starting the peer
+    QThread thread;
+    std::auto_ptr<EchoPeer> peer;
+    QProcess process;
+    if (crossProcess)
+    {
+        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process.start(QCoreApplication::applicationFilePath(),
+                      QStringList() << "--echo"
+                                    << QString::fromStdString(driver.endpoint().toString()));
+    }
+    else
+    {
+        peer.reset(new EchoPeer(driver.endpoint()));
+        peer->moveToThread(&thread);
+        thread.start();
+        QMetaObject::invokeMethod(peer.get(), "start", Qt::QueuedConnection);
+    }
+
+    Result r;
+    bool ok = driver.waitForPeer(CONNECT_TIMEOUT * 5) &&
+            driver.run(items, std::min(count, WARMUP_ITEMS), window, r);
+    const char* mode = crossProcess ? "cross-process" : "in-process";
+    if (ok && (ok = driver.run(items, count, 1, r)))
+        printResult(transport, mode, "stop-and-wait", r, first);
+    if (ok && (ok = driver.run(items, count, window, r)))
+        printResult(transport, mode, "streaming", r, first);
+    if (!ok)
+        std::fprintf(stderr, "%s %s: run failed\n", transport.c_str(), mode);
+
+    //closing the connection ends the child
+    driver.stop();
+    if (crossProcess)
+    {
+        if (!process.waitForFinished(CONNECT_TIMEOUT))
+            process.kill();
+    }
+    else
+    {
+        QMetaObject::invokeMethod(peer.get(), "stop", Qt::BlockingQueuedConnection);
+        thread.quit();
+        thread.wait();
+    }
+    return ok;
+}
+
+static bool selected(const char* list, const char* name)
+{
+    if (!list)
+        return true;
+    return QString(list).split(',').contains(name);
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    if (argc > 2 && std::string(argv[1]) == "--echo")
+        return runEcho(argv[2]);
+
+    int count = argc > 1 ? std::atoi(argv[1]) : 20000;
+    if (count <= 0)
+        count = 20000;
+    int window = argc > 2 ? std::atoi(argv[2]) : 64;
+    if (window <= 0)
+        window = 64;
+    const char* transports = argc > 3 ? argv[3] : 0;
+    const char* modes = argc > 4 ? argv[4] : 0;
+
+    std::vector<TestItem*> items;
+    makeItems(items);
+
+    const struct
+    {
+        Transport::Endpoint::Kind kind;
+        const char* name;
+    } kinds[] = {
+        { Transport::Endpoint::TCP, "tcp" },
+        { Transport::Endpoint::LOCAL, "local" },
+        { Transport::Endpoint::SHM, "shm" }
+    };
+
+    bool ok = true;
+    bool first = true;
+    std::printf("{\n  \"benchmark\": \"commbench\",\n  \"items\": %d,\n  \"window\": %d,\n"
+                "  \"results\": [\n", count, window);
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        if (!selected(transports, kinds[k].name))
+            continue;
+        if (selected(modes, "in-process"))
+            ok &= runBench(kinds[k].kind, kinds[k].name, false, items, count, window, first);
+        if (selected(modes, "cross-process"))
+            ok &= runBench(kinds[k].kind, kinds[k].name, true, items, count, window, first);
+    }
+    std::printf("\n  ]\n}\n");
+
+    for (size_t i = 0; i < items.size(); i++)
+        delete items[i];
+
+    return ok ? 0 : 1;
+}
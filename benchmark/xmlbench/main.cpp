@@ -0,0 +1,318 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+///
+/// XML test suite loader benchmark
+///
+/// Writes a suite of recorded-like items with the XMLDataModelAdapter
+/// and reads it back with each loader, in its own process so the peak
+/// resident memory of one does not hide the other:
+///   dom     the previous loader, a QDomDocument walked into the model
+///   stream  XMLDataModelAdapter::file2testSuite (QXmlStreamReader)
+///   lazy    XMLDataModelAdapter::file2lazyTestSuite (index only)
+///   binary  BinaryDataModelAdapter::file2testSuite, from the same
+///           suite converted to .ohtb
+///   mapped  BinaryDataModelAdapter::file2lazyTestSuite (mmap only)
+/// Reports the parse time, the throughput in MB/s of file and the
+/// peak RSS above the one before parsing, as JSON on the standard
+/// output. The stream and binary loaders, and the writers of both
+/// formats, are timed with 1, 2, 4... threads up to one per core.
+///
+/// usage: xmlbench [cases] [items per case]
+///
+/// The loaders are run as: xmlbench --parse loader file threads
+///
+
+#include <binarydatamodeladapter.h>
+#include <datamodel.h>
+#include <xmldatamodeladapter.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QProcess>
+#include <QStringList>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace DataModel;
+
+typedef std::chrono::steady_clock Clock;
+
+static long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+///
+/// sample suite (items shaped like the recorded Qt events)
+///
+static TestSuite* makeSuite(int cases, int items)
+{
+    const char* widgets[] = {
+        "MainWindow.centralWidget.tabWidget.qt_tabwidget_stackedwidget.tab.pushButton",
+        "MainWindow.centralWidget.lineEdit",
+        "MainWindow.menuBar.menuFile.actionOpen",
+        "QFileDialog.listView.qt_scrollarea_viewport"
+    };
+    const FieldKey widget = fieldKey("widget");
+    const FieldKey x = fieldKey("x");
+    const FieldKey y = fieldKey("y");
+    const FieldKey button = fieldKey("button");
+    const FieldKey modifiers = fieldKey("modifiers");
+
+    TestSuite* ts = new TestSuite();
+    ts->name("xmlbench");
+    ts->appId("/usr/bin/true");
+    for (int c = 0; c < cases; c++)
+    {
+        TestCase* tc = new TestCase();
+        tc->name("case " + std::to_string(c));
+        for (int i = 0; i < items; i++)
+        {
+            TestItem ti(i % 2 ? 2 : 1, 10 + i % 7, i * 37);
+            ti.setString(widget, widgets[i % 4]);
+            int n = (i * 13) % 800;
+            ti.setInt(x, n);
+            ti.setInt(y, n);
+            ti.setInt(button, 1);
+            ti.setInt(modifiers, i % 5 ? 0 : -33554432);
+            ti.addMetadata("recorded", "true");
+            tc->takeTestItem(ti);
+        }
+        ts->addTestCase(tc);
+    }
+    return ts;
+}
+
+///
+/// the previous loader
+///
+static void domReadData(const QDomElement& e, TestBase& tb, bool import)
+{
+    QString key = e.attribute("key");
+    QString value = e.attribute("value");
+    if (e.tagName() == "data")
+    {
+        if (import)
+            tb.importData(key.toStdString(), value.toStdString());
+        else
+            tb.addData(key.toStdString(), value.toStdString());
+    }
+    else if (e.tagName() == "meta")
+        tb.addMetadata(key.toStdString(), value.toStdString());
+}
+
+static TestSuite* domLoad(const QString& filename)
+{
+    QDomDocument doc("mydocument");
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file))
+        return 0;
+
+    std::auto_ptr<TestSuite> ts(new TestSuite());
+    for (QDomElement e1 = doc.documentElement().firstChildElement(); !e1.isNull();
+         e1 = e1.nextSiblingElement())
+    {
+        if (e1.tagName() == "name")
+            ts->name(e1.text().toStdString());
+        else if (e1.tagName() == "appId")
+            ts->appId(e1.text().toStdString());
+        else if (e1.tagName() != "TestCase")
+            domReadData(e1, *ts, false);
+        else
+        {
+            TestCase* tc = new TestCase();
+            for (QDomElement e2 = e1.firstChildElement(); !e2.isNull(); e2 = e2.nextSiblingElement())
+            {
+                if (e2.tagName() == "name")
+                    tc->name(e2.text().toStdString());
+                else if (e2.tagName() != "TestItem")
+                    domReadData(e2, *tc, false);
+                else
+                {
+                    TestItem* ti = new TestItem();
+                    for (QDomElement e3 = e2.firstChildElement(); !e3.isNull();
+                         e3 = e3.nextSiblingElement())
+                    {
+                        if (e3.tagName() == "type")
+                            ti->type(e3.text().toInt());
+                        else if (e3.tagName() == "subtype")
+                            ti->subtype(e3.text().toInt());
+                        else if (e3.tagName() == "timestamp")
+                            ti->timestamp(e3.text().toDouble());
+                        else
+                            domReadData(e3, *ti, true);
+                    }
+                    tc->addTestItem(ti);
+                }
+            }
+            ts->addTestCase(tc);
+        }
+    }
+    return ts.release();
+}
+
+///
+/// loader child process
+///
+static int runParse(const std::string& loader, const QString& filename, unsigned threads)
+{
+    XMLDataModelAdapter adapter;
+    BinaryDataModelAdapter binary;
+    adapter.setThreads(threads);
+    binary.setThreads(threads);
+    long base = peakRssKb();
+
+    Clock::time_point t0 = Clock::now();
+    std::auto_ptr<TestSuite> ts;
+    try
+    {
+        if (loader == "dom")
+            ts.reset(domLoad(filename));
+        else if (loader == "stream")
+            ts.reset(adapter.file2testSuite(filename.toStdString()));
+        else if (loader == "lazy")
+            ts.reset(adapter.file2lazyTestSuite(filename.toStdString()));
+        else if (loader == "binary")
+            ts.reset(binary.file2testSuite(filename.toStdString()));
+        else if (loader == "mapped")
+            ts.reset(binary.file2lazyTestSuite(filename.toStdString()));
+    }
+    catch (DataModelAdapter::conversion_error_exception&)
+    {
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    if (!ts.get())
+    {
+        std::fprintf(stderr, "%s: the suite could not be read\n", loader.c_str());
+        return 1;
+    }
+
+    size_t items = 0;
+    const TestSuite::TestCaseList& tcl = ts->testCases();
+    for (TestSuite::TestCaseList::const_iterator it = tcl.begin(); it != tcl.end(); ++it)
+        items += it->count();
+
+    double mb = QFileInfo(filename).size() / (1024.0 * 1024.0);
+    std::printf("{\"loader\": \"%s\", \"threads\": %u, \"cases\": %zu, \"items\": %zu, "
+                "\"ms\": %.1f, \"mb_per_s\": %.1f, \"peak_rss_mb\": %.1f}",
+                loader.c_str(), threads, ts->count(), items, ms, mb / (ms / 1000.0),
+                (peakRssKb() - base) / 1024.0);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    if (argc > 4 && std::string(argv[1]) == "--parse")
+        return runParse(argv[2], QString::fromLocal8Bit(argv[3]), std::atoi(argv[4]));
+
+    int cases = argc > 1 ? std::atoi(argv[1]) : 20;
+    if (cases <= 0)
+        cases = 20;
+    int items = argc > 2 ? std::atoi(argv[2]) : 5000;
+    if (items <= 0)
+        items = 5000;
+
+    QString filename = QDir::temp().filePath("xmlbench.oht");
+    QString binaryFilename = QDir::temp().filePath("xmlbench.ohtb");
+
+    //1, 2, 4... threads, up to one per core
+    std::vector<unsigned> threads;
+    unsigned cores = CaseWorkers(0, 0).threads();
+    for (unsigned n = 1; n < cores; n *= 2)
+        threads.push_back(n);
+    threads.push_back(cores);
+
+    bool ok = true;
+    std::printf("{\n  \"benchmark\": \"xmlbench\",\n  \"saves\": [\n");
+    {
+        std::auto_ptr<TestSuite> ts(makeSuite(cases, items));
+        XMLDataModelAdapter adapter;
+        BinaryDataModelAdapter binary;
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            adapter.setThreads(threads[i]);
+            binary.setThreads(threads[i]);
+            try
+            {
+                Clock::time_point t0 = Clock::now();
+                adapter.testSuite2file(*ts, filename.toStdString());
+                Clock::time_point t1 = Clock::now();
+                binary.testSuite2file(*ts, binaryFilename.toStdString());
+                Clock::time_point t2 = Clock::now();
+                std::printf("%s    {\"threads\": %u, \"xml_ms\": %.1f, \"binary_ms\": %.1f}",
+                            i ? ",\n" : "", threads[i],
+                            std::chrono::duration<double, std::milli>(t1 - t0).count(),
+                            std::chrono::duration<double, std::milli>(t2 - t1).count());
+            }
+            catch (DataModelAdapter::conversion_error_exception&)
+            {
+                std::fprintf(stderr, "the suite could not be written to %s\n",
+                             filename.toLocal8Bit().constData());
+                return 1;
+            }
+        }
+    }
+
+    std::printf("\n  ],\n  \"file_mb\": %.1f,\n  \"binary_file_mb\": %.1f,\n  \"results\": [\n",
+                QFileInfo(filename).size() / (1024.0 * 1024.0),
+                QFileInfo(binaryFilename).size() / (1024.0 * 1024.0));
+
+    //loader, file, threads
+    QList<QStringList> runs;
+    runs << (QStringList() << "dom" << filename << "1");
+    for (size_t i = 0; i < threads.size(); i++)
+        runs << (QStringList() << "stream" << filename << QString::number(threads[i]));
+    runs << (QStringList() << "lazy" << filename << "1");
+    for (size_t i = 0; i < threads.size(); i++)
+        runs << (QStringList() << "binary" << binaryFilename << QString::number(threads[i]));
+    runs << (QStringList() << "mapped" << binaryFilename << "1");
+
+    for (int i = 0; i < runs.size(); i++)
+    {
+        QProcess process;
+        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process.start(QCoreApplication::applicationFilePath(), QStringList() << "--parse" << runs[i]);
+        ok = process.waitForFinished(-1) && process.exitCode() == 0 && ok;
+        std::printf("%s    %s", i ? ",\n" : "", process.readAllStandardOutput().constData());
+    }
+    std::printf("\n  ]\n}\n");
+
+    QFile::remove(filename);
+    QFile::remove(binaryFilename);
+    return ok ? 0 : 1;
+}
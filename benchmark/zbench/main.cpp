@@ -0,0 +1,177 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+///
+/// Compressed test suite benchmark
+///
+/// Writes a suite of recorded-like items in both formats, plain and
+/// compressed at several zlib levels, and reads each file back. Reports
+/// the file size, its ratio to the plain one and the write, load and
+/// lazy open times, as JSON on the standard output.
+///
+/// usage: zbench [cases] [items per case]
+///
+
+#include <binarydatamodeladapter.h>
+#include <compresseddatamodeladapter.h>
+#include <datamodel.h>
+#include <xmldatamodeladapter.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using namespace DataModel;
+
+typedef std::chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+///
+/// sample suite (items shaped like the recorded Qt events)
+///
+static TestSuite* makeSuite(int cases, int items)
+{
+    const char* widgets[] = {
+        "MainWindow.centralWidget.tabWidget.qt_tabwidget_stackedwidget.tab.pushButton",
+        "MainWindow.centralWidget.lineEdit",
+        "MainWindow.menuBar.menuFile.actionOpen",
+        "QFileDialog.listView.qt_scrollarea_viewport"
+    };
+    const FieldKey widget = fieldKey("widget");
+    const FieldKey x = fieldKey("x");
+    const FieldKey y = fieldKey("y");
+    const FieldKey button = fieldKey("button");
+    const FieldKey modifiers = fieldKey("modifiers");
+
+    TestSuite* ts = new TestSuite();
+    ts->name("zbench");
+    ts->appId("/usr/bin/true");
+    for (int c = 0; c < cases; c++)
+    {
+        TestCase* tc = new TestCase();
+        tc->name("case " + std::to_string(c));
+        for (int i = 0; i < items; i++)
+        {
+            TestItem ti(i % 2 ? 2 : 1, 10 + i % 7, i * 37);
+            ti.setString(widget, widgets[i % 4]);
+            int n = (i * 13) % 800;
+            ti.setInt(x, n);
+            ti.setInt(y, n);
+            ti.setInt(button, 1);
+            ti.setInt(modifiers, i % 5 ? 0 : -33554432);
+            ti.addMetadata("recorded", "true");
+            tc->takeTestItem(ti);
+        }
+        ts->addTestCase(tc);
+    }
+    return ts;
+}
+
+///
+/// one format at one level (-1 for the plain file, whose size is kept
+/// in plainSize)
+///
+static bool runLevel(CompressedDataModelAdapter& adapter, const TestSuite& ts,
+                     const QString& plainName, int level, double& plainSize, bool first)
+{
+    std::string filename = plainName.toStdString();
+    if (level >= 0)
+    {
+        filename += "." COMPRESSED_FILE_EXTENSION;
+        adapter.setLevel(level);
+    }
+
+    try
+    {
+        Clock::time_point t0 = Clock::now();
+        adapter.testSuite2file(ts, filename);
+        double writeMs = msSince(t0);
+
+        t0 = Clock::now();
+        std::auto_ptr<TestSuite> loaded(adapter.file2testSuite(filename));
+        double loadMs = msSince(t0);
+        loaded.reset();
+
+        t0 = Clock::now();
+        std::auto_ptr<TestSuite> lazy(adapter.file2lazyTestSuite(filename));
+        double lazyMs = msSince(t0);
+
+        double size = QFileInfo(QString::fromStdString(filename)).size();
+        if (level < 0)
+            plainSize = size;
+        std::printf("%s    {\"format\": \"%s\", \"level\": %d, \"mb\": %.2f, \"ratio\": %.3f, "
+                    "\"write_ms\": %.1f, \"load_ms\": %.1f, \"lazy_open_ms\": %.1f}",
+                    first ? "" : ",\n", adapter.extension().c_str(), level,
+                    size / (1024.0 * 1024.0), size / plainSize,
+                    writeMs, loadMs, lazyMs);
+    }
+    catch (DataModelAdapter::conversion_error_exception&)
+    {
+        std::fprintf(stderr, "the suite could not be converted with %s\n", filename.c_str());
+        return false;
+    }
+    std::remove(filename.c_str());
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    int cases = argc > 1 ? std::atoi(argv[1]) : 20;
+    if (cases <= 0)
+        cases = 20;
+    int items = argc > 2 ? std::atoi(argv[2]) : 5000;
+    if (items <= 0)
+        items = 5000;
+
+    std::auto_ptr<TestSuite> ts(makeSuite(cases, items));
+    CompressedDataModelAdapter xml(new XMLDataModelAdapter());
+    CompressedDataModelAdapter binary(new BinaryDataModelAdapter());
+    CompressedDataModelAdapter* adapters[] = { &xml, &binary };
+    const int levels[] = { -1, 1, 3, 6, 9 };
+
+    bool ok = true;
+    std::printf("{\n  \"benchmark\": \"zbench\",\n  \"cases\": %d,\n  \"items\": %d,\n"
+                "  \"results\": [\n", cases, items);
+    for (size_t a = 0; a < 2; a++)
+    {
+        QString plainName = QDir::temp().filePath("zbench." +
+                                                  QString::fromStdString(adapters[a]->extension()));
+        double plainSize = 0;
+        for (size_t l = 0; ok && l < sizeof(levels) / sizeof(levels[0]); l++)
+            ok = runLevel(*adapters[a], *ts, plainName, levels[l], plainSize, a == 0 && l == 0);
+    }
+    std::printf("\n  ]\n}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+# -------------------------------------------------
+# Compressed test suite benchmark
+# -------------------------------------------------
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+QT += xml
+QT -= gui
+
+TARGET = zbench
+
+INCLUDEPATH += ../../common/ \
+               ../../hmi_tester/ \
+               ../../qt_linux_hmi_tester/
+
+SOURCES += main.cpp \
+           ../../common/datamodel.cpp \
+           ../../common/stringpool.cpp \
+           ../../common/uuid.cpp \
+           ../../hmi_tester/binarydatamodeladapter.cpp \
+           ../../hmi_tester/caseworkers.cpp \
+           ../../hmi_tester/compresseddatamodeladapter.cpp \
+           ../../qt_linux_hmi_tester/xmldatamodeladapter.cpp
+
+HEADERS += ../../common/datamodel.h \
+           ../../common/stringpool.h \
+           ../../common/uuid.h \
+           ../../hmi_tester/datamodeladapter.h \
+           ../../hmi_tester/binarydatamodeladapter.h \
+           ../../hmi_tester/caseworkers.h \
+           ../../hmi_tester/compresseddatamodeladapter.h \
+           ../../qt_linux_hmi_tester/xmldatamodeladapter.h
+
+LIBS += -lboost_thread -lboost_system -lboost_serialization -lz
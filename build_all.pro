@@ -44,3 +44,8 @@ SUBDIRS += testbench/web
 testbench/web.file = testbench/web/fancybrowser.pro
 
 
+SUBDIRS += benchmark/codecbench
+SUBDIRS += benchmark/commbench
+SUBDIRS += benchmark/casebench
+SUBDIRS += benchmark/xmlbench
+SUBDIRS += benchmark/zbench
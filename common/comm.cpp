@@ -25,39 +25,73 @@
 
 #include <iostream>
 #include <cassert>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <sstream>
+#include <protocol.h>
+#include <testitemcodec.h>
 #include <ohtbaseconfig.h>
 #include <debug.h>
+#include <QThread>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
 
 
 /// ///////////////////////////////////////////
 /// /// ComMANAGER ////////////////////////////
 /// ///////////////////////////////////////////
 
-Comm::Comm (int port, bool isServer)
+Comm::Comm (const Transport::Endpoint& endpoint, bool isServer)
 {
-    _port = port;
+    _endpoint = endpoint;
     _isServer = isServer;
+    pendingLimit_ = PENDING_QUEUE_LIMIT;
+    overflowPolicy_ = BLOCK;
 }
 
+void Comm::setPendingLimit ( size_t limit, OverflowPolicy policy )
+{
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+    pendingLimit_ = limit;
+    overflowPolicy_ = policy;
+    pendingRoom_.notify_all();
+}
 
 
+
+Transport::Endpoint Comm::endpoint() const
+{
+    if (mcs_.get())
+        return mcs_->endpoint();
+    return _endpoint;
+}
+
 bool Comm::resetAndStart()
 {
-    //creating the client/server
-    mcs_.reset (new MessageClientServer ( this, _port, _isServer ));
+    //creating the client/server (the old one releases the endpoint first)
+    mcs_.reset ();
+    mcs_.reset (new MessageClientServer ( this, _endpoint, _isServer ));
 
     //connecting to its signals
     connect ( this, SIGNAL ( sendMessage ( const QString & ) ),
               mcs_.get(), SLOT ( writeMessage ( const QString& ) ) );
-    connect ( mcs_.get(), SIGNAL ( receivedMessage ( const QString & ) ),
-              this, SLOT ( handleReceivedMessage ( const QString & ) ) );
-    connect ( mcs_.get(), SIGNAL ( newClientConnected() ),
-              this, SLOT ( handleNewClientConnected() ) );
-    connect ( mcs_.get(), SIGNAL ( clientDisconnected() ),
-              this, SLOT ( handleClientDisconnected() ) );
+    //the server is fed from several threads: its frames always go
+    //through the event queue, so they are written in the order they
+    //were encoded (the dictionaries depend on it)
+    Qt::ConnectionType frameConnection = _isServer ? Qt::QueuedConnection : Qt::AutoConnection;
+    connect ( this, SIGNAL ( sendFrame ( int, int, uint, const QByteArray & ) ),
+              mcs_.get(), SLOT ( writeFrame ( int, int, uint, const QByteArray& ) ),
+              frameConnection );
+    connect ( this, SIGNAL ( sendFrames ( int, const QByteArray & ) ),
+              mcs_.get(), SLOT ( writeFrames ( int, const QByteArray& ) ),
+              frameConnection );
+    connect ( mcs_.get(), SIGNAL ( receivedMessage ( int, const QString & ) ),
+              this, SLOT ( handleReceivedMessage ( int, const QString & ) ) );
+    connect ( mcs_.get(), SIGNAL ( receivedFrame ( int, int, uint, const QByteArray & ) ),
+              this, SLOT ( handleReceivedFrame ( int, int, uint, const QByteArray & ) ) );
+    connect ( mcs_.get(), SIGNAL ( newClientConnected ( int ) ),
+              this, SLOT ( handleNewClientConnected ( int ) ) );
+    connect ( mcs_.get(), SIGNAL ( clientDisconnected ( int ) ),
+              this, SLOT ( handleClientDisconnected ( int ) ) );
 
     //connecting to error management
     connect ( mcs_.get(), SIGNAL ( error ( const QString& ) ),
@@ -66,16 +100,39 @@ bool Comm::resetAndStart()
     //if it is a server...
     if ( _isServer )
     {
-        DEBUG(D_COMM,"(Comm::Comm) Created new message server on port " << _port);
+        DEBUG(D_COMM,"(Comm::Comm) Created new message server on " << endpoint().toString());
     }
     //if it is a client...
     else
     {
-        DEBUG(D_COMM,"(Comm::Comm) Created new client on port " << _port);
+        DEBUG(D_COMM,"(Comm::Comm) Created new client on " << _endpoint.toString());
     }
 
-    clientConnected_ = false;
-    testItemQueue_.clear();
+    {
+        boost::recursive_mutex::scoped_lock lock(queueMutex_);
+        clients_.clear();
+        processKeys_.clear();
+        processCount_.clear();
+        _clearQueue();
+        sentStrings_.clear();
+        receivedStrings_.clear();
+    }
+
+    if (!mcs_->isStarted())
+    {
+        DEBUG(D_ERROR,"(Comm::resetAndStart) Unable to start the comm on " << _endpoint.toString());
+        return false;
+    }
+
+    //the client names its process before sending anything else
+    if (!_isServer)
+    {
+        QString name = QCoreApplication::instance() ?
+                    QFileInfo ( QCoreApplication::applicationFilePath() ).fileName() :
+                    QString();
+        emit sendFrame ( ALL_CLIENTS, Protocol::MSG_PROCESS, 0,
+                         name.isEmpty() ? QByteArray ( "process" ) : name.toUtf8() );
+    }
 
     DEBUG(D_COMM,"(Comm::Comm) COMM STARTED");
 
@@ -87,8 +144,15 @@ bool Comm::resetAndStart()
 bool Comm::stop()
 {
     mcs_.reset(0);
-    clientConnected_ = false;
-    testItemQueue_.clear();
+    {
+        boost::recursive_mutex::scoped_lock lock(queueMutex_);
+        clients_.clear();
+        processKeys_.clear();
+        processCount_.clear();
+        _clearQueue();
+        sentStrings_.clear();
+        receivedStrings_.clear();
+    }
 
     DEBUG(D_COMM,"(Comm::Comm) COMM STOPED");
     return true;
@@ -114,87 +178,310 @@ void Comm::handleSendMessage ( const std::string &s )
 /// send message handler
 ///
 void Comm::handleSendTestItem (const DataModel::TestItem& ti)
+{
+    handleSendTestItem(ti, 0);
+}
+
+void Comm::handleSendTestItem (const DataModel::TestItem& ti, uint sequence)
+{
+    handleSendTestItem(ti, sequence, ALL_CLIENTS);
+}
+
+void Comm::handleSendTestItem (const DataModel::TestItem& ti, uint sequence, int client)
 {
     DEBUG(D_COMM,"(Comm::handleSendTestItem)");
 
-    // If the client is not connected, store the event
-    if (_isServer && !clientConnected_)
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+
+    // If the client is not connected, store the frame. The queued
+    // items are self-contained, as their client is not known yet.
+    while (_isServer && !_isConnected(client))
+    {
+        std::string data;
+        Protocol::TestItemCodec::encode(ti, data);
+        size_t size = Protocol::FRAME_HEADER_SIZE + data.size();
+        if (pendingData_.size() + size <= pendingLimit_)
+        {
+            _queueFrame(client, sequence, data);
+            DEBUG(D_COMM,"(Comm::handleSendTestItem) Item in the queue.");
+            return;
+        }
+        // the queue is full
+        if (!_handleOverflow(lock, size))
+            return;
+    }
+
+    // encode the item with the dictionary of each connection, in
+    // the order the frames are sent
+    std::vector<int> targets;
+    if (!_isServer)
+        targets.push_back(0);
+    else if (client == ALL_CLIENTS)
+        targets.assign(clients_.begin(), clients_.end());
+    else
+        targets.push_back(client);
+
+    for (size_t i = 0; i < targets.size(); i++)
     {
-        testItemQueue_.push_back(ti);
-        DEBUG(D_COMM,"(Comm::handleSendTestItem) Item in the queue.");
+        std::string data;
+        Protocol::TestItemCodec::encode(ti, sentStrings_[targets[i]], data);
+        emit sendFrame ( _isServer ? targets[i] : ALL_CLIENTS, Protocol::MSG_TEST_ITEM,
+                         sequence, QByteArray ( data.data(), data.size() ) );
+    }
+
+    DEBUG(D_COMM,"(Comm::handleSendTestItem) Item sent.");
+}
+
+///
+/// pending queue
+///
+bool Comm::_isConnected ( int client ) const
+{
+    return client == ALL_CLIENTS ? !clients_.empty() : clients_.count(client) > 0;
+}
+
+bool Comm::_handleOverflow ( boost::recursive_mutex::scoped_lock& lock, size_t size )
+{
+    // an item that never fits
+    bool rejected = size > pendingLimit_;
+
+    if (!rejected && overflowPolicy_ == DROP_OLDEST)
+    {
+        while (pendingData_.size() + size > pendingLimit_)
+            _dropOldestFrame();
+        DEBUG(D_COMM,"(Comm::_handleOverflow) Oldest items dropped.");
+    }
+    else if (!rejected && overflowPolicy_ == BLOCK &&
+             QThread::currentThread() != thread())
+    {
+        // wait for a client to take the queue, then try again
+        DEBUG(D_COMM,"(Comm::_handleOverflow) Waiting for room in the queue.");
+        rejected = !pendingRoom_.timed_wait(lock,
+                        boost::posix_time::milliseconds(PENDING_BLOCK_TIMEOUT));
     }
     else
+        rejected = true;
+
+    if (rejected)
+    {
+        DEBUG(D_ERROR,"(Comm::_handleOverflow) Pending queue full, item dropped.");
+        emit error ( "(Comm::_handleOverflow) Pending queue full, item dropped." );
+    }
+    return !rejected;
+}
+
+void Comm::_queueFrame ( int client, uint sequence, const std::string& payload )
+{
+    char header[Protocol::FRAME_HEADER_SIZE];
+    Protocol::writeHeader ( header, Protocol::MSG_TEST_ITEM, payload.size(), sequence );
+    pendingData_.addData ( header, Protocol::FRAME_HEADER_SIZE );
+    pendingData_.addData ( payload.data(), payload.size() );
+
+    PendingFrame f;
+    f.size = Protocol::FRAME_HEADER_SIZE + payload.size();
+    f.client = client;
+    pendingFrames_.push_back(f);
+}
+
+void Comm::_dropOldestFrame()
+{
+    pendingData_.consume ( pendingFrames_.front().size );
+    pendingFrames_.pop_front();
+}
+
+void Comm::_clearQueue()
+{
+    pendingFrames_.clear();
+    pendingData_.clear();
+    pendingRoom_.notify_all();
+}
+
+void Comm::dropClientItems()
+{
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+
+    //the frames for all the clients are moved to the end, keeping
+    //their order
+    size_t count = pendingFrames_.size();
+    size_t dropped = 0;
+    for (size_t i = 0; i < count; i++)
     {
-        // This step wouldn't be neccessary when we use correct sockets as streams
-        std::ostringstream oss;
-        // Create the test archive using a string as a buffer
-        boost::archive::text_oarchive oa(oss);
-        // write class instance to archive
-        oa << ti;
-        DEBUG(D_COMM,"(Comm::handleSendTestItem) Item serialized.");
+        PendingFrame f = pendingFrames_.front();
+        pendingFrames_.pop_front();
+        if (f.client == ALL_CLIENTS)
+        {
+            QByteArray keep ( pendingData_.peek ( f.size ), f.size );
+            pendingData_.consume ( f.size );
+            pendingData_.addData ( keep );
+            pendingFrames_.push_back ( f );
+        }
+        else
+        {
+            pendingData_.consume ( f.size );
+            dropped++;
+        }
+    }
 
-        emit sendMessage ( QString(oss.str().c_str()) );
+    if (dropped)
+    {
+        pendingRoom_.notify_all();
+        DEBUG(D_COMM,"(Comm::dropClientItems) " << dropped << " queued items dropped.");
+    }
+}
 
-        DEBUG(D_COMM,"(Comm::handleSendTestItem) Item sent.");
+bool Comm::isConnected ( int client ) const
+{
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+    return _isConnected(client);
+}
+
+std::string Comm::processKey ( int client ) const
+{
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+    std::map<int, std::string>::const_iterator it = processKeys_.find(client);
+    return it != processKeys_.end() ? it->second : std::string();
+}
+
+bool Comm::processClient ( const std::string& key, int& client ) const
+{
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+    std::map<int, std::string>::const_iterator it;
+    for (it = processKeys_.begin(); it != processKeys_.end(); ++it)
+    {
+        if (it->second == key)
+        {
+            client = it->first;
+            return true;
+        }
     }
+    return false;
+}
+
+void Comm::_nameProcess ( int client, const QByteArray& name )
+{
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+    if (!clients_.count(client) || processKeys_.count(client))
+        return;
+
+    std::string exe ( name.constData(), name.size() );
+    std::string key = exe + "#" + boost::lexical_cast<std::string>(processCount_[exe]++);
+    processKeys_[client] = key;
+    DEBUG(D_COMM,"(Comm::_nameProcess) Client " << client << " is " << key);
+}
+
+void Comm::_resetDictionaries ( int client )
+{
+    // a new connection starts with empty dictionaries on both sides
+    sentStrings_.erase(client);
+    receivedStrings_.erase(client);
 }
 
 
 ///
 /// new received message handler
 ///
-void Comm::handleReceivedMessage ( const QString &s )
+void Comm::handleReceivedMessage ( int, const QString &s )
 {
-    //emit receivedMessage ( s );
-    //redirect to received test item
+    //plain text messages are forwarded as they are
+    emit receivedMessage ( s );
+}
 
-    //DEBUG(D_COMM, "(Comm::handleReceivedMessage) Deserializing data.");
-    //DEBUG(D_COMM, "(Comm::handleReceivedMessage) Data: " << s.toStdString());
+///
+/// new received frame handler
+///
+void Comm::handleReceivedFrame ( int client, int type, uint sequence, const QByteArray &payload )
+{
+    if (type == Protocol::MSG_PROCESS && _isServer)
+    {
+        _nameProcess ( client, payload );
+        return;
+    }
+    if (type != Protocol::MSG_TEST_ITEM)
+    {
+        DEBUG(D_ERROR, "(Comm::handleReceivedFrame) Unknown message type " << type << ".");
+        return;
+    }
 
-    //This pass wouldn't be neccessary when we use correct sockets as streams
-    std::istringstream iss (s.toStdString());
-    // Create the test archive using a string as a buffer
-    boost::archive::text_iarchive ia(iss);
-    // write class instance to archive
-    DataModel::TestItem* ti = new DataModel::TestItem();
-    ia >> *ti;
+    //DEBUG(D_COMM, "(Comm::handleReceivedFrame) Decoding data.");
 
-    DEBUG(D_COMM, "(Comm::handleReceivedMessage) Emiting new received TestItem.");
+    DataModel::TestItemPtr ti = boost::make_shared<DataModel::TestItem>();
+    if (!Protocol::TestItemCodec::decode(payload.constData(), payload.size(),
+                                         receivedStrings_[client], *ti))
+    {
+        DEBUG(D_ERROR, "(Comm::handleReceivedFrame) Malformed TestItem received.");
+        emit error ( "(Comm::handleReceivedFrame) Malformed TestItem received." );
+        return;
+    }
+
+    DEBUG(D_COMM, "(Comm::handleReceivedFrame) Emiting new received TestItem.");
 
     //emit new received Test Item
-    emit receivedTestItem ( ti );
+    emit receivedTestItem ( ti, sequence, client );
 }
 
 ///
 ///handles the new client connection
 ///
-void Comm::handleNewClientConnected()
+void Comm::handleNewClientConnected ( int client )
 {
-    DEBUG(D_COMM,"(Comm::handleNewClientConnected)");
-    assert(clientConnected_ == false);//FIXME remove this assert
-    clientConnected_ = true;
-
-    //checks if there are stored items to be sent
-    if (!testItemQueue_.size())
-        return;
-    do
+    DEBUG(D_COMM,"(Comm::handleNewClientConnected) Client " << client);
+
+    boost::recursive_mutex::scoped_lock lock(queueMutex_);
+    clients_.insert(client);
+    _resetDictionaries(client);
+
+    //the handlers may send the current state to the new client,
+    //before the items queued for it
+    emit clientConnected ( client );
+
+    //checks if there are stored items to be sent: the ones for
+    //this client, and the ones sent when nobody was connected.
+    //The others are moved to the end, keeping their order.
+    QByteArray frames;
+    frames.reserve ( pendingData_.size() );
+    size_t count = pendingFrames_.size();
+    for (size_t i = 0; i < count; i++)
     {
-        handleSendTestItem(testItemQueue_.front());
-        testItemQueue_.pop_front();
-        DEBUG(D_COMM,"(Comm::handleNewClientConnected) One stored TestItem sent.");
-    } while(testItemQueue_.size());
+        PendingFrame f = pendingFrames_.front();
+        pendingFrames_.pop_front();
+        const char* data = pendingData_.peek ( f.size );
+
+        if (f.client == client || f.client == ALL_CLIENTS)
+        {
+            frames.append ( data, f.size );
+            pendingData_.consume ( f.size );
+        }
+        else
+        {
+            QByteArray keep ( data, f.size );
+            pendingData_.consume ( f.size );
+            pendingData_.addData ( keep );
+            pendingFrames_.push_back ( f );
+        }
+    }
 
-    DEBUG(D_COMM,"(Comm::handleNewClientConnected) Stored TestItems sent.");
+    //all of them in a single write
+    if (frames.size())
+    {
+        emit sendFrames ( client, frames );
+        pendingRoom_.notify_all();
+        DEBUG(D_COMM,"(Comm::handleNewClientConnected) Stored TestItems sent, "
+              << frames.size() << " bytes.");
+    }
 }
 
-void Comm::handleClientDisconnected()
+void Comm::handleClientDisconnected ( int client )
 {
-    DEBUG(D_COMM,"(Comm::handleClientDisconnected)");
-    assert(clientConnected_ == true);//FIXME remove this assert
+    DEBUG(D_COMM,"(Comm::handleClientDisconnected) Client " << client);
+
+    {
+        boost::recursive_mutex::scoped_lock lock(queueMutex_);
+        clients_.erase(client);
+        processKeys_.erase(client);
+        _resetDictionaries(client);
+    }
 
-    //reset comm state for the next client
-    clientConnected_ = false;
-    testItemQueue_.clear();
+    emit clientDisconnected ( client );
 }
 
 
@@ -26,10 +26,14 @@
 #include <messageclientserver.h>
 #include <datamodel.h>
 #include <utilclasses.h>
-#include <QTcpServer>
-#include <QTcpSocket>
+#include <transport.h>
+#include <testitemcodec.h>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <memory>
 #include <deque>
+#include <map>
+#include <set>
 
 
 class Comm : public QObject
@@ -38,11 +42,47 @@ class Comm : public QObject
 
 public:
 
-    Comm ( int port, bool isServer );
+    Comm ( const Transport::Endpoint& endpoint, bool isServer );
 
     bool resetAndStart();
     bool stop();
 
+    //endpoint in use, the clients have to connect to it
+    Transport::Endpoint endpoint() const;
+
+    //client id to send an item to every connected client
+    static const int ALL_CLIENTS = MessageClientServer::ALL_CLIENTS;
+
+    //what to do with an item that does not fit in the pending queue
+    typedef enum
+    {
+        BLOCK,          // wait for a client to take the queue
+        DROP_OLDEST,    // drop the oldest queued items
+        REJECT          // drop the new item and report an error
+    } OverflowPolicy;
+
+    //items sent before the client connects are kept encoded, up to
+    //limit bytes. BLOCK is only honoured for items sent from other
+    //threads, as the connections are handled in the Comm thread.
+    void setPendingLimit ( size_t limit, OverflowPolicy policy );
+
+    //drops the queued items sent to one client, the ones for all
+    //the clients stay
+    void dropClientItems();
+
+    ///
+    /// client processes (only for the server). Each client names
+    /// its process when it connects; the key of a process is its
+    /// executable name and how many processes with that name
+    /// connected before it in this session ("name#n"), so it does
+    /// not depend on the order the different programs connect.
+    ///
+    bool isConnected ( int client ) const;
+    //key of a client, empty until its process has been named
+    std::string processKey ( int client ) const;
+    //connected client with the process key, false if there is none
+    bool processClient ( const std::string& key, int& client ) const;
+
 public:
 
     MessageClientServer * messageServer();
@@ -51,33 +91,82 @@ public:
 public slots:
 
     void handleSendTestItem (const DataModel::TestItem&);
+    //sends an item tagged with a playback sequence number
+    void handleSendTestItem (const DataModel::TestItem&, uint sequence);
+    //sends an item to one client (or ALL_CLIENTS)
+    void handleSendTestItem (const DataModel::TestItem&, uint sequence, int client);
     //DataModel::TestItem* handleReceivedTestItem ( const std::string& msg );
 
     void handleSendMessage ( const QString& );//from client class (input method)
     void handleSendMessage ( const std::string& );//from client class (input method)
-    void handleReceivedMessage ( const QString& );//internal
+    void handleReceivedMessage ( int, const QString& );//internal
+    void handleReceivedFrame ( int, int, uint, const QByteArray& );//internal
 
     //handles the client connection
-    void handleNewClientConnected();
-    void handleClientDisconnected();
+    void handleNewClientConnected ( int );
+    void handleClientDisconnected ( int );
 
     //handles errors
     void handleError ( const QString& );
 
 signals:
-    void receivedTestItem (DataModel::TestItem*);
+    //the receivers share the item, and may take its data
+    void receivedTestItem (DataModel::TestItemPtr, uint sequence, int client);
     void receivedMessage ( const QString& );//to client class (output method)
     void sendMessage ( const QString& );//internal
+    void sendFrame ( int, int, uint, const QByteArray& );//internal
+    void sendFrames ( int, const QByteArray& );//internal
     void error ( const std::string& );
 
+    //client sessions (only for the server)
+    void clientConnected ( int client );
+    void clientDisconnected ( int client );
+
 private:
 
-    // Pending events to process
-    std::deque<DataModel::TestItem> testItemQueue_;
+    bool _isConnected ( int client ) const;
+    bool _handleOverflow ( boost::recursive_mutex::scoped_lock&, size_t size );
+    void _queueFrame ( int client, uint sequence, const std::string& payload );
+    void _dropOldestFrame();
+    void _clearQueue();
+    void _resetDictionaries ( int client );
+    void _nameProcess ( int client, const QByteArray& name );
+
+    // Pending frames to send, encoded one after the other in pendingData_
+    typedef struct
+    {
+        int size;
+        int client;
+    } PendingFrame;
+    std::deque<PendingFrame> pendingFrames_;
+    QCircularByteArray_ pendingData_;
+
+    size_t pendingLimit_;
+    OverflowPolicy overflowPolicy_;
+
+    // Items may be sent from the playback thread, this protects
+    // the queue and the client set. Recursive, as the clientConnected
+    // handlers send items.
+    mutable boost::recursive_mutex queueMutex_;
+    boost::condition_variable_any pendingRoom_;
+
     std::auto_ptr<MessageClientServer> mcs_;
     bool _isServer;
-    int _port;
-    bool clientConnected_;
+    Transport::Endpoint _endpoint;
+    std::set<int> clients_;
+
+    // process keys of the connected clients, and how many processes
+    // of each executable connected in this session (queueMutex_)
+    std::map<int, std::string> processKeys_;
+    std::map<std::string, int> processCount_;
+
+    // strings already sent to and received from each client (the
+    // client side uses the one of its connection, 0). The ones sent
+    // are protected by queueMutex_, the received ones are only used
+    // in the Comm thread.
+    typedef std::map<int, Protocol::TestItemCodec::Dictionary> DictionaryMap;
+    DictionaryMap sentStrings_;
+    DictionaryMap receivedStrings_;
 };
 
 
@@ -22,18 +22,30 @@ LIBS += -lboost_thread -lboost_system -lboost_serialization
 
 
 SOURCES += datamodel.cpp \
+           stringpool.cpp \
            comm.cpp \
            messageclientserver.cpp \
            utilclasses.cpp \
            uuid.cpp \
-           controlsignaling.cpp
+           controlsignaling.cpp \
+           protocol.cpp \
+           testitemcodec.cpp \
+           transport.cpp \
+           sockettransport.cpp \
+           shmtransport.cpp
 
 HEADERS += datamodel.h \
+           stringpool.h \
            comm.h \
            messageclientserver.h \
            utilclasses.h \
            uuid.h \
            controlsignaling.h \
+           protocol.h \
+           testitemcodec.h \
+           transport.h \
+           sockettransport.h \
+           shmtransport.h \
            ohtbaseconfig.h \
            debug.h
 
@@ -23,6 +23,7 @@
 
 #include "datamodel.h"
 
+#include <boost/atomic.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 #include <algorithm>
@@ -31,6 +32,9 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/lexical_cast/try_lexical_convert.hpp>
+#include <iomanip>
+#include <locale>
 #include <sstream>
 #include <debug.h>
 
@@ -41,6 +45,7 @@ using namespace DataModel;
 ///
 
 TestSuite::TestSuite()
+    : indexed_ (false)
 {
 }
 
@@ -57,6 +62,8 @@ TestSuite::testCases() const
 void
 TestSuite::addTestCase(DataModel::TestCase* ti)
 {
+    if (indexed_)
+        ti->setIndexed(true);
     testCases_.push_back(ti);
     tcMap_.insert (std::make_pair (ti->name(), ti));
 }
@@ -65,6 +72,8 @@ void
 TestSuite::addTestCase(TestCaseList::iterator pos,
                        DataModel::TestCase* ti)
 {
+    if (indexed_)
+        ti->setIndexed(true);
     testCases_.insert(pos, ti);
     tcMap_.insert (std::make_pair (ti->name(), ti));
 }
@@ -73,8 +82,9 @@ void
 TestSuite::deleteTestCase(TestCaseList::iterator ti) throw (not_found)
 {
     try {
-        testCases_.erase(ti);
+        suiteIndex_.remove(&*ti);
         tcMap_.erase (ti->name());
+        testCases_.erase(ti);
     } catch (...) {
         throw not_found();
     }
@@ -114,9 +124,10 @@ void TestSuite::deleteTestCase(const std::string& name) throw (not_found)
     TestCaseList::iterator it2 =
             std::find_if (testCases_.begin(),
                           testCases_.end(),
-                          bind<bool> (std::equal_to<uuid_t>(),
-                                      bind<uuid_t> (&TestCase::uuid, _1),
-                                      id));
+                          boost::lambda::bind<bool> (std::equal_to<uuid_t>(),
+                                                     boost::lambda::bind<uuid_t> (&TestCase::uuid, _1),
+                                                     id));
+    suiteIndex_.remove(&*it2);
     testCases_.erase (it2);
 }
 
@@ -178,6 +189,166 @@ size_t TestSuite::count() const
     return testCases_.size();
 }
 
+static bool loadedBefore(const TestCase* a, const TestCase* b)
+{
+    return a->lastLoad() < b->lastLoad();
+}
+
+void TestSuite::unloadTestCases(size_t budget,
+                                const std::set<const TestCase*>& keep)
+{
+    size_t used = 0;
+    std::vector<TestCase*> candidates;
+    for (TestCaseList::iterator it = testCases_.begin(); it != testCases_.end(); ++it)
+    {
+        if (!it->loader() || !it->loaded())
+            continue;
+        used += it->loadedBytes();
+        if (!it->modified() && keep.find(&*it) == keep.end())
+            candidates.push_back(&*it);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), loadedBefore);
+    for (size_t i = 0; i < candidates.size() && used > budget; i++)
+    {
+        size_t bytes = candidates[i]->loadedBytes();
+        if (candidates[i]->unload())
+        {
+            DEBUG(D_BOTH, "(TestSuite::unloadTestCases) Unloaded " << candidates[i]->name());
+            used -= bytes;
+        }
+    }
+}
+
+size_t TestSuite::loadedBytes() const
+{
+    size_t used = 0;
+    for (TestCaseList::const_iterator it = testCases_.begin(); it != testCases_.end(); ++it)
+        if (it->loader())
+            used += it->loadedBytes();
+    return used;
+}
+
+namespace
+{
+    struct WidgetQuery
+    {
+        std::string widget;
+        TestCase::Positions operator()(const TestCase& tc) const
+        {
+            return tc.itemsOnWidget(widget);
+        }
+    };
+
+    struct TypeQuery
+    {
+        int type;
+        TestCase::Positions operator()(const TestCase& tc) const
+        {
+            return tc.itemsOfType(type);
+        }
+    };
+}
+
+TestSuite::CaseMatches TestSuite::findWidget(const std::string& widget)
+{
+    WidgetQuery query;
+    query.widget = widget;
+    if (!indexed_)
+        return _find(query);
+
+    //the widgets of the indexed cases are in the pool
+    _refreshIndex();
+    InternedString interned = StringPool::find(widget);
+    if (!interned)
+        return CaseMatches();
+    return _findIndexed(suiteIndex_.byWidget(interned), query);
+}
+
+TestSuite::CaseMatches TestSuite::findType(int type)
+{
+    TypeQuery query;
+    query.type = type;
+    if (!indexed_)
+        return _find(query);
+
+    _refreshIndex();
+    return _findIndexed(suiteIndex_.byType(type), query);
+}
+
+TestSuite::CaseMatches
+TestSuite::_find(const boost::function<TestCase::Positions (const TestCase&)>& query)
+{
+    CaseMatches matches;
+    for (TestCaseList::iterator it = testCases_.begin(); it != testCases_.end(); ++it)
+    {
+        //the unloaded cases are read one at a time
+        bool loaded = it->loaded();
+        if (!it->load())
+        {
+            DEBUG(D_ERROR, "(TestSuite::_find) TestCase " << it->name() << " not loaded.");
+            continue;
+        }
+
+        TestCase::Positions positions = query(*it);
+        if (!positions.empty())
+            matches.push_back(std::make_pair(&*it, positions));
+
+        if (!loaded)
+            it->unload();
+    }
+    return matches;
+}
+
+TestSuite::CaseMatches
+TestSuite::_findIndexed(const SuiteIndex::Cases& cases,
+                        const boost::function<TestCase::Positions (const TestCase&)>& query) const
+{
+    //the cases keep their index while unloaded, nothing is read
+    CaseMatches matches;
+    if (cases.empty())
+        return matches;
+    for (TestCaseList::const_iterator it = testCases_.begin(); it != testCases_.end(); ++it)
+    {
+        if (cases.find(&*it) == cases.end())
+            continue;
+        TestCase::Positions positions = query(*it);
+        if (!positions.empty())
+            matches.push_back(std::make_pair(&*it, positions));
+    }
+    return matches;
+}
+
+void TestSuite::_refreshIndex()
+{
+    for (TestCaseList::iterator it = testCases_.begin(); it != testCases_.end(); ++it)
+    {
+        if (suiteIndex_.current(*it))
+            continue;
+
+        //only the cases never indexed are read, once
+        bool loaded = it->loaded();
+        if (!it->indexReady() && !it->load())
+        {
+            DEBUG(D_ERROR, "(TestSuite::_refreshIndex) TestCase " << it->name() << " not loaded.");
+            continue;
+        }
+
+        suiteIndex_.update(*it);
+
+        if (!loaded)
+            it->unload();
+    }
+}
+
+void TestSuite::setIndexed(bool b)
+{
+    indexed_ = b;
+    suiteIndex_.clear();
+    for (TestCaseList::iterator it = testCases_.begin(); it != testCases_.end(); ++it)
+        it->setIndexed(b);
+}
+
 std::string TestSuite::appId() const
 {
     return appId_;
@@ -199,13 +370,405 @@ void TestSuite::name(const std::string& s)
 }
 
 
+///
+/// test item list
+///
+
+TestItemList::TestItemList()
+    : used_(ARENA_CHUNK)
+{
+}
+
+TestItemList::TestItemList(const TestItemList& l)
+    : used_(ARENA_CHUNK)
+{
+    *this = l;
+}
+
+TestItemList&
+TestItemList::operator=(const TestItemList& l)
+{
+    if (this != &l)
+    {
+        clear();
+        order_.reserve(l.size());
+        for (const_iterator it = l.begin(); it != l.end(); ++it)
+            push_back(*it);
+    }
+    return *this;
+}
+
+TestItemList::~TestItemList()
+{
+    clear();
+    for (size_t i = 0; i < chunks_.size(); i++)
+        ::operator delete(chunks_[i]);
+}
+
+TestItemList::iterator
+TestItemList::begin()
+{
+    return order_.begin();
+}
+
+TestItemList::iterator
+TestItemList::end()
+{
+    return order_.end();
+}
+
+TestItemList::const_iterator
+TestItemList::begin() const
+{
+    return order_.begin();
+}
+
+TestItemList::const_iterator
+TestItemList::end() const
+{
+    return order_.end();
+}
+
+size_t
+TestItemList::size() const
+{
+    return order_.size();
+}
+
+bool
+TestItemList::empty() const
+{
+    return order_.empty();
+}
+
+TestItemList::iterator
+TestItemList::insert(iterator pos, const TestItem& ti)
+{
+    TestItem* item = _allocate(ti);
+    try {
+        return order_.insert(pos.base(), item);
+    } catch (...) {
+        _release(item);
+        throw;
+    }
+}
+
+void
+TestItemList::push_back(const TestItem& ti)
+{
+    insert(end(), ti);
+}
+
+TestItemList::iterator
+TestItemList::take(iterator pos, TestItem& ti)
+{
+    TestItem* item = _take(ti);
+    try {
+        return order_.insert(pos.base(), item);
+    } catch (...) {
+        _release(item);
+        throw;
+    }
+}
+
+void
+TestItemList::take_back(TestItem& ti)
+{
+    take(end(), ti);
+}
+
+TestItemList::iterator
+TestItemList::erase(iterator pos)
+{
+    _release(*pos.base());
+    return order_.erase(pos.base());
+}
+
+void
+TestItemList::clear()
+{
+    for (Order::iterator it = order_.begin(); it != order_.end(); ++it)
+        (*it)->~TestItem();
+    order_.clear();
+
+    //the chunks are kept for the next items
+    free_.clear();
+    used_ = chunks_.empty() ? ARENA_CHUNK : 0;
+    if (chunks_.size() > 1)
+    {
+        for (size_t i = 1; i < chunks_.size(); i++)
+            ::operator delete(chunks_[i]);
+        chunks_.resize(1);
+    }
+}
+
+void
+TestItemList::reset()
+{
+    clear();
+    for (size_t i = 0; i < chunks_.size(); i++)
+        ::operator delete(chunks_[i]);
+    chunks_.clear();
+    Order().swap(order_);
+    std::vector<TestItem*>().swap(free_);
+    used_ = ARENA_CHUNK;
+}
+
+size_t
+TestItemList::arenaBytes() const
+{
+    return chunks_.size() * ARENA_CHUNK * sizeof(TestItem);
+}
+
+void*
+TestItemList::_slot()
+{
+    void* slot;
+    if (!free_.empty())
+    {
+        slot = free_.back();
+        free_.pop_back();
+    }
+    else
+    {
+        if (used_ == ARENA_CHUNK)
+        {
+            chunks_.push_back(static_cast<char*>(::operator new(ARENA_CHUNK * sizeof(TestItem))));
+            used_ = 0;
+        }
+        slot = chunks_.back() + used_ * sizeof(TestItem);
+        used_++;
+    }
+    return slot;
+}
+
+TestItem*
+TestItemList::_allocate(const TestItem& ti)
+{
+    void* slot = _slot();
+    try {
+        return new (slot) TestItem(ti);
+    } catch (...) {
+        free_.push_back(static_cast<TestItem*>(slot));
+        throw;
+    }
+}
+
+TestItem*
+TestItemList::_take(TestItem& ti)
+{
+    void* slot = _slot();
+    TestItem* item;
+    try {
+        item = new (slot) TestItem();
+    } catch (...) {
+        free_.push_back(static_cast<TestItem*>(slot));
+        throw;
+    }
+    item->take(&ti);
+    return item;
+}
+
+void
+TestItemList::_release(TestItem* ti)
+{
+    ti->~TestItem();
+    free_.push_back(ti);
+}
+
+///
+/// item index
+///
+
+static const FieldKey widgetKey = fieldKey(WIDGET_DATA);
+
+// the widget path of the item, 0 if it has none
+static InternedString itemWidget(const TestItem& ti)
+{
+    const FieldValue* f = ti.field(widgetKey);
+    if (f && f->interned())
+        return f->interned();
+    if (f)
+        return StringPool::intern(f->toString());
+
+    try {
+        return StringPool::intern(ti.getData(WIDGET_DATA));
+    } catch (not_found&) {
+        return 0;
+    }
+}
+
+ItemIndex::ItemIndex()
+    : valid_ (true)
+{
+}
+
+void ItemIndex::clear()
+{
+    widgets_.clear();
+    types_.clear();
+    times_.clear();
+    valid_ = true;
+}
+
+void ItemIndex::append(const TestItem& ti)
+{
+    size_t pos = times_.size();
+
+    InternedString widget = itemWidget(ti);
+    if (widget)
+        widgets_[widget].push_back(pos);
+    types_[ti.type()].push_back(pos);
+
+    long long start = times_.empty() ? 0 : times_.back();
+    times_.push_back(start + ti.timestamp());
+}
+
+void ItemIndex::rebuild(const TestItemList& items)
+{
+    clear();
+    times_.reserve(items.size());
+    for (TestItemList::const_iterator it = items.begin(); it != items.end(); ++it)
+        append(*it);
+}
+
+void ItemIndex::invalidate()
+{
+    valid_ = false;
+}
+
+bool ItemIndex::valid() const
+{
+    return valid_;
+}
+
+size_t ItemIndex::size() const
+{
+    return times_.size();
+}
+
+const ItemIndex::Positions& ItemIndex::byWidget(InternedString widget) const
+{
+    static const Positions none;
+    WidgetMap::const_iterator it = widgets_.find(widget);
+    return it != widgets_.end() ? it->second : none;
+}
+
+const ItemIndex::Positions& ItemIndex::byType(int type) const
+{
+    static const Positions none;
+    TypeMap::const_iterator it = types_.find(type);
+    return it != types_.end() ? it->second : none;
+}
+
+size_t ItemIndex::atTime(long long ms) const
+{
+    return std::lower_bound(times_.begin(), times_.end(), ms) - times_.begin();
+}
+
+long long ItemIndex::duration() const
+{
+    return times_.empty() ? 0 : times_.back();
+}
+
+void ItemIndex::keys(std::vector<InternedString>& widgets,
+                     std::vector<int>& types) const
+{
+    widgets.clear();
+    widgets.reserve(widgets_.size());
+    for (WidgetMap::const_iterator it = widgets_.begin(); it != widgets_.end(); ++it)
+        widgets.push_back(it->first);
+
+    types.clear();
+    types.reserve(types_.size());
+    for (TypeMap::const_iterator it = types_.begin(); it != types_.end(); ++it)
+        types.push_back(it->first);
+}
+
+///
+/// suite index
+///
+
+void SuiteIndex::clear()
+{
+    entries_.clear();
+    widgets_.clear();
+    types_.clear();
+}
+
+void SuiteIndex::update(const TestCase& tc)
+{
+    remove(&tc);
+
+    Entry& entry = entries_[&tc];
+    entry.revision = tc.revision();
+    tc.indexKeys(entry.widgets, entry.types);
+    for (size_t i = 0; i < entry.widgets.size(); i++)
+        widgets_[entry.widgets[i]].insert(&tc);
+    for (size_t i = 0; i < entry.types.size(); i++)
+        types_[entry.types[i]].insert(&tc);
+}
+
+void SuiteIndex::remove(const TestCase* tc)
+{
+    EntryMap::iterator it = entries_.find(tc);
+    if (it == entries_.end())
+        return;
+
+    const Entry& entry = it->second;
+    for (size_t i = 0; i < entry.widgets.size(); i++)
+    {
+        WidgetMap::iterator w = widgets_.find(entry.widgets[i]);
+        w->second.erase(tc);
+        if (w->second.empty())
+            widgets_.erase(w);
+    }
+    for (size_t i = 0; i < entry.types.size(); i++)
+    {
+        TypeMap::iterator t = types_.find(entry.types[i]);
+        t->second.erase(tc);
+        if (t->second.empty())
+            types_.erase(t);
+    }
+    entries_.erase(it);
+}
+
+bool SuiteIndex::current(const TestCase& tc) const
+{
+    EntryMap::const_iterator it = entries_.find(&tc);
+    return it != entries_.end() && it->second.revision == tc.revision();
+}
+
+const SuiteIndex::Cases& SuiteIndex::byWidget(InternedString widget) const
+{
+    static const Cases none;
+    WidgetMap::const_iterator it = widgets_.find(widget);
+    return it != widgets_.end() ? it->second : none;
+}
+
+const SuiteIndex::Cases& SuiteIndex::byType(int type) const
+{
+    static const Cases none;
+    TypeMap::const_iterator it = types_.find(type);
+    return it != types_.end() ? it->second : none;
+}
+
 ///
 /// test case
 ///
 
+// order of the test case loads, to unload the oldest first (the
+// suite writers load cases from several threads)
+static boost::atomic<unsigned long> loadCounter(0);
+
 TestCase::TestCase()
-    : uuid_ (U.uuid_new())
+    : uuid_ (U.uuid_new()), indexed_ (false), loaded_ (true), modified_ (false),
+      lastLoad_ (0), revision_ (0)
 {
+    index_.offset = 0;
+    index_.length = 0;
+    index_.items = 0;
+
     // Initial name
     name_ = std::string ("TestCase (uuid ") +
             boost::lexical_cast<std::string>(uuid_) + ")";
@@ -230,33 +793,242 @@ TestCase::testItemList() const
 void
 TestCase::addTestItem(DataModel::TestItem* ti)
 {
-    testItems_.push_back(ti);
-    itemMap_.insert (std::make_pair (ti->uuid(), ti));
+    takeTestItem(*ti);
+    delete ti;
 }
 
 void
 TestCase::addTestItem(TestItemList::iterator pos,
                       DataModel::TestItem* ti)
 {
-    testItems_.insert(pos, ti);
-    itemMap_.insert (std::make_pair (ti->uuid(), ti));
+    _modify();
+    bool append = pos == testItems_.end();
+    TestItemList::iterator it = testItems_.take(pos, *ti);
+    itemMap_[ti->uuid()] = &*it;
+    delete ti;
+
+    if (!indexed_)
+        return;
+    if (append && itemIndex_.valid())
+        itemIndex_.append(*it);
+    else
+        itemIndex_.invalidate();
+}
+
+void
+TestCase::takeTestItem(DataModel::TestItem& ti)
+{
+    _modify();
+    testItems_.take_back(ti);
+    TestItem& item = *--testItems_.end();
+    itemMap_[ti.uuid()] = &item;
+
+    if (indexed_ && itemIndex_.valid())
+        itemIndex_.append(item);
 }
 
 void
 TestCase::deleteTestItem(TestItemList::iterator ti) throw (not_found)
 {
-    try {
-        testItems_.erase(ti);
-        itemMap_.erase (ti->uuid());
-    } catch (...) {
+    if (ti == testItems_.end())
         throw not_found();
-    }
+
+    _modify();
+    itemMap_.erase (ti->uuid());
+    testItems_.erase(ti);
+    itemIndex_.invalidate();
+}
+
+const DataModel::TestItem*
+TestCase::testItem(uuid_t id) const
+{
+    ItemMap::const_iterator it = itemMap_.find (id);
+    return it != itemMap_.end() ? it->second : 0;
 }
 
 size_t
 TestCase::count() const
 {
-    return testItems_.size();
+    return loaded_ ? testItems_.size() : index_.items;
+}
+
+void
+TestCase::setLoader(CaseLoaderPtr loader, const Index& index)
+{
+    loader_ = loader;
+    index_ = index;
+    modified_ = false;
+}
+
+CaseLoaderPtr
+TestCase::loader() const
+{
+    return loader_;
+}
+
+const TestCase::Index&
+TestCase::index() const
+{
+    return index_;
+}
+
+bool
+TestCase::loaded() const
+{
+    return loaded_;
+}
+
+bool
+TestCase::modified() const
+{
+    return modified_;
+}
+
+bool
+TestCase::load()
+{
+    lastLoad_ = ++loadCounter;
+    if (loaded_)
+        return true;
+
+    //the loader adds the items as if they were new. They are the
+    //ones in the index the case kept while unloaded, if any.
+    assert(loader_);
+    loaded_ = true;
+    unsigned long revision = revision_;
+    bool indexed = indexed_;
+    indexed_ = false;
+    bool ok = loader_->load(*this);
+    indexed_ = indexed;
+    revision_ = revision;
+    modified_ = false;
+    if (!ok)
+    {
+        testItems_.reset();
+        ItemMap().swap(itemMap_);
+        loaded_ = false;
+    }
+    return ok;
+}
+
+bool
+TestCase::unload()
+{
+    if (!loaded_ || !loader_ || modified_)
+        return false;
+
+    //an indexed case keeps its index, so it can be queried unloaded
+    if (!indexed_)
+        itemIndex_.clear();
+    else if (!itemIndex_.valid())
+        itemIndex_.rebuild(testItems_);
+
+    testItems_.reset();
+    ItemMap().swap(itemMap_);
+    loaded_ = false;
+    return true;
+}
+
+size_t
+TestCase::loadedBytes() const
+{
+    return loaded_ ? testItems_.arenaBytes() : 0;
+}
+
+unsigned long
+TestCase::lastLoad() const
+{
+    return lastLoad_;
+}
+
+unsigned long
+TestCase::revision() const
+{
+    return revision_;
+}
+
+void
+TestCase::setIndexed(bool b)
+{
+    indexed_ = b;
+    if (b && loaded_)
+        itemIndex_.rebuild(testItems_);
+    else if (b)
+        itemIndex_.invalidate();
+    else
+        itemIndex_ = ItemIndex();
+}
+
+bool
+TestCase::indexed() const
+{
+    return indexed_;
+}
+
+bool
+TestCase::indexReady() const
+{
+    return loaded_ || (indexed_ && itemIndex_.valid());
+}
+
+void
+TestCase::indexKeys(std::vector<InternedString>& widgets,
+                    std::vector<int>& types) const
+{
+    ItemIndex temporary;
+    _queryIndex(temporary).keys(widgets, types);
+}
+
+TestCase::Positions
+TestCase::itemsOnWidget(const std::string& widget) const
+{
+    //a widget that is not in the pool has no items
+    InternedString interned = StringPool::find(widget);
+    if (!interned)
+        return Positions();
+
+    ItemIndex temporary;
+    return _queryIndex(temporary).byWidget(interned);
+}
+
+TestCase::Positions
+TestCase::itemsOfType(int type) const
+{
+    ItemIndex temporary;
+    return _queryIndex(temporary).byType(type);
+}
+
+size_t
+TestCase::itemAtTime(long long ms) const
+{
+    ItemIndex temporary;
+    return _queryIndex(temporary).atTime(ms);
+}
+
+const ItemIndex&
+TestCase::_queryIndex(ItemIndex& temporary) const
+{
+    if (!indexed_)
+    {
+        temporary.rebuild(testItems_);
+        return temporary;
+    }
+    if (itemIndex_.valid())
+        return itemIndex_;
+    if (!loaded_)
+        return temporary;
+    itemIndex_.rebuild(testItems_);
+    return itemIndex_;
+}
+
+void
+TestCase::_modify()
+{
+    //the items that could not be read would be lost when saving
+    if (!loaded_ && !load())
+        throw not_found();
+    modified_ = true;
+    ++revision_;
 }
 
 std::string
@@ -275,11 +1047,14 @@ void
 TestCase::__syncMap()
 {
     itemMap_.clear();
+    itemMap_.reserve (testItems_.size());
 
     for (TestItemList::iterator it = testItems_.begin();
          it != testItems_.end();
          ++it)
         itemMap_.insert (std::make_pair (it->uuid(), &*it));
+    itemIndex_.invalidate();
+    ++revision_;
 }
 
 ///
@@ -305,8 +1080,7 @@ TestItem::TestItem(DataModel::TestItem* ti)
     subtype(ti->subtype());
     timestamp(ti->timestamp());
 
-    dataMap_ = ti->dataMap_;
-    metadataMap_ = ti->metadataMap_;
+    copyData(*ti);
 }
 
 
@@ -364,8 +1138,17 @@ void TestItem::copy(DataModel::TestItem* ti)
     subtype(ti->subtype());
     timestamp(ti->timestamp());
 
-    dataMap_ = ti->dataMap_;
-    metadataMap_ = ti->metadataMap_;
+    copyData(*ti);
+}
+
+void TestItem::take(DataModel::TestItem* ti)
+{
+    uuid_ = ti->uuid_;
+    type(ti->type());
+    subtype(ti->subtype());
+    timestamp(ti->timestamp());
+
+    takeData(*ti);
 }
 
 void TestItem::deepCopy(DataModel::TestItem* ti)
@@ -380,13 +1163,20 @@ void TestItem::deepCopy(DataModel::TestItem* ti)
     ///data and metadata maps
 
     DataModel::KeyValueMap::const_iterator it;
-    const DataModel::KeyValueMap& kv1 = ti->dataMap();
+    const DataModel::KeyValueMap& kv1 = ti->dataMap_;
     //data map
     for(it= kv1.begin(); it != kv1.end(); ++it)
     {
         addData(it->first, it->second);
     }
 
+    //typed fields
+    FieldList::const_iterator f;
+    for(f= ti->fields_.begin(); f != ti->fields_.end(); ++f)
+    {
+        setField(f->key, f->value);
+    }
+
     const DataModel::KeyValueMap& kv2 = ti->metadataMap();
     //metadata map
     for(it= kv2.begin(); it != kv2.end(); ++it)
@@ -396,11 +1186,189 @@ void TestItem::deepCopy(DataModel::TestItem* ti)
 }
 
 
+///
+/// typed fields
+///
+
+FieldKey DataModel::fieldKey(const std::string& name)
+{
+    return StringPool::intern(name);
+}
+
+// string value of a field, interned for the identifier keys
+// the shortest text that is read back as the same double, in the C
+// locale
+static std::string formatDouble(double d)
+{
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    for (int precision = 1; ; precision++)
+    {
+        out.str(std::string());
+        out << std::setprecision(precision) << d;
+        double parsed;
+        //nan is never equal, 17 digits always read back
+        if (precision >= 17 || d != d ||
+            (boost::conversion::try_lexical_convert(out.str(), parsed) && parsed == d))
+            return out.str();
+    }
+}
+
+static FieldValue stringValue(FieldKey key, const std::string& value)
+{
+    if (key == widgetKey)
+        return FieldValue(StringPool::intern(value));
+    return FieldValue(value);
+}
+
+FieldValue::FieldValue()
+    : type_(INT), owned_(false), i_(0)
+{
+}
+
+FieldValue::FieldValue(long long i)
+    : type_(INT), owned_(false), i_(i)
+{
+}
+
+FieldValue::FieldValue(double d)
+    : type_(DOUBLE), owned_(false), d_(d)
+{
+}
+
+FieldValue::FieldValue(bool b)
+    : type_(BOOL), owned_(false), b_(b)
+{
+}
+
+FieldValue::FieldValue(const std::string& s)
+    : type_(STRING), owned_(true), p_(new std::string(s))
+{
+}
+
+FieldValue::FieldValue(InternedString s)
+    : type_(STRING), owned_(false), p_(s)
+{
+}
+
+FieldValue::FieldValue(const FieldValue& v)
+    : type_(v.type_), owned_(v.owned_), i_(v.i_)
+{
+    if (owned_)
+        p_ = new std::string(*v.p_);
+}
+
+FieldValue& FieldValue::operator=(const FieldValue& v)
+{
+    FieldValue tmp(v);
+    swap(tmp);
+    return *this;
+}
+
+FieldValue::~FieldValue()
+{
+    if (owned_)
+        delete p_;
+}
+
+void FieldValue::swap(FieldValue& v)
+{
+    std::swap(type_, v.type_);
+    std::swap(owned_, v.owned_);
+    std::swap(i_, v.i_);
+}
+
+FieldValue::Type FieldValue::type() const
+{
+    return type_;
+}
+
+long long FieldValue::toInt() const
+{
+    switch (type_)
+    {
+    case INT: return i_;
+    case DOUBLE: return static_cast<long long>(d_);
+    case BOOL: return b_;
+    default: return boost::lexical_cast<long long>(string());
+    }
+}
+
+double FieldValue::toDouble() const
+{
+    switch (type_)
+    {
+    case INT: return static_cast<double>(i_);
+    case DOUBLE: return d_;
+    case BOOL: return b_;
+    default: return boost::lexical_cast<double>(string());
+    }
+}
+
+bool FieldValue::toBool() const
+{
+    switch (type_)
+    {
+    case INT: return i_ != 0;
+    case DOUBLE: return d_ != 0;
+    case BOOL: return b_;
+    default: return boost::lexical_cast<bool>(string());
+    }
+}
+
+std::string FieldValue::toString() const
+{
+    switch (type_)
+    {
+    case INT: return boost::lexical_cast<std::string>(i_);
+    case DOUBLE: return formatDouble(d_);
+    case BOOL: return b_ ? "1" : "0";
+    default: return string();
+    }
+}
+
+const std::string& FieldValue::string() const
+{
+    static const std::string empty;
+    return type_ == STRING ? *p_ : empty;
+}
+
+InternedString FieldValue::interned() const
+{
+    return type_ == STRING && !owned_ ? p_ : 0;
+}
+
+bool FieldValue::operator==(const FieldValue& v) const
+{
+    if (type_ != v.type_)
+        return false;
+
+    switch (type_)
+    {
+    case INT: return i_ == v.i_;
+    case DOUBLE: return d_ == v.d_;
+    case BOOL: return b_ == v.b_;
+    default: return p_ == v.p_ || *p_ == *v.p_;
+    }
+}
+
+void DataModel::swap(FieldValue& a, FieldValue& b)
+{
+    a.swap(b);
+}
+
+void DataModel::swap(Field& a, Field& b)
+{
+    std::swap(a.key, b.key);
+    a.value.swap(b.value);
+}
+
 ///
 /// test base
 ///
 
 TestBase::TestBase()
+    : viewValid_(false)
 {
 }
 
@@ -412,13 +1380,60 @@ TestBase::~TestBase()
 // Access to the data map
 const TestBase::DataMap&
 TestBase::dataMap() const
+{
+    if (fields_.empty())
+        return dataMap_;
+
+    if (!viewValid_)
+    {
+        dataView_ = dataMap_;
+        FieldList::const_iterator it;
+        for (it = fields_.begin(); it != fields_.end(); ++it)
+            dataView_[*it->key] = it->value.toString();
+        viewValid_ = true;
+    }
+    return dataView_;
+}
+
+void
+TestBase::copyDataMap(DataMap& out) const
+{
+    if (viewValid_ || fields_.empty())
+    {
+        out = dataMap();
+        return;
+    }
+
+    out = dataMap_;
+    FieldList::const_iterator it;
+    for (it = fields_.begin(); it != fields_.end(); ++it)
+        out[*it->key] = it->value.toString();
+}
+
+const TestBase::DataMap&
+TestBase::untypedData() const
 {
     return dataMap_;
 }
 
+void
+TestBase::addUntypedData(const std::string& key, const std::string& value)
+{
+    FieldList::iterator it;
+    for (it = fields_.begin(); it != fields_.end(); ++it)
+        if (*it->key == key)
+        {
+            fields_.erase(it);
+            break;
+        }
+    dataMap_[key] = value;
+    viewValid_ = false;
+}
+
 TestBase::DataMap&
 TestBase::dataMap()
 {
+    flattenFields();
     return dataMap_;
 }
 
@@ -436,15 +1451,207 @@ TestBase::metadataMap()
 
 bool TestBase::addData(const std::string& key, const std::string& value)
 {
-    return addPair(dataMap_, key, value);
+    FieldKey k = fieldKey(key);
+    setField(k, stringValue(k, value));
+    return true;
 }
 
 std::string
 TestBase::getData(const std::string& key) const throw (not_found)
 {
+    const FieldValue* f = _findField(key);
+    if (f)
+        return f->toString();
     return getValue(dataMap_, key);
 }
 
+bool TestBase::importData(const std::string& key, const std::string& value)
+{
+    //only the values that are written back the same way
+    long long n;
+    if (boost::conversion::try_lexical_convert(value, n) &&
+        boost::lexical_cast<std::string>(n) == value)
+    {
+        setInt(fieldKey(key), n);
+        return true;
+    }
+    double d;
+    if (boost::conversion::try_lexical_convert(value, d) &&
+        formatDouble(d) == value)
+    {
+        setDouble(fieldKey(key), d);
+        return true;
+    }
+    return addData(key, value);
+}
+
+///
+/// typed data
+///
+void TestBase::setInt(FieldKey key, long long n)
+{
+    setField(key, FieldValue(n));
+}
+
+long long TestBase::getInt(FieldKey key) const throw (not_found)
+{
+    //a string that is not a number is not found either
+    try
+    {
+        const FieldValue* f = field(key);
+        if (f)
+            return f->toInt();
+        return boost::lexical_cast<long long>(getValue(dataMap_, *key));
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        throw not_found();
+    }
+}
+
+void TestBase::setDouble(FieldKey key, double d)
+{
+    setField(key, FieldValue(d));
+}
+
+double TestBase::getDouble(FieldKey key) const throw (not_found)
+{
+    //a string that is not a number is not found either
+    try
+    {
+        const FieldValue* f = field(key);
+        if (f)
+            return f->toDouble();
+        return boost::lexical_cast<double>(getValue(dataMap_, *key));
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        throw not_found();
+    }
+}
+
+void TestBase::setBool(FieldKey key, bool b)
+{
+    setField(key, FieldValue(b));
+}
+
+bool TestBase::getBool(FieldKey key) const throw (not_found)
+{
+    //a string that is not a number is not found either
+    try
+    {
+        const FieldValue* f = field(key);
+        if (f)
+            return f->toBool();
+        return boost::lexical_cast<bool>(getValue(dataMap_, *key));
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        throw not_found();
+    }
+}
+
+void TestBase::setString(FieldKey key, const std::string& s)
+{
+    setField(key, stringValue(key, s));
+}
+
+void TestBase::setIdentifier(FieldKey key, const std::string& s)
+{
+    setField(key, FieldValue(StringPool::intern(s)));
+}
+
+std::string TestBase::getString(FieldKey key) const throw (not_found)
+{
+    const FieldValue* f = field(key);
+    if (f)
+        return f->type() == FieldValue::STRING ? f->string() : f->toString();
+    return getValue(dataMap_, *key);
+}
+
+void TestBase::setField(FieldKey key, const FieldValue& value)
+{
+    //the key leaves the string data
+    if (!dataMap_.empty())
+        dataMap_.erase(*key);
+
+    FieldValue* f = _findField(key);
+    if (f)
+        *f = value;
+    else
+    {
+        Field field = { key, value };
+        fields_.push_back(field);
+    }
+    viewValid_ = false;
+}
+
+const FieldValue* TestBase::field(FieldKey key) const
+{
+    FieldList::const_iterator it;
+    for (it = fields_.begin(); it != fields_.end(); ++it)
+        if (it->key == key)
+            return &it->value;
+    return 0;
+}
+
+const FieldList& TestBase::fields() const
+{
+    return fields_;
+}
+
+void TestBase::flattenFields()
+{
+    FieldList::const_iterator it;
+    for (it = fields_.begin(); it != fields_.end(); ++it)
+        dataMap_[*it->key] = it->value.toString();
+    fields_.clear();
+    viewValid_ = false;
+}
+
+void TestBase::copyData(const TestBase& tb)
+{
+    dataMap_ = tb.dataMap_;
+    metadataMap_ = tb.metadataMap_;
+    fields_ = tb.fields_;
+    viewValid_ = false;
+}
+
+void TestBase::takeData(TestBase& tb)
+{
+    if (this == &tb)
+        return;
+
+    dataMap_.clear();
+    dataMap_.swap(tb.dataMap_);
+    metadataMap_.clear();
+    metadataMap_.swap(tb.metadataMap_);
+    fields_.clear();
+    fields_.swap(tb.fields_);
+    dataView_.clear();
+    dataView_.swap(tb.dataView_);
+    viewValid_ = tb.viewValid_;
+    tb.viewValid_ = false;
+}
+
+FieldValue* TestBase::_findField(FieldKey key)
+{
+    FieldList::iterator it;
+    for (it = fields_.begin(); it != fields_.end(); ++it)
+        if (it->key == key)
+            return &it->value;
+    return 0;
+}
+
+const FieldValue* TestBase::_findField(const std::string& name) const
+{
+    FieldList::const_iterator it;
+    for (it = fields_.begin(); it != fields_.end(); ++it)
+        if (*it->key == name)
+            return &it->value;
+    return 0;
+}
+
 bool
 TestBase::addMetadata(const std::string& key, const std::string& value)
 {
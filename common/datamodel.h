@@ -24,19 +24,35 @@
 #define DATAMODEL_H
 
 #include <uuid.h>
+#include <stringpool.h>
 #include <map>
+#include <set>
 #include <boost/ptr_container/ptr_list.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/container/small_vector.hpp>
+#include <boost/iterator/indirect_iterator.hpp>
+#include <boost/function.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 #include <string>
+#include <vector>
 #include <exception>
 
 #define WANT_SERIALIZE
 
 #ifdef WANT_SERIALIZE
+#include <boost/serialization/split_member.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/map.hpp>
 #endif
 
+// Fwd
+namespace Protocol
+{
+    class TestItemCodec;
+}
+
 namespace DataModel
 {
     ///
@@ -44,10 +60,105 @@ namespace DataModel
     ///
     typedef std::map<std::string, std::string> KeyValueMap;
 
+    // item metadata: key of the tested process that produced the
+    // item (see Comm::processKey), or its index in connection order
+    // in older suites. Missing means the first process.
+    const std::string PROCESS_METADATA = "process";
+
     struct not_found : public std::exception
     {
     };
 
+    // data key of the widget paths. Its values are identifiers, kept
+    // in the StringPool as the keys are.
+    const std::string WIDGET_DATA = "widget";
+
+    ///
+    /// typed fields
+    ///
+    /// The data values are kept as a key and a typed value, so setting
+    /// and reading them does not format or parse strings. The keys are
+    /// interned in the StringPool and compared as pointers. dataMap()
+    /// shows the fields as strings.
+    ///
+    typedef InternedString FieldKey;
+
+    // key of a field name (interned on first use, thread-safe)
+    FieldKey fieldKey(const std::string&);
+
+    class FieldValue
+    {
+    public:
+        typedef enum
+        {
+            INT,
+            DOUBLE,
+            BOOL,
+            STRING
+        } Type;
+
+        FieldValue();
+        explicit FieldValue(long long);
+        explicit FieldValue(double);
+        explicit FieldValue(bool);
+        explicit FieldValue(const std::string&);
+        // STRING value shared through the StringPool
+        explicit FieldValue(InternedString);
+
+        FieldValue(const FieldValue&);
+        FieldValue& operator=(const FieldValue&);
+        ~FieldValue();
+
+        Type type() const;
+
+        // conversions (strings are parsed, throwing
+        // boost::bad_lexical_cast if they are not numbers, the others
+        // cast)
+        long long toInt() const;
+        double toDouble() const;
+        bool toBool() const;
+        // the value as stored in the data map (the doubles with the
+        // fewest digits that read back the same value)
+        std::string toString() const;
+
+        // the string itself, only for STRING values
+        const std::string& string() const;
+        // the pooled string, 0 if the value is not interned
+        InternedString interned() const;
+
+        bool operator==(const FieldValue&) const;
+
+        // exchanges the values without copying the owned strings
+        void swap(FieldValue&);
+
+    private:
+
+        // 16 bytes: the strings are pooled or owned copies
+        Type type_;
+        bool owned_;
+        union
+        {
+            long long i_;
+            double d_;
+            bool b_;
+            const std::string* p_;
+        };
+    };
+
+    typedef struct
+    {
+        FieldKey key;
+        FieldValue value;
+    } Field;
+
+    // found by the containers, so moving the fields does not copy
+    // the owned strings
+    void swap(FieldValue&, FieldValue&);
+    void swap(Field&, Field&);
+
+    // most items have less than a dozen fields
+    typedef boost::container::small_vector<Field, 10> FieldList;
+
     ///
     /// test base
     /// object base which includes data and metadata maps
@@ -65,11 +176,47 @@ namespace DataModel
         bool addData(const std::string&, const std::string&);
         std::string getData(const std::string&) const throw (not_found);
 
-        // Access to the data map
+        // stores the integer and double values that are formatted back
+        // the same way as typed fields, the others as strings (for data
+        // read from text formats without types). The bools are read as
+        // integers.
+        bool importData(const std::string&, const std::string&);
+
+        // typed data. The getters also parse the string values, and
+        // throw not_found if they are not numbers. The WIDGET_DATA
+        // values are interned.
+        void setInt(FieldKey, long long);
+        long long getInt(FieldKey) const throw (not_found);
+        void setDouble(FieldKey, double);
+        double getDouble(FieldKey) const throw (not_found);
+        void setBool(FieldKey, bool);
+        bool getBool(FieldKey) const throw (not_found);
+        void setString(FieldKey, const std::string&);
+        std::string getString(FieldKey) const throw (not_found);
+        // string value interned in the StringPool
+        void setIdentifier(FieldKey, const std::string&);
+
+        void setField(FieldKey, const FieldValue&);
+        // 0 if the key is not a typed field
+        const FieldValue* field(FieldKey) const;
+        const FieldList& fields() const;
+
+        // Access to the data map (string and typed data). The typed
+        // fields are formatted into a cached view.
         const DataMap& dataMap() const;
+        // the same map copied to out, without keeping the view (for
+        // visiting many items once)
+        void copyDataMap(DataMap& out) const;
+        // the data kept as strings, without the typed fields (for
+        // formats that store the fields with their types)
+        const DataMap& untypedData() const;
+        // adds a pair to it, replacing the field of the key (for the
+        // same formats)
+        void addUntypedData(const std::string&, const std::string&);
 
         // TODO: Provide non-readonly operation or just add an operation
         // to add and remove data and metadata pairs?
+        // The typed fields become strings.
         DataMap& dataMap();
 
         bool addMetadata(const std::string&, const std::string&);
@@ -84,8 +231,49 @@ namespace DataModel
         bool addPair(KeyValueMap&, const std::string&, const std::string&);
         const std::string& getValue(const KeyValueMap&, const std::string& ) const throw (not_found);
 
+        // moves the typed fields to the data map, as strings
+        void flattenFields();
+
+        // copies the data, metadata and typed fields
+        void copyData(const TestBase&);
+        // moves them, leaving the other object without data
+        void takeData(TestBase&);
+
+#ifdef WANT_SERIALIZE
+        // the archives keep the typed fields as strings
+        template<class Archive>
+                void serializeData(Archive & ar)
+        {
+            DataMap data;
+            if (Archive::is_saving::value)
+                data = dataMap();
+            ar & data;
+            ar & metadataMap_;
+            if (Archive::is_loading::value)
+            {
+                dataMap_.clear();
+                fields_.clear();
+                viewValid_ = false;
+                for (DataMap::const_iterator it = data.begin(); it != data.end(); ++it)
+                    importData(it->first, it->second);
+            }
+        }
+#endif
+
+        // a key is either in the data map or in the typed fields. The
+        // data is added as fields, the map is only filled by dataMap()
+        // and by the wire codec.
         DataMap dataMap_;
         MetadataMap metadataMap_;
+        FieldList fields_;
+
+    private:
+        FieldValue* _findField(FieldKey);
+        const FieldValue* _findField(const std::string&) const;
+
+        // dataMap() view, valid while fields_ does not change
+        mutable DataMap dataView_;
+        mutable bool viewValid_;
     };
 
     ///
@@ -100,7 +288,8 @@ namespace DataModel
         TestItem();
         TestItem(int type, int subtype, int timestamp);
         TestItem(DataModel::TestItem*);
-        ~TestItem();
+        // virtual, the items are deleted through TestItem pointers
+        virtual ~TestItem();
 
         uuid_t uuid() const;
 
@@ -117,20 +306,29 @@ namespace DataModel
         template<class Archive>
                 void serialize(Archive & ar, const unsigned int /*version*/)
         {
-            ar & dataMap_;
-            ar & metadataMap_;
+            serializeData(ar);
 
             ar & uuid_;
+            if (Archive::is_loading::value)
+                U.update(uuid_);
             ar & type_;
             ar & subtype_;
             ar & timestamp_;
         }
 #endif
 
+        //binary wire codec
+        friend class Protocol::TestItemCodec;
+
         //copy methods
         virtual void copy(DataModel::TestItem*);
         virtual void deepCopy(DataModel::TestItem*);
 
+        // moves the data of the item into this one, and copies its
+        // uuid, type, subtype and timestamp. The item keeps these and
+        // is left without data.
+        void take(DataModel::TestItem*);
+
     protected:
         int type_;
         int subtype_;
@@ -141,6 +339,165 @@ namespace DataModel
         virtual void none(){}
     };
 
+    // item received from another process. The receivers share it,
+    // and the last one frees it.
+    typedef boost::shared_ptr<TestItem> TestItemPtr;
+
+    ///
+    /// test item list
+    ///
+    /// Items of a test case, in order. They are kept by value in an
+    /// arena of chunks of ARENA_CHUNK items, filled one after the other,
+    /// and the order is a vector of pointers to them. Iterating reads
+    /// the items sequentially, and inserting or erasing does not move
+    /// them. The items are copied in as TestItem (derived types are
+    /// sliced).
+    ///
+    class TestItemList
+    {
+        typedef std::vector<TestItem*> Order;
+
+    public:
+        static const size_t ARENA_CHUNK = 256;
+
+        typedef boost::indirect_iterator<Order::iterator> iterator;
+        typedef boost::indirect_iterator<Order::const_iterator, const TestItem> const_iterator;
+
+        TestItemList();
+        TestItemList(const TestItemList&);
+        TestItemList& operator=(const TestItemList&);
+        ~TestItemList();
+
+        iterator begin();
+        iterator end();
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        size_t size() const;
+        bool empty() const;
+
+        // the item is copied into the arena
+        iterator insert(iterator pos, const TestItem&);
+        void push_back(const TestItem&);
+        // the data of the item is moved into the arena (TestItem::take)
+        iterator take(iterator pos, TestItem&);
+        void take_back(TestItem&);
+        iterator erase(iterator);
+        void clear();
+        // clears the list and frees the arena
+        void reset();
+
+        // bytes reserved by the arena
+        size_t arenaBytes() const;
+
+#ifdef WANT_SERIALIZE
+        //serialization
+        friend class boost::serialization::access;
+        template<class Archive>
+                void save(Archive & ar, const unsigned int /*version*/) const
+        {
+            size_t count = order_.size();
+            ar & count;
+            for (Order::const_iterator it = order_.begin(); it != order_.end(); ++it)
+                ar & **it;
+        }
+        template<class Archive>
+                void load(Archive & ar, const unsigned int /*version*/)
+        {
+            clear();
+            size_t count;
+            ar & count;
+            for (size_t i = 0; i < count; i++)
+            {
+                TestItem ti;
+                ar & ti;
+                take_back(ti);
+            }
+        }
+        BOOST_SERIALIZATION_SPLIT_MEMBER()
+#endif
+
+    private:
+        void* _slot();
+        TestItem* _allocate(const TestItem&);
+        TestItem* _take(TestItem&);
+        void _release(TestItem*);
+
+        Order order_;
+        std::vector<char*> chunks_;
+        // slots used in the last chunk, and the ones released
+        size_t used_;
+        std::vector<TestItem*> free_;
+    };
+
+    ///
+    /// test case indexes
+    ///
+    /// Secondary indexes of the items of a test case: their positions
+    /// by widget path and by type, and the time of each item from the
+    /// start of the case (the timestamps are the delays between the
+    /// items). Appending items updates them, the other changes make
+    /// the test case rebuild them on the next query.
+    ///
+    class ItemIndex
+    {
+    public:
+        typedef std::vector<size_t> Positions;
+
+        ItemIndex();
+
+        // empty, for an empty list
+        void clear();
+        // adds the item at position size()
+        void append(const TestItem&);
+        void rebuild(const TestItemList&);
+        void invalidate();
+        bool valid() const;
+        size_t size() const;
+
+        // positions in list order (empty if none)
+        const Positions& byWidget(InternedString) const;
+        const Positions& byType(int) const;
+        // first item played at or after ms from the start (size() if none)
+        size_t atTime(long long ms) const;
+        long long duration() const;
+
+        // the widgets and types with items
+        void keys(std::vector<InternedString>& widgets,
+                  std::vector<int>& types) const;
+
+    private:
+        typedef boost::unordered_map<InternedString, Positions> WidgetMap;
+        typedef boost::unordered_map<int, Positions> TypeMap;
+
+        WidgetMap widgets_;
+        TypeMap types_;
+        std::vector<long long> times_;
+        bool valid_;
+    };
+
+    ///
+    /// lazy test cases
+    ///
+    /// A test suite opened lazily only reads the name of its test cases
+    /// and where they are in the file. The loader of a case reads its
+    /// data and items when they are needed (TestCase::load), and an
+    /// unmodified case may be unloaded again.
+    ///
+    class TestCase;
+
+    class CaseLoader
+    {
+    public:
+        virtual ~CaseLoader() {}
+
+        // reads the data, metadata and items of the case from its
+        // index. Returns false on error.
+        virtual bool load(TestCase&) = 0;
+    };
+
+    typedef boost::shared_ptr<CaseLoader> CaseLoaderPtr;
+
     ///
     /// test case
     ///
@@ -154,18 +511,79 @@ namespace DataModel
 
         uuid_t uuid() const;
 
-        typedef boost::ptr_list<TestItem> TestItemList;
+        typedef DataModel::TestItemList TestItemList;
 
         const TestItemList& testItemList() const;
 
+        // the data of the item is moved into the test case, and the
+        // item deleted
         void addTestItem(DataModel::TestItem*);
         void addTestItem(TestItemList::iterator,
                          DataModel::TestItem*);
+        // the data of the item is moved into the test case
+        void takeTestItem(DataModel::TestItem&);
 
         void deleteTestItem(TestItemList::iterator) throw (not_found);
 
+        // item by uuid, 0 if it is not in the test case
+        const DataModel::TestItem* testItem(uuid_t) const;
+
+        // items of the case (the indexed ones while it is not loaded)
         size_t count() const;
 
+        ///
+        /// lazy loading. The items of a case with a loader are empty
+        /// until load() is called. Adding or deleting items loads the
+        /// case, and keeps it loaded until its index is set again.
+        ///
+        typedef struct
+        {
+            long long offset;   // position of the case in the file
+            long long length;   // bytes of the case
+            size_t items;       // item count
+        } Index;
+
+        void setLoader(CaseLoaderPtr, const Index&);
+        CaseLoaderPtr loader() const;
+        const Index& index() const;
+
+        bool loaded() const;
+        // true if the case has been modified since its index was set
+        bool modified() const;
+        // reads the case if it is not loaded. Returns false on error.
+        bool load();
+        // releases the items of an unmodified lazy case
+        bool unload();
+        // bytes used by the loaded items
+        size_t loadedBytes() const;
+        // increasing number of the last load
+        unsigned long lastLoad() const;
+        // changes each time the items are changed (not when they are
+        // loaded or unloaded)
+        unsigned long revision() const;
+
+        ///
+        /// item queries (see ItemIndex). An indexed case keeps the
+        /// indexes up to date, and keeps them while it is unloaded.
+        /// The others scan their items on each query, and the items
+        /// of an unloaded case are not searched.
+        ///
+        typedef ItemIndex::Positions Positions;
+
+        void setIndexed(bool);
+        bool indexed() const;
+        // true if the index has the items, loaded or not
+        bool indexReady() const;
+        // the widgets and types with items in the index
+        void indexKeys(std::vector<InternedString>& widgets,
+                       std::vector<int>& types) const;
+
+        Positions itemsOnWidget(const std::string&) const;
+        Positions itemsOfType(int) const;
+        // position of the first item played at or after ms from the
+        // start of the case, count() if none
+        size_t itemAtTime(long long ms) const;
+
         //own properties
         std::string name() const;
         void name(const std::string&);
@@ -176,10 +594,11 @@ namespace DataModel
         template<class Archive>
                 void serialize(Archive & ar, const unsigned int /*version*/)
         {
-            ar & dataMap_;
-            ar & metadataMap_;
+            serializeData(ar);
 
             ar & uuid_;
+            if (Archive::is_loading::value)
+                U.update(uuid_);
             ar & name_;
             ar & testItems_;
 
@@ -193,13 +612,69 @@ namespace DataModel
 #endif
 
     protected:
-        typedef std::map<uuid_t, TestItem*> ItemMap;
+        typedef boost::unordered_map<uuid_t, TestItem*> ItemMap;
 
         ItemMap itemMap_;
         TestItemList testItems_;
         std::string name_;
 
         void __syncMap();
+
+    private:
+        // loads the case before changing its items
+        void _modify();
+        // the index, or a temporary one if the case is not indexed
+        const ItemIndex& _queryIndex(ItemIndex& temporary) const;
+
+        bool indexed_;
+        mutable ItemIndex itemIndex_;
+
+        CaseLoaderPtr loader_;
+        Index index_;
+        bool loaded_;
+        bool modified_;
+        unsigned long lastLoad_;
+        unsigned long revision_;
+    };
+
+    ///
+    /// suite index
+    ///
+    /// The test cases of an indexed suite that have items on each
+    /// widget or of each type. A case is indexed again when its
+    /// revision changes; its positions come from its own index, which
+    /// it keeps while unloaded, so a query does not read the cases.
+    ///
+    class SuiteIndex
+    {
+    public:
+        typedef boost::unordered_set<const TestCase*> Cases;
+
+        void clear();
+        // (re)indexes the case from its index, which must be ready
+        void update(const TestCase&);
+        void remove(const TestCase*);
+        // true if the case is indexed at its current revision
+        bool current(const TestCase&) const;
+
+        // the cases with items on the widget or of the type
+        const Cases& byWidget(InternedString) const;
+        const Cases& byType(int) const;
+
+    private:
+        struct Entry
+        {
+            unsigned long revision;
+            std::vector<InternedString> widgets;
+            std::vector<int> types;
+        };
+        typedef boost::unordered_map<const TestCase*, Entry> EntryMap;
+        typedef boost::unordered_map<InternedString, Cases> WidgetMap;
+        typedef boost::unordered_map<int, Cases> TypeMap;
+
+        EntryMap entries_;
+        WidgetMap widgets_;
+        TypeMap types_;
     };
 
     ///
@@ -233,6 +708,25 @@ namespace DataModel
 
         size_t count() const;
 
+        // unloads lazy test cases, the least recently loaded first,
+        // until the loaded items use at most budget bytes. The cases
+        // in keep stay loaded.
+        void unloadTestCases(size_t budget,
+                             const std::set<const TestCase*>& keep);
+        // bytes used by the items of the loaded lazy cases
+        size_t loadedBytes() const;
+
+        // the test cases with matching items, and their positions.
+        // An indexed suite answers from the suite index and only
+        // reads the cases that were never indexed; otherwise the
+        // unloaded cases are loaded for the query and unloaded again.
+        typedef std::vector<std::pair<const TestCase*, TestCase::Positions> > CaseMatches;
+        CaseMatches findWidget(const std::string&);
+        CaseMatches findType(int);
+
+        // indexes the items of the test cases, also the ones added later
+        void setIndexed(bool);
+
         //own properties
         std::string appId() const;
         void appId(const std::string&);
@@ -246,8 +740,7 @@ namespace DataModel
         template<class Archive>
                 void serialize(Archive & ar, const unsigned int /*version*/)
         {
-            ar & dataMap_;
-            ar & metadataMap_;
+            serializeData(ar);
 
             ar & appId_;
             ar & tcMap_;
@@ -258,6 +751,15 @@ namespace DataModel
     protected:
         typedef std::map<std::string, TestCase*> TestCaseMap;
 
+        CaseMatches _find(const boost::function<TestCase::Positions (const TestCase&)>&);
+        // the matches of the cases in the set, in list order
+        CaseMatches _findIndexed(const SuiteIndex::Cases&,
+                                 const boost::function<TestCase::Positions (const TestCase&)>&) const;
+        // indexes the cases added or changed since the last query
+        void _refreshIndex();
+
+        bool indexed_;
+        SuiteIndex suiteIndex_;
         TestCaseMap tcMap_;
         TestCaseList testCases_;
         std::string appId_;
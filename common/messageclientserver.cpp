@@ -25,9 +25,8 @@
 
 #include <iostream>
 #include <cassert>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <sstream>
+#include <algorithm>
+#include <protocol.h>
 #include <ohtbaseconfig.h>
 #include <debug.h>
 
@@ -39,11 +38,14 @@
 /// /// CLIENT/SERVER /////////////////////////
 /// ///////////////////////////////////////////
 
-MessageClientServer::MessageClientServer ( QObject *parent, uint port, bool isServer )
-    : QTcpServer ( parent )
+MessageClientServer::MessageClientServer ( QObject *parent,
+                                          const Transport::Endpoint& endpoint,
+                                          bool isServer )
+    : QObject ( parent )
 {
-    setParent(parent);
-    _port = port;
+    _endpoint = endpoint;
+    nextClient_ = 0;
+    QString errorString;
 
     ///
     /// if it is created as a server...
@@ -51,17 +53,21 @@ MessageClientServer::MessageClientServer ( QObject *parent, uint port, bool isSe
     if (isServer)
     {
         //starting listening process
-        if (!this->listen(QHostAddress(SERVER_IP), _port)) {
+        server_.reset ( Transport::createServer ( _endpoint, this, errorString ) );
+        if (!server_.get()) {
             DEBUG(D_ERROR,"(MessageClientServer::MessageClientServer) Unable to start server "
-                  << SERVER_IP << "::" << _port << " ERROR = " << this->errorString().toStdString());
-            close();
+                  << _endpoint.toString() << " ERROR = " << errorString.toStdString());
             return;
         }
 
-        //connect(this, SIGNAL(newConnection()), /**/ this, SIGNAL(newClientConnected()));
+        connect ( server_.get(), SIGNAL ( newConnection() ),
+                  this, SLOT ( handleNewConnection() ) );
 
-        DEBUG(D_COMM,"(MessageClientServer::MessageClientServer) Server listening on address "
-              << SERVER_IP << "::" << _port);
+        //the system may have chosen the address
+        _endpoint = Transport::Endpoint ( _endpoint.kind(), server_->address() );
+
+        DEBUG(D_COMM,"(MessageClientServer::MessageClientServer) Server listening on "
+              << _endpoint.toString());
     }
 
     ///
@@ -69,64 +75,98 @@ MessageClientServer::MessageClientServer ( QObject *parent, uint port, bool isSe
 
     else
     {
-        //creating a new socket and connecting to its signals
-        currentSocket_.reset (new QTcpSocket ( this ));
-        connect ( currentSocket_.get(), SIGNAL ( error ( QAbstractSocket::SocketError ) ),
-                  this, SLOT ( displayError ( QAbstractSocket::SocketError ) ) );
-        connect ( currentSocket_.get(), SIGNAL ( readyRead() ),
-                  this, SLOT ( readMessage() ) );
-
         //connecting to the server
-        DEBUG(D_COMM,"(MessageClientServer::MessageClientServer) Connecting to address "
-              << SERVER_IP << " and port " << _port << ".");
-        currentSocket_->connectToHost(QHostAddress(SERVER_IP), _port );
-        if (currentSocket_->waitForConnected(2000))
+        DEBUG(D_COMM,"(MessageClientServer::MessageClientServer) Connecting to "
+              << _endpoint.toString() << ".");
+        Transport::Connection* c =
+                Transport::connectTo ( _endpoint, 0, CONNECT_TIMEOUT, errorString );
+        if (c)
+        {
+            _addSession ( c );
             DEBUG(D_COMM,"(MessageClientServer::MessageClientServer) Client successfully connected.");
+        }
         else
-
-            DEBUG(D_COMM,"(MessageClientServer::MessageClientServer) Error while connecting client. Code = "
-                  + QString::number(currentSocket_->error()).toStdString());
+            DEBUG(D_COMM,"(MessageClientServer::MessageClientServer) Error while connecting client. "
+                  << errorString.toStdString());
     }
 }
 
 MessageClientServer::~MessageClientServer()
 {
+    //the connections go before the server that may own their resources
+    SessionMap::iterator it;
+    for (it = sessions_.begin(); it != sessions_.end(); ++it)
+        it->second->connection->disconnect ( this );
+    sessions_.clear();
+}
+
+const Transport::Endpoint& MessageClientServer::endpoint() const
+{
+    return _endpoint;
+}
+
+bool MessageClientServer::isStarted() const
+{
+    return server_.get() || !sessions_.empty();
 }
 
 ///
 /// (Only for Server) Handles an incoming connection
 ///
-#if QT_VERSION >= 0x050000
-void MessageClientServer::incomingConnection ( qintptr socketDescriptor )
-#else
-void MessageClientServer::incomingConnection ( int socketDescriptor )
-#endif
+void MessageClientServer::handleNewConnection()
 {
-    DEBUG(D_COMM,"(MessageClientServer::incomingConnection) Socket = "
-          + QString::number(socketDescriptor).toStdString());
+    Transport::Connection* c = server_->nextPendingConnection();
+    if (!c)
+        return;
+
+    //every client gets its own session
+    int client = _addSession ( c );
+
+    DEBUG(D_COMM,"(MessageClientServer::handleNewConnection) New client " << client
+          << " on " << _endpoint.toString());
 
-    // FIXME: It only accepts one connection and erases
-    // the previous ones. Have to fix this.
+    //send the signal
+    emit newClientConnected ( client );
+}
 
-    //creating a new socket for the incoming connection
-    ClientSocket* cs_ = new ClientSocket ( socketDescriptor, this );
-    connect ( cs_, SIGNAL ( readyRead() ),
+///
+/// sessions
+///
+int MessageClientServer::_addSession ( Transport::Connection* c )
+{
+    int client = nextClient_++;
+    sessions_.insert ( client, new Session ( c ) );
+
+    connect ( c, SIGNAL ( readyRead() ),
               this, SLOT ( readMessage() ) );
-    connect ( cs_, SIGNAL ( error ( QAbstractSocket::SocketError ) ),
-              this, SLOT ( displayError ( QAbstractSocket::SocketError ) ) );
-    connect ( cs_, SIGNAL ( error ( const QString& ) ),
-              parent(), SLOT ( handleError ( const QString& ) ) );
+    connect ( c, SIGNAL ( disconnected() ),
+              this, SLOT ( handleClientDisconnected() ) );
+    connect ( c, SIGNAL ( error ( const QString& ) ),
+              this, SLOT ( handleConnectionError ( const QString& ) ) );
+    return client;
+}
 
-    //set the socket as the current (closes the open server socket)
-    currentSocket_.reset (cs_);
+void MessageClientServer::_removeSession ( int client )
+{
+    SessionMap::iterator it = sessions_.find ( client );
+    if (it == sessions_.end())
+        return;
 
-    //clear the buffer
-    buffer_.clear();
+    //the connection may be emitting the signal we come from
+    Transport::Connection* c = it->second->connection.release();
+    c->disconnect ( this );
+    c->deleteLater();
 
-    //send the signal
-    emit newClientConnected();
+    sessions_.erase ( it );
+}
 
-    DEBUG(D_COMM,"(MessageClientServer::incomingConnection) New incomming client.");
+int MessageClientServer::_findSession ( QObject* connection ) const
+{
+    SessionMap::const_iterator it;
+    for (it = sessions_.begin(); it != sessions_.end(); ++it)
+        if (it->second->connection.get() == connection)
+            return it->first;
+    return -1;
 }
 
 //
@@ -134,16 +174,68 @@ void MessageClientServer::incomingConnection ( int socketDescriptor )
 //
 void MessageClientServer::writeMessage ( const QString& s )
 {
-    //DEBUG(D_COMM,"(MessageClientServer::writeMessage) Data to send " <<          s.toStdString());
-    //writing a new message into the socket
-    assert(currentSocket_.get());
-    if ( !_writeSocket ( currentSocket_.get(), s ) )
+    //text messages are sent as a frame
+    writeFrame ( ALL_CLIENTS, Protocol::MSG_TEXT, 0, s.toUtf8() );
+}
+
+void MessageClientServer::writeFrame ( int client, int type, uint sequence, const QByteArray& payload )
+{
+    QList<int> targets = _targets ( client );
+
+    //writing a new frame into each connection
+    for (int i = 0; i < targets.size(); i++)
+    {
+        SessionMap::iterator it = sessions_.find ( targets.at(i) );
+        if ( it == sessions_.end() ||
+             !_writeConnection ( it->second->connection.get(), type, sequence, payload ) )
+        {
+            DEBUG(D_ERROR,"(MessageClientServer::writeFrame) Error while writting the connection of client "
+                  << targets.at(i) << ".");
+            emit error ( "(MessageClientServer::writeFrame) Error writing into the connection." );
+        }
+    }
+
+    DEBUG(D_COMM,"(MessageClientServer::writeFrame) Frame written into the connection.");
+}
+
+void MessageClientServer::writeFrames ( int client, const QByteArray& frames )
+{
+    QList<int> targets = _targets ( client );
+
+    for (int i = 0; i < targets.size(); i++)
     {
-        DEBUG(D_ERROR,"(MessageClientServer::writeMessage) Error while writting sockect.");
-        emit error ( "(MessageClientServer::writeMessage) Error writing into the socket." );
+        SessionMap::iterator it = sessions_.find ( targets.at(i) );
+        Transport::Connection* c = it != sessions_.end() ? it->second->connection.get() : 0;
+        bool ok = c && c->isConnected() && c->write ( frames.constData(), frames.size() );
+        if (!ok)
+        {
+            DEBUG(D_ERROR,"(MessageClientServer::writeFrames) Error while writting the connection of client "
+                  << targets.at(i) << ".");
+            emit error ( "(MessageClientServer::writeFrames) Error writing into the connection." );
+            continue;
+        }
+        c->flush();
     }
 
-    DEBUG(D_COMM,"(MessageClientServer::writeMessage) Message written into the socket.");
+    DEBUG(D_COMM,"(MessageClientServer::writeFrames) " << frames.size() << " bytes written.");
+}
+
+///
+/// the clients to write to. A failed write may report the
+/// disconnection and drop a session, so they are looked up one by one.
+///
+QList<int> MessageClientServer::_targets ( int client ) const
+{
+    QList<int> targets;
+    if (client == ALL_CLIENTS)
+    {
+        SessionMap::const_iterator it;
+        for (it = sessions_.begin(); it != sessions_.end(); ++it)
+            targets.append ( it->first );
+    }
+    else
+        targets.append ( client );
+    return targets;
 }
 
 
@@ -153,63 +245,51 @@ void MessageClientServer::writeMessage ( const QString& s )
 void MessageClientServer::readMessage()
 {
     DEBUG(D_COMM, "(MessageClientServer::readMessage)");
+
+    //the session of the connection that has data
+    int client = _findSession ( sender() );
+    if (client < 0)
+        return;
+    Session& session = sessions_.at ( client );
+
     //if we cannot read...
-    assert(currentSocket_.get());
-    if (!_readSocket ( currentSocket_.get(), &buffer_ ))
+    if (!_readConnection ( session.connection.get(), &session.buffer ))
     {
-        DEBUG(D_ERROR, "(MessageClientServer::readMessage) Error reading from the socket.");
-        emit error ( "(MessageClientServer::readMessage) Error reading from the socket." );
+        DEBUG(D_ERROR, "(MessageClientServer::readMessage) Error reading from the connection.");
+        emit error ( "(MessageClientServer::readMessage) Error reading from the connection." );
+        return;
     }
-    //if we can, we store the data into the buffer and emit complete messages
-    else
+
+    //if we can, we store the data into the buffer and take the complete frames.
+    //Frames are removed from the buffer before emitting them, as the slots
+    //may run a nested event loop and reenter this method.
+    QList<Frame> frames;
+    if (!_extractFrames ( &session.buffer, frames ))
     {
-        //for each message
-        QString message = buffer_.getOneString();
-        while (message != "")
-        {
-            //DEBUG(D_COMM, "(MessageClientServer::readMessage) One message received:");
-            //DEBUG(D_COMM, "(MessageClientServer::readMessage) " << message.toStdString());
-            //emiting the received message signal
-            emit receivedMessage ( message );
-            DEBUG(D_COMM, "(MessageClientServer::readMessage) Message emited.");
-            //reading the next message (if it exists)
-            message = buffer_.getOneString();
-        }
+        DEBUG(D_ERROR, "(MessageClientServer::readMessage) Corrupted stream. Buffer discarded.");
+        emit error ( "(MessageClientServer::readMessage) Corrupted stream received." );
+    }
+
+    //for each frame
+    for (int i = 0; i < frames.size(); i++)
+    {
+        const Frame& f = frames.at(i);
+        if (f.type == Protocol::MSG_TEXT)
+            emit receivedMessage ( client, QString::fromUtf8 ( f.payload ) );
+        else
+            emit receivedFrame ( client, f.type, f.sequence, f.payload );
+        DEBUG(D_COMM, "(MessageClientServer::readMessage) Frame emited.");
     }
     DEBUG(D_COMM, "(MessageClientServer::readMessage) Exit");
 }
 
 
 ///
-/// Displays error description
+/// Forwards the connection errors
 ///
-void MessageClientServer::displayError ( QAbstractSocket::SocketError socketError )
+void MessageClientServer::handleConnectionError ( const QString& s )
 {
-    QString errorString = "(Client::displayError) "
-            + QString::number(socketError) + ": ";
-
-    switch ( socketError )
-    {
-
-    case QAbstractSocket::RemoteHostClosedError:
-        errorString += "Remote host closed connection.";
-        //here it also handles the client disconnection
-        handleClientDisconnected();
-        break;
-
-    case QAbstractSocket::HostNotFoundError:
-        errorString += "The host was not found. Please check the host name and port settings.";
-        break;
-
-    case QAbstractSocket::ConnectionRefusedError:
-        errorString += "The connection was refused by the peer. Make sure the fortune server is running, and check that the host name and port settings are correct.";
-        break;
-
-    default:
-        errorString += "Unknown error.";
-    }
-
-    emit error(errorString);
+    emit error ( s );
 }
 
 ///
@@ -218,96 +298,136 @@ void MessageClientServer::displayError ( QAbstractSocket::SocketError socketErro
 
 void MessageClientServer::handleClientDisconnected()
 {
-    //clear the buffer
-    buffer_.clear();
+    int client = _findSession ( sender() );
+    if (client < 0)
+        return;
+
+    DEBUG(D_COMM,"(MessageClientServer::handleClientDisconnected) Client " << client);
+
+    //drop the session and its buffer
+    _removeSession ( client );
 
     //emit the signal
-    emit clientDisconnected();
+    emit clientDisconnected ( client );
 }
 
 
 
 /// ///////////////////////////////////////////
-/// /// SOCKET READ AND WRITE METHODS /////////
+/// /// CONNECTION READ AND WRITE METHODS /////
 /// ///////////////////////////////////////////
 
 
 ///
-/// read from socket
+/// read from connection
 ///
-bool MessageClientServer::_readSocket ( QTcpSocket *s, QCircularByteArray_ *buffer )
+bool MessageClientServer::_readConnection ( Transport::Connection *c, QCircularByteArray_ *buffer )
 {
-    DEBUG(D_COMM,"(readSocket)");
+    DEBUG(D_COMM,"(readConnection)");
     assert(buffer);
-    assert(s);
-    //if it is connected and bytes available...
-    if ( s->state() == QAbstractSocket::ConnectedState)
+    assert(c);
+    //if it is connected...
+    if ( c->isConnected() )
     {
-        if ( s->bytesAvailable() > 0 )
+        //reading and storing into the buffer
+        QByteArray data = c->readAll();
+        if ( data.size() )
         {
-            //reading and storing into the buffer
-            QByteArray data = s->readAll();
-            assert(buffer->addData(data));
+            bool added = buffer->addData(data);
+            assert(added);
+            (void)added;
 
-            DEBUG(D_COMM,"(readSocket) adding data to the buffer.");
+            DEBUG(D_COMM,"(readConnection) adding data to the buffer.");
         }
         //return OK
         return true;
     }
     else
     {
-        DEBUG(D_COMM,"(readSocket) Error while reading from the socket.");
+        DEBUG(D_COMM,"(readConnection) Error while reading from the connection.");
         //return KO
         return false;
     }
 }
 
 ///
-/// write in socket
+/// write in connection
 ///
-bool MessageClientServer::_writeSocket ( QTcpSocket *s, const QString& message )
+bool MessageClientServer::_writeConnection ( Transport::Connection *c, int type, uint sequence,
+                                             const QByteArray& payload )
 {
-    DEBUG(D_COMM,"(writeSocket)");
-    assert(message != "");//FIXME: remove this assert
+    DEBUG(D_COMM,"(writeConnection)");
     //if it is connected...
-    if ( s && s->state() == QAbstractSocket::ConnectedState )
+    if ( c && c->isConnected() )
     {
-        //writting the message
-        //s->write ( reinterpret_cast<const char*>(message.data()),
-        //           message.size() + 1 );
-        std::string msg = message.toStdString();
-        s->write ( msg.c_str(), msg.size() + 1 );
-
-        DEBUG(D_COMM,"(writeSocket) Written.");
-        s->flush();
-        //return OK
-        return true;
+        //writting the header and the payload
+        char header[Protocol::FRAME_HEADER_SIZE];
+        Protocol::writeHeader ( header, static_cast<unsigned char>(type),
+                                payload.size(), sequence );
+        bool ok = c->write ( header, Protocol::FRAME_HEADER_SIZE ) &&
+                  c->write ( payload.constData(), payload.size() );
+
+        DEBUG(D_COMM,"(writeConnection) Written.");
+        c->flush();
+        //return the write result
+        return ok;
     }
     else
     {
-        DEBUG(D_ERROR,"(writeSocket) Error while writing into the socket. Socket NULL or not connected.");
+        DEBUG(D_ERROR,"(writeConnection) Error while writing into the connection. Connection NULL or not connected.");
         //return KO
         return false;
     }
 }
 
-
 ///
-/// (Only for Server) Client socket for incoming connections
+/// frame extraction
 ///
-ClientSocket::ClientSocket ( int sock, QObject * parent )
-    : QTcpSocket ( parent )
+bool MessageClientServer::_extractFrames ( QCircularByteArray_ *buffer, QList<Frame>& frames )
 {
-    //trying to connect
-    if ( !setSocketDescriptor ( sock, QAbstractSocket::ConnectedState,
-                                QIODevice::ReadWrite ) )
+    assert(buffer);
+    bool ok = true;
+
+    //walk the buffer once, frame by frame
+    while (true)
     {
-        emit error ( "(ClientSocket::ClientSocket) Error connecting to the socket descriptor." );
-        return;
+        //the header may wrap around the ring, so it is copied
+        char h[Protocol::FRAME_HEADER_SIZE];
+        size_t available = buffer->size();
+        if (!buffer->copy ( 0, h, std::min ( available, Protocol::FRAME_HEADER_SIZE ) ))
+            break;
+
+        Protocol::FrameHeader header;
+        Protocol::HeaderStatus st = Protocol::readHeader ( h, available, header );
+
+        //wait for more data
+        if (st == Protocol::HEADER_INCOMPLETE)
+            break;
+
+        //the stream cannot be resynchronized
+        if (st != Protocol::HEADER_OK)
+        {
+            DEBUG(D_ERROR,"(MessageClientServer::_extractFrames) " << Protocol::headerStatusString(st));
+            buffer->clear();
+            ok = false;
+            break;
+        }
+
+        //wait for the whole payload
+        const int total = Protocol::FRAME_HEADER_SIZE + header.length;
+        const char* data = buffer->peek ( total );
+        if (!data)
+            break;
+
+        //the payload is copied once, as the frames outlive the buffer
+        //contents when they are emitted
+        Frame f;
+        f.type = header.type;
+        f.sequence = header.sequence;
+        f.payload = QByteArray ( data + Protocol::FRAME_HEADER_SIZE, header.length );
+        frames.append ( f );
+        buffer->consume ( total );
     }
-}
 
-ClientSocket::~ClientSocket()
-{
+    return ok;
 }
-
@@ -25,70 +25,91 @@
 
 #include <datamodel.h>
 #include <utilclasses.h>
-#include <QTcpServer>
-#include <QTcpSocket>
+#include <transport.h>
+#include <QObject>
+#include <QList>
+#include <boost/ptr_container/ptr_map.hpp>
 #include <memory>
-#include <deque>
 
 
-class MessageClientServer : public QTcpServer
+class MessageClientServer : public QObject
 {
     Q_OBJECT
 
 public:
-    MessageClientServer ( QObject *parent, uint port, bool isServer );
+    MessageClientServer ( QObject *parent, const Transport::Endpoint& endpoint, bool isServer );
     ~MessageClientServer();
 
+    //client id used to write to every connected client
+    static const int ALL_CLIENTS = -1;
+
+    //endpoint in use (the one actually listened on, for servers)
+    const Transport::Endpoint& endpoint() const;
+
+    //the server is listening, or the client connected
+    bool isStarted() const;
+
 public slots:
     void readMessage();
     void writeMessage ( const QString& );
-    void displayError ( QAbstractSocket::SocketError socketError );
+    void writeFrame ( int client, int type, uint sequence, const QByteArray& payload );
+    //writes already encoded frames with a single write
+    void writeFrames ( int client, const QByteArray& frames );
 
+    void handleNewConnection();
+    void handleConnectionError ( const QString& );
     void handleClientDisconnected();
 
 signals:
-    void receivedMessage ( const QString& );
+    void receivedMessage ( int client, const QString& );
+    void receivedFrame ( int client, int type, uint sequence, const QByteArray& payload );
     void error ( const QString& );
-    void newClientConnected();
-    void clientDisconnected();
+    void newClientConnected ( int client );
+    void clientDisconnected ( int client );
 
 protected:
-#if QT_VERSION >= 0x050000
-    void incomingConnection ( qintptr socketDescriptor );
-#else
-    void incomingConnection (int socketDescriptor );
-#endif
 
-
-    bool _readSocket ( QTcpSocket *s, QCircularByteArray_ *buffer );
-    bool _writeSocket ( QTcpSocket *s, const QString& message );
+    //received frame
+    typedef struct
+    {
+        int type;
+        uint sequence;
+        QByteArray payload;
+    } Frame;
+
+    //client session: the connection and its receive buffer
+    class Session
+    {
+    public:
+        Session ( Transport::Connection* c ) : connection ( c ) {}
+
+        std::auto_ptr<Transport::Connection> connection;
+        QCircularByteArray_ buffer;
+    };
+    typedef boost::ptr_map<int, Session> SessionMap;
+
+    int _addSession ( Transport::Connection* );
+    void _removeSession ( int client );
+    int _findSession ( QObject* connection ) const;
+    QList<int> _targets ( int client ) const;
+
+    bool _readConnection ( Transport::Connection *c, QCircularByteArray_ *buffer );
+    bool _writeConnection ( Transport::Connection *c, int type, uint sequence,
+                            const QByteArray& payload );
+
+    //extracts the complete frames stored in the buffer
+    bool _extractFrames ( QCircularByteArray_ *buffer, QList<Frame>& frames );
 
 private:
 
-    uint _port;
-
-    std::auto_ptr<QTcpSocket> currentSocket_;
-
-    QCircularByteArray_ buffer_;
-};
-
-
+    Transport::Endpoint _endpoint;
 
-/// ////////////////////////////////////////////
-/// ////////////////////////////////////////////
-/// ////////////////////////////////////////////
-
-class ClientSocket : public QTcpSocket
-{
-    Q_OBJECT
-
-public:
-    ClientSocket ( int sock, QObject *parent );
-    ~ClientSocket();
-
-signals:
-    void error ( const QString& );
+    //only for the server
+    std::auto_ptr<Transport::Server> server_;
 
+    //connected clients, by id (the client side has only one, 0)
+    SessionMap sessions_;
+    int nextClient_;
 };
 
 
@@ -44,13 +44,57 @@
 ///
 
 #define SERVER_IP "127.0.0.1"
-#define TCP_PORT 7357
+
+// transport used between the HMI Tester and the Preload Module,
+// written as "tcp:port", "local:name" or "shm:key" (see transport.h).
+// Each HMI Tester listens on its own endpoint of this kind (a free
+// port, or the name with the tester pid appended) and passes it to
+// the tested application in the ENDPOINT_ENVVAR variable. Setting
+// the variable for the HMI Tester forces a fixed endpoint.
+#define DEFAULT_ENDPOINT "local:openhmitester"
+#define ENDPOINT_ENVVAR "OHT_ENDPOINT"
+
+#define CONNECT_TIMEOUT 2000
+
+// items sent before the Preload Module connects are kept encoded,
+// up to this many bytes (see Comm::setPendingLimit), and how long a
+// sender blocked by a full queue waits for a client (ms)
+#define PENDING_QUEUE_LIMIT (4 * 1024 * 1024)
+#define PENDING_BLOCK_TIMEOUT 10000
+
+// shared memory transport: bytes per direction (power of two),
+// how long a writer waits for room in a full ring (ms) and how
+// often the server checks that its client process is alive (ms).
+// It serves a single client process, see ShmServer.
+#define SHM_RING_SIZE (1024 * 1024)
+#define SHM_WRITE_TIMEOUT 5000
+#define SHM_LIVENESS_INTERVAL 500
+
+// items the Preload Module queues for its comm thread, and how long
+// the application waits for room when it is full (ms) before it
+// starts dropping items
+#define SEND_QUEUE_SIZE 4096
+#define SEND_QUEUE_WAIT 100
 
 ///
 /// hmi tester app configuration
 ///
 
 #define OHT_FILE_EXTENSION "oht"
+#define OHTB_FILE_EXTENSION "ohtb"
+
+// suffix of the compressed suites (suite.oht.gz), added to the
+// extension of their format
+#define COMPRESSED_FILE_EXTENSION "gz"
+
+// the suite formats offered by the file dialogs
+#define OHT_FILE_FILTER "Test suites (*." OHT_FILE_EXTENSION " *." OHTB_FILE_EXTENSION \
+    " *." OHT_FILE_EXTENSION "." COMPRESSED_FILE_EXTENSION \
+    " *." OHTB_FILE_EXTENSION "." COMPRESSED_FILE_EXTENSION ");;" \
+    "XML test suites (*." OHT_FILE_EXTENSION ");;" \
+    "Binary test suites (*." OHTB_FILE_EXTENSION ");;" \
+    "Compressed test suites (*." OHT_FILE_EXTENSION "." COMPRESSED_FILE_EXTENSION \
+    " *." OHTB_FILE_EXTENSION "." COMPRESSED_FILE_EXTENSION ")"
 
 #define IDLE_OPACITY 1.0
 #define RUNNING_OPACITY 0.5
@@ -61,6 +105,56 @@
 
 #define EXEC_PAUSE_AFTER_REPLAY 2000
 
+// how long the playback waits for a process started by the items
+// already played to connect, and how often it checks (ms)
+#define EXEC_PROCESS_TIMEOUT 10000
+#define EXEC_POLL_INTERVAL 50
+
+// the playback fails if no item is executed for this long (ms)
+#define EXEC_ACK_TIMEOUT 30000
+
+// test items sent ahead of the Preload Module acks.
+// 1 waits for every item to be executed before sending the next one.
+#define PLAYBACK_WINDOW 16
+
+///
+/// test suites
+///
+
+// the test suites are opened reading only the test case index, the
+// items of a case are read when it is played
+#define LAZY_TEST_SUITES true
+
+// bytes of test items kept loaded: above it, the least recently
+// loaded cases that are not queued are unloaded
+#define TEST_SUITE_MEMORY_BUDGET (64 * 1024 * 1024)
+
+// threads reading or writing the test cases of a suite (0 for one
+// per core). The suites are opened and saved off the GUI thread, and
+// their progress is shown if it takes longer than this (ms).
+#define SUITE_IO_THREADS 0
+#define SUITE_PROGRESS_DELAY 500
+
+// zlib level (1 fastest - 9 smallest) of the suites saved with the
+// COMPRESSED_FILE_EXTENSION. The compressed suites are read whatever
+// their name, they are told by their first bytes.
+#define SUITE_COMPRESSION_LEVEL 6
+
+// the recorded and deleted test cases are appended to a journal next
+// to the suite file instead of rewriting it. The journal is compacted
+// into the suite file in background when it has JOURNAL_COMPACT_MIN
+// bytes and is larger than this fraction of the file.
+#define JOURNALED_TEST_SUITES true
+#define JOURNAL_COMPACT_RATIO 0.25
+#define JOURNAL_COMPACT_MIN (1024 * 1024)
+
+// the recorded items are spooled to a file next to the suite as they
+// arrive, synced every RECORDING_SYNC_ITEMS items. The last
+// RECORDING_TAIL_ITEMS items stay in memory.
+#define STREAM_RECORDINGS true
+#define RECORDING_SYNC_ITEMS 64
+#define RECORDING_TAIL_ITEMS 256
+
 ///
 /// output files
 ///
@@ -0,0 +1,100 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "protocol.h"
+
+using namespace Protocol;
+
+
+///
+/// header writing
+///
+void Protocol::writeHeader(char* out, unsigned char type, unsigned int length,
+                           unsigned int sequence)
+{
+    unsigned char* p = reinterpret_cast<unsigned char*>(out);
+
+    p[0] = FRAME_MAGIC_0;
+    p[1] = FRAME_MAGIC_1;
+    p[2] = FRAME_VERSION;
+    p[3] = type;
+    p[4] = static_cast<unsigned char>(length);
+    p[5] = static_cast<unsigned char>(length >> 8);
+    p[6] = static_cast<unsigned char>(length >> 16);
+    p[7] = static_cast<unsigned char>(length >> 24);
+    p[8] = static_cast<unsigned char>(sequence);
+    p[9] = static_cast<unsigned char>(sequence >> 8);
+    p[10] = static_cast<unsigned char>(sequence >> 16);
+    p[11] = static_cast<unsigned char>(sequence >> 24);
+}
+
+///
+/// header reading
+///
+HeaderStatus Protocol::readHeader(const char* data, size_t size, FrameHeader& header)
+{
+    if (size < FRAME_HEADER_SIZE)
+        return HEADER_INCOMPLETE;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+
+    if (p[0] != FRAME_MAGIC_0 || p[1] != FRAME_MAGIC_1)
+        return HEADER_BAD_MAGIC;
+
+    if (p[2] != FRAME_VERSION)
+        return HEADER_BAD_VERSION;
+
+    header.version = p[2];
+    header.type = p[3];
+    header.length = static_cast<unsigned int>(p[4]) |
+            (static_cast<unsigned int>(p[5]) << 8) |
+            (static_cast<unsigned int>(p[6]) << 16) |
+            (static_cast<unsigned int>(p[7]) << 24);
+    header.sequence = static_cast<unsigned int>(p[8]) |
+            (static_cast<unsigned int>(p[9]) << 8) |
+            (static_cast<unsigned int>(p[10]) << 16) |
+            (static_cast<unsigned int>(p[11]) << 24);
+
+    if (header.length > FRAME_MAX_PAYLOAD)
+        return HEADER_TOO_LARGE;
+
+    return HEADER_OK;
+}
+
+const char* Protocol::headerStatusString(HeaderStatus s)
+{
+    switch (s)
+    {
+    case HEADER_OK:
+        return "OK";
+    case HEADER_INCOMPLETE:
+        return "Incomplete header";
+    case HEADER_BAD_MAGIC:
+        return "Wrong frame magic";
+    case HEADER_BAD_VERSION:
+        return "Unsupported protocol version";
+    case HEADER_TOO_LARGE:
+        return "Frame payload too large";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,101 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+
+namespace Protocol
+{
+
+    ///
+    /// frame layout
+    ///
+    /// Every message exchanged between the HMI Tester and the
+    /// Preload Module is sent as a frame: a fixed size header
+    /// followed by the payload. All the fields are little endian.
+    ///
+    ///   offset  size  field
+    ///   0       2     magic ("OH")
+    ///   2       1     protocol version
+    ///   3       1     message type
+    ///   4       4     payload length
+    ///   8       4     sequence number (0 if not used)
+    ///
+    /// The sequence number tags the test items sent in playback,
+    /// the Preload Module acks each executed item with its number.
+    ///
+
+    const unsigned char FRAME_MAGIC_0 = 'O';
+    const unsigned char FRAME_MAGIC_1 = 'H';
+    const unsigned char FRAME_VERSION = 5;
+
+    const size_t FRAME_HEADER_SIZE = 12;
+
+    // bigger payloads are considered a corrupted stream
+    const size_t FRAME_MAX_PAYLOAD = 64 * 1024 * 1024;
+
+    ///
+    /// message types
+    ///
+    const unsigned char MSG_TEXT = 1;
+    const unsigned char MSG_TEST_ITEM = 2; // Protocol::TestItemCodec payload (may use
+                                           // the dictionary of the connection)
+    const unsigned char MSG_PROCESS = 3;   // executable name of the client process (UTF-8),
+                                           // its first frame
+
+    ///
+    /// frame header
+    ///
+    struct FrameHeader
+    {
+        unsigned char version;
+        unsigned char type;
+        unsigned int length;
+        unsigned int sequence;
+    };
+
+    ///
+    /// header parsing result
+    ///
+    typedef enum
+    {
+        HEADER_OK,
+        HEADER_INCOMPLETE,
+        HEADER_BAD_MAGIC,
+        HEADER_BAD_VERSION,
+        HEADER_TOO_LARGE
+    } HeaderStatus;
+
+    // writes FRAME_HEADER_SIZE bytes into out
+    void writeHeader(char* out, unsigned char type, unsigned int length,
+                     unsigned int sequence = 0);
+
+    // reads a header from the beginning of data
+    HeaderStatus readHeader(const char* data, size_t size, FrameHeader& header);
+
+    // human readable description of a header status
+    const char* headerStatusString(HeaderStatus);
+}
+
+#endif // PROTOCOL_H
@@ -0,0 +1,576 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "shmtransport.h"
+
+#include <QElapsedTimer>
+#include <boost/bind.hpp>
+#include <boost/static_assert.hpp>
+#include <ohtbaseconfig.h>
+#include <debug.h>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <signal.h>
+#include <unistd.h>
+
+using namespace Transport;
+
+
+///
+/// segment layout
+///
+///   ShmSegment (padded to SEGMENT_HEADER_SIZE)
+///   ring 0 data: client -> server
+///   ring 1 data: server -> client
+///
+/// head and tail count the bytes written and read (mod 2^32),
+/// each of them is only modified by one side.
+///
+/// There is a single pair of rings, so the segment serves one
+/// client process at a time. The client writes its pid after
+/// claiming the segment, so the server can free it if the client
+/// dies without detaching.
+///
+
+namespace Transport
+{
+    struct ShmRing
+    {
+        QAtomicInt head;
+        char pad0[64 - sizeof(QAtomicInt)];
+        QAtomicInt tail;
+        char pad1[64 - sizeof(QAtomicInt)];
+    };
+
+    struct ShmSegment
+    {
+        quint32 magic;
+        quint32 capacity;
+        QAtomicInt serverState;
+        QAtomicInt clientState;
+        QAtomicInt clientPid;
+        char pad[64 - 2 * sizeof(quint32) - 3 * sizeof(QAtomicInt)];
+        ShmRing rings[2];
+    };
+}
+
+static const quint32 SHM_MAGIC = 0x3154484f; // "OHT1"
+static const size_t SEGMENT_HEADER_SIZE = 512;
+static const int CLIENT_TO_SERVER = 0;
+static const int SERVER_TO_CLIENT = 1;
+
+BOOST_STATIC_ASSERT(sizeof(ShmSegment) <= SEGMENT_HEADER_SIZE);
+BOOST_STATIC_ASSERT((SHM_RING_SIZE & (SHM_RING_SIZE - 1)) == 0);
+
+typedef enum
+{
+    CLIENT_FREE,
+    CLIENT_ATTACHED,
+    CLIENT_DETACHED // waiting for the server to reset the rings
+} ClientState;
+
+///
+/// atomic helpers (Qt4 has no plain acquire/release accessors)
+///
+static inline quint32 loadAcquire(QAtomicInt& a)
+{
+#if QT_VERSION >= 0x050000
+    return a.loadAcquire();
+#else
+    return a.fetchAndAddAcquire(0);
+#endif
+}
+
+static inline void storeRelease(QAtomicInt& a, quint32 v)
+{
+#if QT_VERSION >= 0x050000
+    a.storeRelease(v);
+#else
+    a.fetchAndStoreRelease(v);
+#endif
+}
+
+///
+/// ring helpers
+///
+static char* ringData(ShmSegment* s, int r)
+{
+    return reinterpret_cast<char*>(s) + SEGMENT_HEADER_SIZE + r * s->capacity;
+}
+
+static bool ringEmpty(ShmSegment* s, int r)
+{
+    return loadAcquire(s->rings[r].head) == loadAcquire(s->rings[r].tail);
+}
+
+static void ringReset(ShmSegment* s, int r)
+{
+    storeRelease(s->rings[r].head, 0);
+    storeRelease(s->rings[r].tail, 0);
+}
+
+// writes as much as it fits, returns the written size
+static size_t ringWrite(ShmSegment* s, int r, const char* data, size_t size)
+{
+    ShmRing& ring = s->rings[r];
+    const quint32 cap = s->capacity;
+    const quint32 head = loadAcquire(ring.head);
+    const quint32 tail = loadAcquire(ring.tail);
+
+    size_t n = qMin<size_t>(size, cap - (head - tail));
+    if (!n)
+        return 0;
+
+    char* base = ringData(s, r);
+    const quint32 pos = head & (cap - 1);
+    const size_t first = qMin<size_t>(n, cap - pos);
+    std::memcpy(base + pos, data, first);
+    std::memcpy(base, data + first, n - first);
+
+    storeRelease(ring.head, head + n);
+    return n;
+}
+
+static QByteArray ringReadAll(ShmSegment* s, int r)
+{
+    ShmRing& ring = s->rings[r];
+    const quint32 cap = s->capacity;
+    const quint32 tail = loadAcquire(ring.tail);
+    const quint32 head = loadAcquire(ring.head);
+
+    const size_t n = head - tail;
+    QByteArray out;
+    if (!n)
+        return out;
+    out.resize(n);
+
+    const char* base = ringData(s, r);
+    const quint32 pos = tail & (cap - 1);
+    const size_t first = qMin<size_t>(n, cap - pos);
+    std::memcpy(out.data(), base + pos, first);
+    std::memcpy(out.data() + first, base, n - first);
+
+    storeRelease(ring.tail, tail + n);
+    return out;
+}
+
+// false if there is no process with the pid (any longer)
+static bool processAlive(quint32 pid)
+{
+    return ::kill(pid_t(pid), 0) == 0 || errno != ESRCH;
+}
+
+
+/// ///////////////////////////////////////////
+/// /// NOTIFIER //////////////////////////////
+/// ///////////////////////////////////////////
+
+ShmNotifier::ShmNotifier(const QString& key, QSystemSemaphore::AccessMode mode)
+    : sem_(key, 0, mode)
+{
+    connect ( this, SIGNAL ( posted() ),
+              this, SLOT ( handlePosted() ), Qt::QueuedConnection );
+}
+
+ShmNotifier::~ShmNotifier()
+{
+    stop();
+}
+
+void ShmNotifier::start()
+{
+    storeRelease(stop_, 0);
+    thread_ = boost::thread(boost::bind(&ShmNotifier::run, this));
+}
+
+void ShmNotifier::stop()
+{
+    if (!thread_.joinable())
+        return;
+
+    //wake the thread up
+    storeRelease(stop_, 1);
+    sem_.release();
+    thread_.join();
+}
+
+void ShmNotifier::run()
+{
+    while (true)
+    {
+        if (!sem_.acquire())
+        {
+            DEBUG(D_ERROR,"(ShmNotifier::run) " << sem_.errorString().toStdString());
+            break;
+        }
+        if (loadAcquire(stop_))
+            break;
+
+        //only one wakeup queued at a time
+        if (pending_.testAndSetOrdered(0, 1))
+            emit posted();
+    }
+}
+
+void ShmNotifier::handlePosted()
+{
+    storeRelease(pending_, 0);
+    emit notified();
+}
+
+
+/// ///////////////////////////////////////////
+/// /// CONNECTION ////////////////////////////
+/// ///////////////////////////////////////////
+
+ShmConnection::ShmConnection(Side side, ShmSegment* segment,
+                             QSystemSemaphore* peer, QObject* parent)
+    : Connection(parent),
+      side_(side),
+      segment_(segment),
+      inRing_(side == SERVER_SIDE ? CLIENT_TO_SERVER : SERVER_TO_CLIENT),
+      outRing_(side == SERVER_SIDE ? SERVER_TO_CLIENT : CLIENT_TO_SERVER),
+      peer_(peer),
+      connected_(true),
+      unflushed_(false)
+{
+}
+
+ShmConnection::~ShmConnection()
+{
+    close();
+}
+
+ShmConnection* ShmConnection::connectTo(const std::string& key, QObject* parent,
+                                        int msecs, QString& error)
+{
+    DEBUG(D_COMM,"(ShmConnection::connectTo) Attaching to " << key << ".");
+
+    QString qkey = QString::fromStdString(key);
+    std::auto_ptr<QSharedMemory> memory(new QSharedMemory(qkey));
+    if (!memory->attach())
+    {
+        error = memory->errorString();
+        return 0;
+    }
+
+    ShmSegment* segment = static_cast<ShmSegment*>(memory->data());
+    if (segment->magic != SHM_MAGIC || !loadAcquire(segment->serverState))
+    {
+        error = "(ShmConnection::connectTo) No server listening on " + qkey;
+        return 0;
+    }
+
+    //claim the segment. The server may still be cleaning up
+    //after the previous client, or freeing the one of a client
+    //that died; a live client keeps it.
+    QElapsedTimer timer;
+    timer.start();
+    while (!segment->clientState.testAndSetOrdered(CLIENT_FREE, CLIENT_ATTACHED))
+    {
+        const quint32 owner = loadAcquire(segment->clientPid);
+        if (loadAcquire(segment->clientState) == CLIENT_ATTACHED && owner &&
+            owner != quint32(getpid()) && processAlive(owner))
+        {
+            error = "(ShmConnection::connectTo) " + qkey + " is used by process "
+                    + QString::number(owner) + ". The shm transport serves one process"
+                    " per session, use a tcp: or local: endpoint to test applications"
+                    " that start several processes.";
+            return 0;
+        }
+        if (timer.elapsed() > msecs)
+        {
+            error = "(ShmConnection::connectTo) Server busy on " + qkey;
+            return 0;
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    }
+    storeRelease(segment->clientPid, quint32(getpid()));
+
+    std::auto_ptr<QSystemSemaphore> toServer(
+                new QSystemSemaphore(qkey + "_c2s", 0, QSystemSemaphore::Open));
+
+    ShmConnection* c = new ShmConnection(CLIENT_SIDE, segment, toServer.get(), parent);
+    c->memory_ = memory;
+    c->ownPeer_ = toServer;
+    c->notifier_.reset(new ShmNotifier(qkey + "_s2c", QSystemSemaphore::Open));
+    connect ( c->notifier_.get(), SIGNAL ( notified() ),
+              c, SLOT ( handleNotified() ) );
+    c->notifier_->start();
+
+    //tell the server we are here
+    c->peer_->release();
+
+    return c;
+}
+
+bool ShmConnection::isConnected() const
+{
+    return segment_ && connected_;
+}
+
+bool ShmConnection::peerGone() const
+{
+    if (side_ == SERVER_SIDE)
+        return loadAcquire(segment_->clientState) != CLIENT_ATTACHED;
+    return !loadAcquire(segment_->serverState);
+}
+
+bool ShmConnection::write(const char* data, size_t size)
+{
+    if (!isConnected())
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (true)
+    {
+        size_t n = ringWrite(segment_, outRing_, data, size);
+        data += n;
+        size -= n;
+        if (!size)
+            break;
+
+        //ring full: let the reader drain it
+        if (n || unflushed_)
+        {
+            peer_->release();
+            unflushed_ = false;
+        }
+        if (peerGone() || timer.elapsed() > SHM_WRITE_TIMEOUT)
+        {
+            emit error("(ShmConnection::write) Peer is not reading.");
+            return false;
+        }
+        boost::this_thread::sleep(boost::posix_time::microseconds(50));
+    }
+
+    unflushed_ = true;
+    return true;
+}
+
+void ShmConnection::flush()
+{
+    if (unflushed_ && isConnected())
+        peer_->release();
+    unflushed_ = false;
+}
+
+QByteArray ShmConnection::readAll()
+{
+    if (!segment_)
+        return QByteArray();
+    return ringReadAll(segment_, inRing_);
+}
+
+void ShmConnection::close()
+{
+    if (notifier_.get())
+        notifier_->stop();
+
+    if (!isConnected())
+        return;
+    connected_ = false;
+
+    //the server resets the rings when it sees the client leaving
+    if (side_ == CLIENT_SIDE)
+    {
+        storeRelease(segment_->clientState, CLIENT_DETACHED);
+        peer_->release();
+    }
+}
+
+void ShmConnection::detachSegment()
+{
+    connected_ = false;
+    segment_ = 0;
+}
+
+void ShmConnection::handleNotified()
+{
+    if (!segment_)
+        return;
+
+    if (!ringEmpty(segment_, inRing_))
+        emit readyRead();
+
+    //the readyRead slots may have reentered this method
+    if (connected_ && peerGone())
+    {
+        connected_ = false;
+        emit disconnected();
+    }
+}
+
+
+/// ///////////////////////////////////////////
+/// /// SERVER ////////////////////////////////
+/// ///////////////////////////////////////////
+
+ShmServer::ShmServer(QObject* parent)
+    : Server(parent), liveness_(this), segment_(0), pending_(0)
+{
+}
+
+ShmServer::~ShmServer()
+{
+    close();
+    delete pending_;
+}
+
+bool ShmServer::listen(const std::string& key)
+{
+    QString qkey = QString::fromStdString(key);
+    const int size = SEGMENT_HEADER_SIZE + 2 * SHM_RING_SIZE;
+
+    memory_.reset(new QSharedMemory(qkey));
+    if (!memory_->create(size))
+    {
+        //a crashed server may have left the segment behind,
+        //the last detach destroys it
+        if (memory_->error() == QSharedMemory::AlreadyExists &&
+            memory_->attach())
+        {
+            memory_->detach();
+            memory_->create(size);
+        }
+        if (!memory_->isAttached())
+        {
+            error_ = memory_->errorString();
+            memory_.reset(0);
+            return false;
+        }
+    }
+
+    segment_ = new (memory_->data()) ShmSegment;
+    segment_->magic = SHM_MAGIC;
+    segment_->capacity = SHM_RING_SIZE;
+    ringReset(segment_, CLIENT_TO_SERVER);
+    ringReset(segment_, SERVER_TO_CLIENT);
+    storeRelease(segment_->clientState, CLIENT_FREE);
+    storeRelease(segment_->clientPid, 0);
+    storeRelease(segment_->serverState, 1);
+
+    toClient_.reset(new QSystemSemaphore(qkey + "_s2c", 0, QSystemSemaphore::Create));
+    notifier_.reset(new ShmNotifier(qkey + "_c2s", QSystemSemaphore::Create));
+    connect ( notifier_.get(), SIGNAL ( notified() ),
+              this, SLOT ( handleNotified() ) );
+    notifier_->start();
+
+    connect ( &liveness_, SIGNAL ( timeout() ),
+              this, SLOT ( checkClient() ) );
+    liveness_.start(SHM_LIVENESS_INTERVAL);
+
+    key_ = key;
+    DEBUG(D_COMM,"(ShmServer::listen) Segment " << key << " created, "
+          << size << " bytes.");
+    return true;
+}
+
+std::string ShmServer::address() const
+{
+    return key_;
+}
+
+Connection* ShmServer::nextPendingConnection()
+{
+    ShmConnection* c = pending_;
+    pending_ = 0;
+    return c;
+}
+
+QString ShmServer::errorString() const
+{
+    return error_;
+}
+
+void ShmServer::close()
+{
+    if (!segment_)
+        return;
+
+    notifier_->stop();
+    liveness_.stop();
+
+    //wake the client up so it sees the server leaving
+    storeRelease(segment_->serverState, 0);
+    toClient_->release();
+
+    if (current_)
+        current_->detachSegment();
+    current_ = 0;
+
+    segment_ = 0;
+    memory_.reset(0);
+}
+
+void ShmServer::handleNotified()
+{
+    if (!segment_)
+        return;
+
+    const quint32 state = loadAcquire(segment_->clientState);
+
+    //a new client
+    if (state == CLIENT_ATTACHED && !current_ && !pending_)
+    {
+        pending_ = new ShmConnection(ShmConnection::SERVER_SIDE, segment_,
+                                     toClient_.get(), 0);
+        current_ = pending_;
+        emit newConnection();
+    }
+
+    //incoming data and disconnection
+    if (current_)
+        current_->handleNotified();
+
+    //the client left: get ready for the next one
+    if (state == CLIENT_DETACHED)
+    {
+        if (current_)
+            current_->connected_ = false;
+        current_ = 0;
+        ringReset(segment_, CLIENT_TO_SERVER);
+        ringReset(segment_, SERVER_TO_CLIENT);
+        storeRelease(segment_->clientPid, 0);
+        storeRelease(segment_->clientState, CLIENT_FREE);
+    }
+}
+
+void ShmServer::checkClient()
+{
+    if (!segment_ || loadAcquire(segment_->clientState) != CLIENT_ATTACHED)
+        return;
+
+    //the pid is written right after the segment is claimed
+    const quint32 pid = loadAcquire(segment_->clientPid);
+    if (!pid || processAlive(pid))
+        return;
+
+    //detach it as if it had closed the connection
+    DEBUG(D_COMM,"(ShmServer::checkClient) Client " << pid << " died, freeing "
+          << key_ << ".");
+    if (segment_->clientState.testAndSetOrdered(CLIENT_ATTACHED, CLIENT_DETACHED))
+        handleNotified();
+}
@@ -0,0 +1,173 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef SHMTRANSPORT_H
+#define SHMTRANSPORT_H
+
+#include <transport.h>
+#include <QSharedMemory>
+#include <QSystemSemaphore>
+#include <QAtomicInt>
+#include <QPointer>
+#include <QTimer>
+#include <boost/thread.hpp>
+#include <memory>
+
+namespace Transport
+{
+
+    // shared memory layout, see shmtransport.cpp
+    struct ShmSegment;
+
+    ///
+    /// shared memory notifier
+    ///
+    /// Waits on a system semaphore in its own thread and emits
+    /// notified() in the thread the object lives in. Wakeups that
+    /// arrive while one is already queued are merged.
+    ///
+    class ShmNotifier : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        ShmNotifier(const QString& key, QSystemSemaphore::AccessMode);
+        ~ShmNotifier();
+
+        void start();
+        void stop();
+
+    signals:
+        void notified();
+        void posted();//internal, emitted from the waiting thread
+
+    private slots:
+        void handlePosted();
+
+    private:
+        void run();
+
+        QSystemSemaphore sem_;
+        QAtomicInt stop_;
+        QAtomicInt pending_;
+        boost::thread thread_;
+    };
+
+    ///
+    /// shared memory connection
+    ///
+    /// Each direction is a single producer / single consumer ring
+    /// buffer inside the segment. Writers wake the reader through
+    /// a system semaphore when the data is flushed.
+    ///
+    class ShmConnection : public Connection
+    {
+        Q_OBJECT
+
+    public:
+        ~ShmConnection();
+
+        static ShmConnection* connectTo(const std::string& key, QObject* parent,
+                                        int msecs, QString& error);
+
+        bool isConnected() const;
+        bool write(const char* data, size_t size);
+        void flush();
+        QByteArray readAll();
+        void close();
+
+    public slots:
+        //checks the incoming ring and the peer state
+        void handleNotified();
+
+    private:
+        friend class ShmServer;
+
+        typedef enum
+        {
+            SERVER_SIDE,
+            CLIENT_SIDE
+        } Side;
+
+        ShmConnection(Side, ShmSegment*, QSystemSemaphore* peer, QObject* parent);
+
+        bool peerGone() const;
+        //the server closed the segment
+        void detachSegment();
+
+        Side side_;
+        ShmSegment* segment_;
+        int inRing_;
+        int outRing_;
+        QSystemSemaphore* peer_;
+        bool connected_;
+        bool unflushed_;
+
+        //only for the client side
+        std::auto_ptr<QSharedMemory> memory_;
+        std::auto_ptr<QSystemSemaphore> ownPeer_;
+        std::auto_ptr<ShmNotifier> notifier_;
+    };
+
+    ///
+    /// shared memory server
+    ///
+    /// Owns the segment. One client process can be attached at a
+    /// time: another one is refused while it is alive, so the shm
+    /// transport does not suit applications that start several
+    /// processes. The server checks the client pid every
+    /// SHM_LIVENESS_INTERVAL ms and frees the segment of a client
+    /// that died without detaching.
+    ///
+    class ShmServer : public Server
+    {
+        Q_OBJECT
+
+    public:
+        ShmServer(QObject* parent);
+        ~ShmServer();
+
+        bool listen(const std::string& key);
+        std::string address() const;
+        Connection* nextPendingConnection();
+        QString errorString() const;
+        void close();
+
+    private slots:
+        void handleNotified();
+        //frees the segment if the client process is gone
+        void checkClient();
+
+    private:
+        std::auto_ptr<QSharedMemory> memory_;
+        std::auto_ptr<QSystemSemaphore> toClient_;
+        std::auto_ptr<ShmNotifier> notifier_;
+        QTimer liveness_;
+        ShmSegment* segment_;
+        ShmConnection* pending_;
+        QPointer<ShmConnection> current_;
+        QString error_;
+        std::string key_;
+    };
+}
+
+#endif // SHMTRANSPORT_H
@@ -0,0 +1,276 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "sockettransport.h"
+
+#include <QHostAddress>
+#include <ohtbaseconfig.h>
+#include <debug.h>
+#include <cstdlib>
+
+using namespace Transport;
+
+
+/// ///////////////////////////////////////////
+/// /// TCP ///////////////////////////////////
+/// ///////////////////////////////////////////
+
+TcpConnection::TcpConnection(QTcpSocket* s, QObject* parent)
+    : Connection(parent), socket_(s)
+{
+    socket_->setParent(this);
+
+    //every frame is a round trip, do not wait for more data
+    socket_->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    connect ( socket_, SIGNAL ( readyRead() ),
+              this, SIGNAL ( readyRead() ) );
+    connect ( socket_, SIGNAL ( error ( QAbstractSocket::SocketError ) ),
+              this, SLOT ( handleError ( QAbstractSocket::SocketError ) ) );
+}
+
+TcpConnection::~TcpConnection()
+{
+}
+
+TcpConnection* TcpConnection::connectTo(const std::string& port, QObject* parent,
+                                        int msecs, QString& error)
+{
+    DEBUG(D_COMM,"(TcpConnection::connectTo) Connecting to address "
+          << SERVER_IP << " and port " << port << ".");
+
+    QTcpSocket* s = new QTcpSocket();
+    s->connectToHost(QHostAddress(SERVER_IP), std::atoi(port.c_str()));
+    if (!s->waitForConnected(msecs))
+    {
+        error = s->errorString();
+        delete s;
+        return 0;
+    }
+    return new TcpConnection(s, parent);
+}
+
+bool TcpConnection::isConnected() const
+{
+    return socket_->state() == QAbstractSocket::ConnectedState;
+}
+
+bool TcpConnection::write(const char* data, size_t size)
+{
+    return socket_->write(data, size) == static_cast<qint64>(size);
+}
+
+void TcpConnection::flush()
+{
+    socket_->flush();
+}
+
+QByteArray TcpConnection::readAll()
+{
+    return socket_->readAll();
+}
+
+void TcpConnection::close()
+{
+    socket_->close();
+}
+
+void TcpConnection::handleError(QAbstractSocket::SocketError socketError)
+{
+    QString errorString = "(TcpConnection::handleError) "
+            + QString::number(socketError) + ": ";
+
+    switch ( socketError )
+    {
+
+    case QAbstractSocket::RemoteHostClosedError:
+        errorString += "Remote host closed connection.";
+        //here it also handles the peer disconnection
+        emit disconnected();
+        break;
+
+    case QAbstractSocket::HostNotFoundError:
+        errorString += "The host was not found. Please check the host name and port settings.";
+        break;
+
+    case QAbstractSocket::ConnectionRefusedError:
+        errorString += "The connection was refused by the peer. Make sure the server is running, and check that the host name and port settings are correct.";
+        break;
+
+    default:
+        errorString += socket_->errorString();
+    }
+
+    emit error(errorString);
+}
+
+
+TcpServer::TcpServer(QObject* parent)
+    : Server(parent)
+{
+    connect ( &server_, SIGNAL ( newConnection() ),
+              this, SIGNAL ( newConnection() ) );
+}
+
+bool TcpServer::listen(const std::string& port)
+{
+    return server_.listen(QHostAddress(SERVER_IP), std::atoi(port.c_str()));
+}
+
+std::string TcpServer::address() const
+{
+    return QString::number(server_.serverPort()).toStdString();
+}
+
+Connection* TcpServer::nextPendingConnection()
+{
+    QTcpSocket* s = server_.nextPendingConnection();
+    if (!s)
+        return 0;
+    return new TcpConnection(s, 0);
+}
+
+QString TcpServer::errorString() const
+{
+    return server_.errorString();
+}
+
+void TcpServer::close()
+{
+    server_.close();
+}
+
+
+/// ///////////////////////////////////////////
+/// /// LOCAL SOCKET //////////////////////////
+/// ///////////////////////////////////////////
+
+LocalConnection::LocalConnection(QLocalSocket* s, QObject* parent)
+    : Connection(parent), socket_(s)
+{
+    socket_->setParent(this);
+
+    connect ( socket_, SIGNAL ( readyRead() ),
+              this, SIGNAL ( readyRead() ) );
+    connect ( socket_, SIGNAL ( error ( QLocalSocket::LocalSocketError ) ),
+              this, SLOT ( handleError ( QLocalSocket::LocalSocketError ) ) );
+}
+
+LocalConnection::~LocalConnection()
+{
+}
+
+LocalConnection* LocalConnection::connectTo(const std::string& name, QObject* parent,
+                                            int msecs, QString& error)
+{
+    DEBUG(D_COMM,"(LocalConnection::connectTo) Connecting to " << name << ".");
+
+    QLocalSocket* s = new QLocalSocket();
+    s->connectToServer(QString::fromStdString(name));
+    if (!s->waitForConnected(msecs))
+    {
+        error = s->errorString();
+        delete s;
+        return 0;
+    }
+    return new LocalConnection(s, parent);
+}
+
+bool LocalConnection::isConnected() const
+{
+    return socket_->state() == QLocalSocket::ConnectedState;
+}
+
+bool LocalConnection::write(const char* data, size_t size)
+{
+    return socket_->write(data, size) == static_cast<qint64>(size);
+}
+
+void LocalConnection::flush()
+{
+    socket_->flush();
+}
+
+QByteArray LocalConnection::readAll()
+{
+    return socket_->readAll();
+}
+
+void LocalConnection::close()
+{
+    socket_->close();
+}
+
+void LocalConnection::handleError(QLocalSocket::LocalSocketError socketError)
+{
+    QString errorString = "(LocalConnection::handleError) "
+            + QString::number(socketError) + ": ";
+
+    if (socketError == QLocalSocket::PeerClosedError)
+    {
+        errorString += "Peer closed connection.";
+        emit disconnected();
+    }
+    else
+        errorString += socket_->errorString();
+
+    emit error(errorString);
+}
+
+
+LocalServer::LocalServer(QObject* parent)
+    : Server(parent)
+{
+    connect ( &server_, SIGNAL ( newConnection() ),
+              this, SIGNAL ( newConnection() ) );
+}
+
+bool LocalServer::listen(const std::string& name)
+{
+    //remove the socket file left by a crashed server
+    QLocalServer::removeServer(QString::fromStdString(name));
+    return server_.listen(QString::fromStdString(name));
+}
+
+std::string LocalServer::address() const
+{
+    return server_.serverName().toStdString();
+}
+
+Connection* LocalServer::nextPendingConnection()
+{
+    QLocalSocket* s = server_.nextPendingConnection();
+    if (!s)
+        return 0;
+    return new LocalConnection(s, 0);
+}
+
+QString LocalServer::errorString() const
+{
+    return server_.errorString();
+}
+
+void LocalServer::close()
+{
+    server_.close();
+}
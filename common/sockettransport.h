@@ -0,0 +1,126 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef SOCKETTRANSPORT_H
+#define SOCKETTRANSPORT_H
+
+#include <transport.h>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+namespace Transport
+{
+
+    ///
+    /// tcp backend
+    ///
+    class TcpConnection : public Connection
+    {
+        Q_OBJECT
+
+    public:
+        // takes the ownership of the socket
+        TcpConnection(QTcpSocket*, QObject* parent);
+        ~TcpConnection();
+
+        static TcpConnection* connectTo(const std::string& port, QObject* parent,
+                                        int msecs, QString& error);
+
+        bool isConnected() const;
+        bool write(const char* data, size_t size);
+        void flush();
+        QByteArray readAll();
+        void close();
+
+    private slots:
+        void handleError(QAbstractSocket::SocketError);
+
+    private:
+        QTcpSocket* socket_;
+    };
+
+    class TcpServer : public Server
+    {
+        Q_OBJECT
+
+    public:
+        TcpServer(QObject* parent);
+
+        bool listen(const std::string& port);
+        std::string address() const;
+        Connection* nextPendingConnection();
+        QString errorString() const;
+        void close();
+
+    private:
+        QTcpServer server_;
+    };
+
+    ///
+    /// local socket backend
+    ///
+    class LocalConnection : public Connection
+    {
+        Q_OBJECT
+
+    public:
+        // takes the ownership of the socket
+        LocalConnection(QLocalSocket*, QObject* parent);
+        ~LocalConnection();
+
+        static LocalConnection* connectTo(const std::string& name, QObject* parent,
+                                          int msecs, QString& error);
+
+        bool isConnected() const;
+        bool write(const char* data, size_t size);
+        void flush();
+        QByteArray readAll();
+        void close();
+
+    private slots:
+        void handleError(QLocalSocket::LocalSocketError);
+
+    private:
+        QLocalSocket* socket_;
+    };
+
+    class LocalServer : public Server
+    {
+        Q_OBJECT
+
+    public:
+        LocalServer(QObject* parent);
+
+        bool listen(const std::string& name);
+        std::string address() const;
+        Connection* nextPendingConnection();
+        QString errorString() const;
+        void close();
+
+    private:
+        QLocalServer server_;
+    };
+}
+
+#endif // SOCKETTRANSPORT_H
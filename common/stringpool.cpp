@@ -0,0 +1,77 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "stringpool.h"
+
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace
+{
+    const size_t SHARDS = 16;
+
+    // the set nodes do not move on rehash, their addresses are
+    // the interned strings
+    struct Shard
+    {
+        boost::mutex mutex;
+        boost::unordered_set<std::string> strings;
+    };
+
+    Shard* shards()
+    {
+        // function static, so the pool can be used during the static
+        // initialization of other files
+        static Shard pool[SHARDS];
+        return pool;
+    }
+}
+
+InternedString StringPool::intern(const std::string& s)
+{
+    Shard& shard = shards()[boost::hash<std::string>()(s) % SHARDS];
+
+    boost::mutex::scoped_lock lock(shard.mutex);
+    return &*shard.strings.insert(s).first;
+}
+
+InternedString StringPool::find(const std::string& s)
+{
+    Shard& shard = shards()[boost::hash<std::string>()(s) % SHARDS];
+
+    boost::mutex::scoped_lock lock(shard.mutex);
+    boost::unordered_set<std::string>::const_iterator it = shard.strings.find(s);
+    return it != shard.strings.end() ? &*it : 0;
+}
+
+size_t StringPool::size()
+{
+    size_t n = 0;
+    for (size_t i = 0; i < SHARDS; i++)
+    {
+        boost::mutex::scoped_lock lock(shards()[i].mutex);
+        n += shards()[i].strings.size();
+    }
+    return n;
+}
@@ -0,0 +1,55 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <string>
+
+///
+/// string pool
+///
+/// Keeps one copy of each interned string for the whole process, so
+/// the repeated keys and widget paths of the test items share their
+/// storage and two interned strings are equal if their pointers are.
+/// The pooled strings are never released. Thread-safe: the pool is
+/// split into shards with a lock each, so concurrent loaders seldom
+/// wait for each other.
+///
+typedef const std::string* InternedString;
+
+class StringPool
+{
+public:
+    // the pooled copy of the string
+    static InternedString intern(const std::string&);
+    // the pooled copy of the string, 0 if it has not been interned
+    static InternedString find(const std::string&);
+
+    // strings in the pool
+    static size_t size();
+
+private:
+    StringPool();
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,499 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "testitemcodec.h"
+
+#include <cstring>
+
+using namespace Protocol;
+
+///
+/// varint helpers
+///
+
+void Protocol::putVarint(std::string& out, unsigned long long v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void Protocol::putSignedVarint(std::string& out, long long v)
+{
+    // zigzag: small negative numbers use few bytes too
+    unsigned long long u = (static_cast<unsigned long long>(v) << 1) ^
+            static_cast<unsigned long long>(v >> 63);
+    putVarint(out, u);
+}
+
+void Protocol::putString(std::string& out, const std::string& s)
+{
+    putVarint(out, s.size());
+    out.append(s);
+}
+
+bool Protocol::getVarint(const char*& p, const char* end, unsigned long long& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (p == end)
+            return false;
+        unsigned char b = static_cast<unsigned char>(*p++);
+        v |= static_cast<unsigned long long>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    // too long
+    return false;
+}
+
+bool Protocol::getSignedVarint(const char*& p, const char* end, long long& v)
+{
+    unsigned long long u;
+    if (!getVarint(p, end, u))
+        return false;
+    v = static_cast<long long>(u >> 1) ^ -static_cast<long long>(u & 1);
+    return true;
+}
+
+bool Protocol::getString(const char*& p, const char* end, std::string& s)
+{
+    unsigned long long len;
+    if (!getVarint(p, end, len))
+        return false;
+    if (len > static_cast<unsigned long long>(end - p))
+        return false;
+    s.assign(p, static_cast<size_t>(len));
+    p += len;
+    return true;
+}
+
+///
+/// dictionary
+///
+
+static const DataModel::FieldKey widgetKey = DataModel::fieldKey(DataModel::WIDGET_DATA);
+
+TestItemCodec::Dictionary::Dictionary()
+    : lastUuid_(0)
+{
+}
+
+void TestItemCodec::Dictionary::clear()
+{
+    ids_.clear();
+    strings_.clear();
+    keys_.clear();
+    lastUuid_ = 0;
+}
+
+size_t TestItemCodec::Dictionary::size() const
+{
+    return ids_.size() + strings_.size();
+}
+
+// dictionary tags
+static const unsigned long long TAG_NEW = 0;
+static const unsigned long long TAG_LITERAL = 1;
+static const unsigned long long TAG_FIRST_ID = 2;
+
+static void putInterned(std::string& out, const std::string& s,
+                        std::map<std::string, unsigned int>& ids)
+{
+    std::map<std::string, unsigned int>::iterator it = ids.lower_bound(s);
+    if (it != ids.end() && it->first == s)
+    {
+        putVarint(out, TAG_FIRST_ID + it->second);
+        return;
+    }
+
+    if (ids.size() < TestItemCodec::DICTIONARY_SIZE)
+    {
+        unsigned int id = ids.size();
+        ids.insert(it, std::make_pair(s, id));
+        putVarint(out, TAG_NEW);
+    }
+    else
+        putVarint(out, TAG_LITERAL);
+    putString(out, s);
+}
+
+// reads an interned string, returns its dictionary id (or -1)
+static bool getInterned(const char*& p, const char* end, std::string& s,
+                        std::vector<std::string>& strings,
+                        std::vector<InternedString>& keys, long long& id)
+{
+    unsigned long long tag;
+    if (!getVarint(p, end, tag))
+        return false;
+
+    if (tag >= TAG_FIRST_ID)
+    {
+        if (tag - TAG_FIRST_ID >= strings.size())
+            return false;
+        id = static_cast<long long>(tag - TAG_FIRST_ID);
+        s = strings[id];
+        return true;
+    }
+
+    if (!getString(p, end, s))
+        return false;
+    id = -1;
+    if (tag == TAG_NEW)
+    {
+        // the peer keeps the same limit
+        if (strings.size() >= TestItemCodec::DICTIONARY_SIZE)
+            return false;
+        id = strings.size();
+        strings.push_back(s);
+        keys.push_back(0);
+    }
+    return true;
+}
+
+static bool getInterned(const char*& p, const char* end, std::string& s,
+                        std::vector<std::string>& strings,
+                        std::vector<InternedString>& keys)
+{
+    long long id;
+    return getInterned(p, end, s, strings, keys, id);
+}
+
+///
+/// map helpers
+///
+
+static void putMap(std::string& out, const DataModel::KeyValueMap& map,
+                   std::map<std::string, unsigned int>* ids)
+{
+    putVarint(out, map.size());
+    DataModel::KeyValueMap::const_iterator it;
+    for (it = map.begin(); it != map.end(); ++it)
+    {
+        if (!ids)
+        {
+            putString(out, it->first);
+            putString(out, it->second);
+            continue;
+        }
+
+        putInterned(out, it->first, *ids);
+        if (it->first == DataModel::WIDGET_DATA)
+            putInterned(out, it->second, *ids);
+        else
+            putString(out, it->second);
+    }
+}
+
+static bool getMap(const char*& p, const char* end, DataModel::KeyValueMap& map,
+                   std::vector<std::string>* strings,
+                   std::vector<InternedString>* keys)
+{
+    unsigned long long count;
+    if (!getVarint(p, end, count))
+        return false;
+
+    map.clear();
+    std::string key, value;
+    // the input is sorted, so every insertion goes at the end
+    DataModel::KeyValueMap::iterator hint = map.end();
+    for (unsigned long long i = 0; i < count; i++)
+    {
+        bool ok;
+        if (!strings)
+            ok = getString(p, end, key) && getString(p, end, value);
+        else if (!getInterned(p, end, key, *strings, *keys))
+            ok = false;
+        else if (key == DataModel::WIDGET_DATA)
+            ok = getInterned(p, end, value, *strings, *keys);
+        else
+            ok = getString(p, end, value);
+
+        if (!ok)
+            return false;
+        hint = map.insert(hint, std::make_pair(key, value));
+    }
+    return true;
+}
+
+///
+/// typed field helpers
+///
+
+static void putDouble(std::string& out, double d)
+{
+    unsigned long long u;
+    std::memcpy(&u, &d, sizeof(u));
+    for (int i = 0; i < 8; i++)
+        out.push_back(static_cast<char>((u >> (i * 8)) & 0xff));
+}
+
+static bool getDouble(const char*& p, const char* end, double& d)
+{
+    if (end - p < 8)
+        return false;
+    unsigned long long u = 0;
+    for (int i = 0; i < 8; i++)
+        u |= static_cast<unsigned long long>(static_cast<unsigned char>(*p++)) << (i * 8);
+    std::memcpy(&d, &u, sizeof(d));
+    return true;
+}
+
+static void putFields(std::string& out, const DataModel::FieldList& fields,
+                      std::map<std::string, unsigned int>* ids)
+{
+    putVarint(out, fields.size());
+    DataModel::FieldList::const_iterator it;
+    for (it = fields.begin(); it != fields.end(); ++it)
+    {
+        const std::string& key = *it->key;
+        if (ids)
+            putInterned(out, key, *ids);
+        else
+            putString(out, key);
+
+        const DataModel::FieldValue& v = it->value;
+        out.push_back(static_cast<char>(v.type()));
+        switch (v.type())
+        {
+        case DataModel::FieldValue::INT:
+            putSignedVarint(out, v.toInt());
+            break;
+        case DataModel::FieldValue::DOUBLE:
+            putDouble(out, v.toDouble());
+            break;
+        case DataModel::FieldValue::BOOL:
+            out.push_back(v.toBool() ? 1 : 0);
+            break;
+        case DataModel::FieldValue::STRING:
+            if (ids && it->key == widgetKey)
+                putInterned(out, v.string(), *ids);
+            else
+                putString(out, v.string());
+            break;
+        }
+    }
+}
+
+// reads an interned string, as a pooled copy
+static bool getPooled(const char*& p, const char* end, InternedString& pooled,
+                      std::vector<std::string>& strings,
+                      std::vector<InternedString>& keys)
+{
+    // the dictionary strings are only looked up in the pool once
+    std::string s;
+    long long id;
+    if (!getInterned(p, end, s, strings, keys, id))
+        return false;
+    if (id < 0)
+        pooled = StringPool::intern(s);
+    else
+    {
+        if (!keys[id])
+            keys[id] = StringPool::intern(s);
+        pooled = keys[id];
+    }
+    return true;
+}
+
+static bool getFieldKey(const char*& p, const char* end, DataModel::FieldKey& key,
+                        std::vector<std::string>* strings,
+                        std::vector<InternedString>* keys)
+{
+    if (strings)
+        return getPooled(p, end, key, *strings, *keys);
+
+    std::string name;
+    if (!getString(p, end, name))
+        return false;
+    key = DataModel::fieldKey(name);
+    return true;
+}
+
+static bool getFields(const char*& p, const char* end, DataModel::TestItem& ti,
+                      std::vector<std::string>* strings,
+                      std::vector<InternedString>* keys)
+{
+    unsigned long long count;
+    if (!getVarint(p, end, count))
+        return false;
+
+    for (unsigned long long i = 0; i < count; i++)
+    {
+        DataModel::FieldKey key;
+        if (!getFieldKey(p, end, key, strings, keys) || p == end)
+            return false;
+
+        unsigned char type = static_cast<unsigned char>(*p++);
+        switch (type)
+        {
+        case DataModel::FieldValue::INT:
+        {
+            long long n;
+            if (!getSignedVarint(p, end, n))
+                return false;
+            ti.setField(key, DataModel::FieldValue(n));
+            break;
+        }
+        case DataModel::FieldValue::DOUBLE:
+        {
+            double d;
+            if (!getDouble(p, end, d))
+                return false;
+            ti.setField(key, DataModel::FieldValue(d));
+            break;
+        }
+        case DataModel::FieldValue::BOOL:
+            if (p == end)
+                return false;
+            ti.setField(key, DataModel::FieldValue(*p++ != 0));
+            break;
+        case DataModel::FieldValue::STRING:
+        {
+            if (key == widgetKey)
+            {
+                InternedString pooled;
+                if (strings)
+                {
+                    if (!getPooled(p, end, pooled, *strings, *keys))
+                        return false;
+                }
+                else
+                {
+                    std::string s;
+                    if (!getString(p, end, s))
+                        return false;
+                    pooled = StringPool::intern(s);
+                }
+                ti.setField(key, DataModel::FieldValue(pooled));
+                break;
+            }
+
+            std::string s;
+            if (!getString(p, end, s))
+                return false;
+            ti.setField(key, DataModel::FieldValue(s));
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+///
+/// codec
+///
+
+void TestItemCodec::encode(const DataModel::TestItem& ti, std::string& out)
+{
+    out.push_back(static_cast<char>(VERSION));
+    putVarint(out, ti.uuid_);
+    putSignedVarint(out, ti.type_);
+    putSignedVarint(out, ti.subtype_);
+    putSignedVarint(out, ti.timestamp_);
+    putMap(out, ti.dataMap_, 0);
+    putMap(out, ti.metadataMap_, 0);
+    putFields(out, ti.fields_, 0);
+}
+
+void TestItemCodec::encode(const DataModel::TestItem& ti, Dictionary& dictionary,
+                           std::string& out)
+{
+    out.push_back(static_cast<char>(DICTIONARY_VERSION));
+    putSignedVarint(out, static_cast<long long>(ti.uuid_ - dictionary.lastUuid_));
+    dictionary.lastUuid_ = ti.uuid_;
+    putSignedVarint(out, ti.type_);
+    putSignedVarint(out, ti.subtype_);
+    putSignedVarint(out, ti.timestamp_);
+    putMap(out, ti.dataMap_, &dictionary.ids_);
+    putMap(out, ti.metadataMap_, &dictionary.ids_);
+    putFields(out, ti.fields_, &dictionary.ids_);
+}
+
+bool TestItemCodec::decode(const char* data, size_t size, DataModel::TestItem& ti)
+{
+    return _decode(data, size, 0, ti);
+}
+
+bool TestItemCodec::decode(const char* data, size_t size, Dictionary& dictionary,
+                           DataModel::TestItem& ti)
+{
+    return _decode(data, size, &dictionary, ti);
+}
+
+bool TestItemCodec::_decode(const char* data, size_t size, Dictionary* dictionary,
+                            DataModel::TestItem& ti)
+{
+    const char* p = data;
+    const char* end = data + size;
+
+    if (p == end)
+        return false;
+    unsigned char version = static_cast<unsigned char>(*p++);
+    if (version != VERSION && !(version == DICTIONARY_VERSION && dictionary))
+        return false;
+    std::vector<std::string>* strings = 0;
+    std::vector<InternedString>* keys = 0;
+    if (version == DICTIONARY_VERSION)
+    {
+        strings = &dictionary->strings_;
+        keys = &dictionary->keys_;
+    }
+
+    unsigned long long id;
+    long long delta, type, subtype, timestamp;
+    if (strings)
+    {
+        if (!getSignedVarint(p, end, delta))
+            return false;
+        id = dictionary->lastUuid_ + static_cast<unsigned long long>(delta);
+    }
+    else if (!getVarint(p, end, id))
+        return false;
+    if (!getSignedVarint(p, end, type) ||
+        !getSignedVarint(p, end, subtype) ||
+        !getSignedVarint(p, end, timestamp))
+        return false;
+
+    ti.fields_.clear();
+    if (!getMap(p, end, ti.dataMap_, strings, keys) ||
+        !getMap(p, end, ti.metadataMap_, strings, keys) ||
+        !getFields(p, end, ti, strings, keys))
+        return false;
+
+    ti.uuid_ = id;
+    if (strings)
+        dictionary->lastUuid_ = id;
+    ti.type_ = static_cast<int>(type);
+    ti.subtype_ = static_cast<int>(subtype);
+    ti.timestamp_ = static_cast<int>(timestamp);
+
+    // trailing garbage means a corrupted payload
+    return p == end;
+}
@@ -0,0 +1,125 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef TESTITEMCODEC_H
+#define TESTITEMCODEC_H
+
+#include <datamodel.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Protocol
+{
+
+    ///
+    /// binary test item codec
+    ///
+    /// Encodes a TestItem as:
+    ///   codec version (1 byte)
+    ///   uuid (varint)
+    ///   type, subtype, timestamp (zigzag varints)
+    ///   data map: count (varint), then length prefixed key/value pairs
+    ///   metadata map: same as data map
+    ///   typed fields: count (varint), then the key, the value type
+    ///     (1 byte) and the value: zigzag varint (INT), 8 bytes (DOUBLE),
+    ///     1 byte (BOOL) or length prefixed (STRING)
+    ///
+    /// Integers are written byte by byte, so the output does not depend
+    /// on the host locale or endianness.
+    ///
+    /// Items sent over a connection use a dictionary of the strings
+    /// already seen on it (DICTIONARY_VERSION). The map and field keys
+    /// and the widget paths (DataModel::WIDGET_DATA) are written as a
+    /// varint tag:
+    ///   0      new string, follows length prefixed, takes the next id
+    ///   1      string not kept (full dictionary), follows length prefixed
+    ///   id+2   string defined before
+    /// The uuid is written as the zigzag difference to the uuid of the
+    /// previous item of the connection, so the ids of one process stay
+    /// short. Both sides of the connection keep a Dictionary, and the
+    /// items have to be decoded in the order they were encoded.
+    ///
+    class TestItemCodec
+    {
+    public:
+        static const unsigned char VERSION = 3;
+        static const unsigned char DICTIONARY_VERSION = 5;
+
+        // strings kept per connection and direction
+        static const size_t DICTIONARY_SIZE = 4096;
+
+        ///
+        /// strings seen on a connection, in one direction
+        ///
+        class Dictionary
+        {
+        public:
+            Dictionary();
+
+            void clear();
+            size_t size() const;
+
+        private:
+            friend class TestItemCodec;
+
+            // encoder side
+            std::map<std::string, unsigned int> ids_;
+            // decoder side, with the pooled copies of the strings
+            // (interned on first use)
+            std::vector<std::string> strings_;
+            std::vector<InternedString> keys_;
+            // uuid of the last item, base of the next delta
+            uuid_t lastUuid_;
+        };
+
+        // appends the self-contained encoded item to out
+        static void encode(const DataModel::TestItem&, std::string& out);
+
+        // appends the item encoded with the strings of the dictionary,
+        // adding the new ones to it
+        static void encode(const DataModel::TestItem&, Dictionary&, std::string& out);
+
+        // decodes a self-contained item. Returns false if the data is malformed.
+        static bool decode(const char* data, size_t size, DataModel::TestItem&);
+
+        // decodes an item of any version, using and updating the
+        // dictionary. Returns false if the data is malformed.
+        static bool decode(const char* data, size_t size, Dictionary&, DataModel::TestItem&);
+
+    private:
+        static bool _decode(const char* data, size_t size, Dictionary*, DataModel::TestItem&);
+    };
+
+    ///
+    /// varint helpers (shared with other binary formats)
+    ///
+    void putVarint(std::string& out, unsigned long long v);
+    void putSignedVarint(std::string& out, long long v);
+    void putString(std::string& out, const std::string& s);
+
+    bool getVarint(const char*& p, const char* end, unsigned long long& v);
+    bool getSignedVarint(const char*& p, const char* end, long long& v);
+    bool getString(const char*& p, const char* end, std::string& s);
+}
+
+#endif // TESTITEMCODEC_H
@@ -0,0 +1,207 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "transport.h"
+#include "sockettransport.h"
+#include "shmtransport.h"
+
+#include <ohtbaseconfig.h>
+#include <debug.h>
+#include <QCoreApplication>
+#include <boost/lexical_cast.hpp>
+#include <cstdlib>
+
+using namespace Transport;
+
+
+/// ///////////////////////////////////////////
+/// /// ENDPOINT //////////////////////////////
+/// ///////////////////////////////////////////
+
+Endpoint::Endpoint()
+    : kind_(TCP)
+{
+}
+
+Endpoint::Endpoint(Kind kind, const std::string& address)
+    : kind_(kind), address_(address)
+{
+}
+
+bool Endpoint::parse(const std::string& s, Endpoint& e)
+{
+    std::string::size_type sep = s.find(':');
+    if (sep == std::string::npos || sep + 1 == s.size())
+        return false;
+
+    std::string kind = s.substr(0, sep);
+    std::string address = s.substr(sep + 1);
+
+    if (kind == "tcp")
+    {
+        //only port numbers
+        if (address.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        e = Endpoint(TCP, address);
+    }
+    else if (kind == "local")
+        e = Endpoint(LOCAL, address);
+    else if (kind == "shm")
+        e = Endpoint(SHM, address);
+    else
+        return false;
+
+    return true;
+}
+
+Endpoint Endpoint::fromEnvironment()
+{
+    Endpoint e;
+    const char* env = std::getenv(ENDPOINT_ENVVAR);
+    if (env && *env)
+    {
+        if (parse(env, e))
+            return e;
+        DEBUG(D_ERROR,"(Endpoint::fromEnvironment) Invalid endpoint " << env
+              << ". Using " << DEFAULT_ENDPOINT << ".");
+    }
+
+    bool ok = parse(DEFAULT_ENDPOINT, e);
+    assert(ok);
+    (void)ok;
+    return e;
+}
+
+Endpoint Endpoint::forSession()
+{
+    const char* env = std::getenv(ENDPOINT_ENVVAR);
+    if (env && *env)
+        return fromEnvironment();
+
+    Endpoint e = fromEnvironment();
+    if (e.kind_ == TCP)
+    {
+        //the system chooses a free port
+        e.address_ = "0";
+    }
+    else
+    {
+        //names are unique per process and session
+        static int session = 0;
+        e.address_ += "-" + boost::lexical_cast<std::string>(QCoreApplication::applicationPid())
+                + "-" + boost::lexical_cast<std::string>(session++);
+    }
+    return e;
+}
+
+Endpoint::Kind Endpoint::kind() const
+{
+    return kind_;
+}
+
+const std::string& Endpoint::address() const
+{
+    return address_;
+}
+
+std::string Endpoint::toString() const
+{
+    switch (kind_)
+    {
+    case TCP:
+        return "tcp:" + address_;
+    case LOCAL:
+        return "local:" + address_;
+    case SHM:
+        return "shm:" + address_;
+    }
+    return address_;
+}
+
+
+/// ///////////////////////////////////////////
+/// /// BASE CLASSES //////////////////////////
+/// ///////////////////////////////////////////
+
+Connection::Connection(QObject* parent)
+    : QObject(parent)
+{
+}
+
+Connection::~Connection()
+{
+}
+
+Server::Server(QObject* parent)
+    : QObject(parent)
+{
+}
+
+Server::~Server()
+{
+}
+
+
+/// ///////////////////////////////////////////
+/// /// FACTORY ///////////////////////////////
+/// ///////////////////////////////////////////
+
+Server* Transport::createServer(const Endpoint& e, QObject* parent, QString& error)
+{
+    Server* s = 0;
+    switch (e.kind())
+    {
+    case Endpoint::TCP:
+        s = new TcpServer(parent);
+        break;
+    case Endpoint::LOCAL:
+        s = new LocalServer(parent);
+        break;
+    case Endpoint::SHM:
+        s = new ShmServer(parent);
+        break;
+    }
+
+    if (!s->listen(e.address()))
+    {
+        error = s->errorString();
+        delete s;
+        return 0;
+    }
+    return s;
+}
+
+Connection* Transport::connectTo(const Endpoint& e, QObject* parent, int msecs, QString& error)
+{
+    switch (e.kind())
+    {
+    case Endpoint::TCP:
+        return TcpConnection::connectTo(e.address(), parent, msecs, error);
+    case Endpoint::LOCAL:
+        return LocalConnection::connectTo(e.address(), parent, msecs, error);
+    case Endpoint::SHM:
+        return ShmConnection::connectTo(e.address(), parent, msecs, error);
+    }
+    error = "Unknown transport";
+    return 0;
+}
@@ -0,0 +1,135 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <string>
+
+namespace Transport
+{
+
+    ///
+    /// endpoint
+    ///
+    /// Endpoints are written as "kind:address":
+    ///   tcp:7357     TCP socket on SERVER_IP (tcp:0 listens on a free port)
+    ///   local:name   local socket (unix domain socket)
+    ///   shm:key      shared memory ring buffers (one client process)
+    ///
+    class Endpoint
+    {
+    public:
+        typedef enum
+        {
+            TCP,
+            LOCAL,
+            SHM
+        } Kind;
+
+        Endpoint();
+        Endpoint(Kind, const std::string& address);
+
+        // parses an endpoint string. Returns false if it is not valid.
+        static bool parse(const std::string&, Endpoint&);
+
+        // endpoint set in ENDPOINT_ENVVAR, or DEFAULT_ENDPOINT
+        static Endpoint fromEnvironment();
+
+        // endpoint set in ENDPOINT_ENVVAR, or a new one of the
+        // DEFAULT_ENDPOINT kind that no other HMI Tester uses
+        static Endpoint forSession();
+
+        Kind kind() const;
+        const std::string& address() const;
+        std::string toString() const;
+
+    private:
+        Kind kind_;
+        std::string address_;
+    };
+
+    ///
+    /// connection
+    ///
+    /// A bidirectional byte stream. Writes may be buffered
+    /// until flush() is called.
+    ///
+    class Connection : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        Connection(QObject* parent);
+        virtual ~Connection();
+
+        virtual bool isConnected() const = 0;
+        virtual bool write(const char* data, size_t size) = 0;
+        virtual void flush() = 0;
+        virtual QByteArray readAll() = 0;
+        virtual void close() = 0;
+
+    signals:
+        void readyRead();
+        // emitted when the peer closes the connection
+        void disconnected();
+        void error(const QString&);
+    };
+
+    ///
+    /// server
+    ///
+    class Server : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        Server(QObject* parent);
+        virtual ~Server();
+
+        virtual bool listen(const std::string& address) = 0;
+        // address actually listened on (the port chosen for port 0)
+        virtual std::string address() const = 0;
+        // the caller takes the ownership of the connection
+        virtual Connection* nextPendingConnection() = 0;
+        virtual QString errorString() const = 0;
+        virtual void close() = 0;
+
+    signals:
+        void newConnection();
+    };
+
+    ///
+    /// factory
+    ///
+
+    // creates a server listening on the endpoint. Returns 0 on error.
+    Server* createServer(const Endpoint&, QObject* parent, QString& error);
+
+    // connects to a listening server. Returns 0 on error.
+    Connection* connectTo(const Endpoint&, QObject* parent, int msecs, QString& error);
+}
+
+#endif // TRANSPORT_H
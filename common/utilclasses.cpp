@@ -23,21 +23,176 @@
 // -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
 #include "utilclasses.h"
 
-
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 
 
 /// ///
 ///
-///
+/// Circular Byte Array
 ///
 /// ///
 
+static int nextPowerOfTwo(int n)
+{
+    int p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
 
-/// ///
-///
-///
-///
-/// ///
+QCircularByteArray_::QCircularByteArray_(int capacity)
+    : data_(0), capacity_(0), head_(0), size_(0)
+{
+    _reserve(capacity);
+}
+
+///DATA METHODS
+bool QCircularByteArray_::addData(const QByteArray& ba)
+{
+    return addData(ba.constData(), ba.size());
+}
+
+bool QCircularByteArray_::addData(const char* data, int size)
+{
+    if (size <= 0)
+        return size == 0;
+
+    _reserve(size_ + size);
+
+    //first the room up to the end of the storage, then the beginning
+    int tail = (head_ + size_) & (capacity_ - 1);
+    int first = std::min(size, capacity_ - tail);
+    std::memcpy(data_ + tail, data, first);
+    std::memcpy(data_, data + first, size - first);
+    size_ += size;
+    return true;
+}
+
+void QCircularByteArray_::clear()
+{
+    head_ = 0;
+    size_ = 0;
+}
+
+///ZERO-COPY ACCESS
+const char* QCircularByteArray_::peek(int size)
+{
+    if (size > size_ || size < 0)
+        return 0;
+
+    //wrapping block: rotate the storage so the data starts at 0
+    if (head_ + size > capacity_)
+    {
+        std::rotate(data_, data_ + head_, data_ + capacity_);
+        head_ = 0;
+    }
+    return data_ + head_;
+}
+
+bool QCircularByteArray_::copy(int offset, char* out, int size) const
+{
+    if (offset < 0 || size < 0 || offset + size > size_)
+        return false;
+
+    int start = (head_ + offset) & (capacity_ - 1);
+    int first = std::min(size, capacity_ - start);
+    std::memcpy(out, data_ + start, first);
+    std::memcpy(out + first, data_, size - first);
+    return true;
+}
+
+void QCircularByteArray_::consume(int size)
+{
+    assert(size >= 0 && size <= size_);
+    size_ -= size;
+    //an empty buffer starts over, so the next blocks do not wrap
+    head_ = size_ ? (head_ + size) & (capacity_ - 1) : 0;
+}
+
+void QCircularByteArray_::_reserve(int size)
+{
+    if (size <= capacity_)
+        return;
+
+    //the data is moved to the beginning of the new storage
+    int capacity = nextPowerOfTwo(size);
+    QByteArray storage(capacity, '\0');
+    if (size_)
+        copy(0, storage.data(), size_);
+
+    storage_ = storage;
+    data_ = storage_.data();
+    capacity_ = capacity;
+    head_ = 0;
+}
+
+///STRING METHODS
+QString QCircularByteArray_::getOneString(char separator)
+{
+    //buscamos la primera aparición de separator
+    int index = deepIndexOf(separator);
+    //caso de que no se encuentre
+    if (index == -1)
+        return "";
+
+    //devolvemos el trozo correspondiente
+    //eliminandlo del buffer original
+    return getOneString(index + 1);
+}
+
+QString QCircularByteArray_::getOneString(int size)
+{
+    //comprobacion inicial
+    const char* p = peek(size);
+    if (!p)
+        return "";
+    QByteArray result(p, size);
+    consume(size);
+    return QString(result);
+}
+
+QString QCircularByteArray_::getAllCompleteStrings(char separator)
+{
+    //buscamos la ultima aparición de separator
+    int index = deepLastIndexOf(separator);
+    //caso de que no se encuentre
+    if (index == -1)
+        return "";
+
+    return getOneString(index + 1);
+}
+
+QString QCircularByteArray_::toString()
+{
+    return QString(QByteArray(peek(size_), size_));
+}
+
+int QCircularByteArray_::deepIndexOf(char sep) const
+{
+    //the data is at most two blocks
+    int first = std::min(size_, capacity_ - head_);
+    const char* p = static_cast<const char*>(std::memchr(data_ + head_, sep, first));
+    if (p)
+        return p - (data_ + head_);
+
+    p = static_cast<const char*>(std::memchr(data_, sep, size_ - first));
+    if (p)
+        return first + (p - data_);
+    return -1;
+}
+
+int QCircularByteArray_::deepLastIndexOf(char sep) const
+{
+    //from the end, the separator is usually close to it
+    for (int i = size_ - 1; i >= 0; i--)
+    {
+        if (data_[(head_ + i) & (capacity_ - 1)] == sep)
+            return i;
+    }
+    return -1;
+}
 
 
 /// ///
@@ -31,20 +31,40 @@
 ///
 /// Circular Byte Array
 ///
+/// Ring buffer used as the receive buffer of the connections.
+/// Consuming data only moves the read position, and the storage
+/// grows (to the next power of two) when the data does not fit.
+///
 /// ///
 
-class QCircularByteArray_ : public QByteArray
+class QCircularByteArray_
 {
         public:
-    QCircularByteArray_(){}
+    static const int DEFAULT_CAPACITY = 4096;
+
+    QCircularByteArray_(int capacity = DEFAULT_CAPACITY);
     ~QCircularByteArray_(){}
 
     ///DATA METHODS
-    bool addData(QByteArray ba)
-    {
-        append(ba);
-        return true;
-    }
+    bool addData(const QByteArray& ba);
+    bool addData(const char* data, int size);
+
+    int size() const { return size_; }
+    int capacity() const { return capacity_; }
+    bool isEmpty() const { return size_ == 0; }
+    void clear();
+
+    ///ZERO-COPY ACCESS
+    // the first size bytes as a contiguous block, valid until the next
+    // call that modifies the buffer. Only a block wrapping around the
+    // end of the storage is moved. Returns 0 if there are fewer bytes.
+    const char* peek(int size);
+
+    // copies size bytes starting at offset, without consuming them
+    bool copy(int offset, char* out, int size) const;
+
+    // drops the first size bytes
+    void consume(int size);
 
     ///STRING METHODS
     QString getOneString()
@@ -52,82 +72,35 @@ class QCircularByteArray_ : public QByteArray
         return getOneString('\0');
     }
 
-    QString getOneString(char separator)
-    {
-        //buscamos la primera aparición de separator
-        int index = deepIndexOf(separator);
-        //caso de que no se encuentre
-        if (index == -1)
-        {
-            return "";
-        }
-
-        int resultSize = index + 1;
-        //devolvemos el trozo correspondiente
-        //eliminandlo del buffer original
-        return getOneString(resultSize);
-    }
-
-    QString getOneString(int size)
-    {
-        //comprobacion inicial
-        if (QByteArray::size() < size) return "";
-        //cortamos el trozo correspondiente
-        QByteArray result = left(size);
-        //eliminamos ese trozo del buffer_
-        remove(0,size);
-        //devolvemos convertido en cadena
-        return QString(result);
-    }
+    QString getOneString(char separator);
+    QString getOneString(int size);
 
     QString getAllCompleteStrings()
     {
         return getAllCompleteStrings('\0');
     }
 
-    QString getAllCompleteStrings(char separator)
-    {
-        //buscamos la ultima aparición de separator
-        int index = deepLastIndexOf(separator);
-        //caso de que no se encuentre
-        if (index == -1) return "";
-
-        int resultSize = index + 1;
-        //devolvemos el trozo correspondiente
-        //eliminandlo del buffer original
-        return getOneString(resultSize);
-    }
+    QString getAllCompleteStrings(char separator);
 
-    QString toString()
-    {
-        QString res(data());
-        return res;
-    }
+    QString toString();
 
-    int deepIndexOf(char sep)
-    {
-        for (int i=0; i < size(); i++)
-        {
-            //qDebug() << "buffer[" << i << "]=" << at(i);
-            if (at(i) == sep) return i;
-        }
-        return -1;
-    }
-
-    int deepLastIndexOf(char sep)
-    {
-        int index = -1;
-        for (int i=0; i < size(); i++)
-        {
-            if (at(i) == sep) index = i;
-        }
-        return index;
-    }
+    int deepIndexOf(char sep) const;
+    int deepLastIndexOf(char sep) const;
 
 
 
         private:
+    //data_ points into storage_, a copy would share it (QByteArray
+    //is implicitly shared) and write into the other buffer
+    Q_DISABLE_COPY(QCircularByteArray_)
+
+    void _reserve(int size);
 
+    QByteArray storage_;
+    char* data_;
+    int capacity_;  // power of two
+    int head_;      // read position
+    int size_;
 };
 
 
@@ -25,25 +25,56 @@
 
 #include <ctime>
 #include <cstdio>
+#include <unistd.h>
 
 uuid U;
 
+static uuid_t randomPrefix()
+{
+        uuid_t r = 0;
+
+        FILE* f = fopen ("/dev/urandom", "rb");
+        if (!f || fread (&r, sizeof (r), 1, f) != 1)
+        {
+                // no entropy source: mix what differs between processes
+                r = static_cast<uuid_t>(time (NULL)) * 6364136223846793005ULL ^
+                        static_cast<uuid_t>(getpid ()) << 32 ^
+                        static_cast<uuid_t>(clock ());
+                r ^= r >> 29;
+                r *= 0xbf58476d1ce4e5b9ULL;
+                r ^= r >> 32;
+        }
+        if (f)
+                fclose (f);
+
+        r &= (1ULL << uuid::PREFIX_BITS) - 1;
+        // the ids of the old time based allocator have a 0 prefix
+        return r ? r : 1;
+}
+
 uuid::uuid()
+        : impl_uuid_ (0)
 {
-        time_t val = time (NULL);
-        impl_uuid_ = static_cast<uuid_t>(val) +
-                static_cast<uuid_t>(clock());
+        prefix_ = randomPrefix() << COUNTER_BITS;
 }
 
 uuid_t
 uuid::uuid_new()
 {
-        return impl_uuid_++;
+        uuid_t n = impl_uuid_.fetch_add (1, boost::memory_order_relaxed);
+        return prefix_ | (n & ((1ULL << COUNTER_BITS) - 1));
 }
 
 void
 uuid::update (uuid_t n)
 {
-        if (n > impl_uuid_)
-                impl_uuid_ = n+1;
+        if ((n & ~((1ULL << COUNTER_BITS) - 1)) != prefix_)
+                return;
+
+        // raise the counter past n, unless another thread did
+        uuid_t next = (n & ((1ULL << COUNTER_BITS) - 1)) + 1;
+        uuid_t current = impl_uuid_.load (boost::memory_order_relaxed);
+        while (current < next &&
+               !impl_uuid_.compare_exchange_weak (current, next, boost::memory_order_relaxed))
+                ;
 }
@@ -23,16 +23,31 @@
 #ifndef __UUID_H
 #define __UUID_H
 
+#include <boost/atomic.hpp>
+
 typedef unsigned long long uuid_t;
 
+///
+/// uuid allocator
+///
+/// The ids are a random per process prefix (PREFIX_BITS, never 0)
+/// followed by a counter, so processes started at the same time do
+/// not share ranges. The counter is atomic: any thread may take ids.
+///
 class uuid
 {
-        uuid_t impl_uuid_;
+        boost::atomic<uuid_t> impl_uuid_;
+        uuid_t prefix_;
 
 public:
+        static const int PREFIX_BITS = 24;
+        static const int COUNTER_BITS = 64 - PREFIX_BITS;
+
         uuid();
 
         uuid_t uuid_new();
+        // ids read back from storage: the ones of this process are
+        // not handed out again
         void update(uuid_t);
 };
 
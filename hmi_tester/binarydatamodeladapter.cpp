@@ -0,0 +1,845 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "binarydatamodeladapter.h"
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <debug.h>
+#include <ohtbaseconfig.h>
+
+typedef BinarySuiteFile::StringId StringId;
+typedef BinarySuiteFile::Header Header;
+typedef BinarySuiteFile::StringRef StringRef;
+typedef BinarySuiteFile::CaseEntry CaseEntry;
+typedef BinarySuiteFile::CaseHeader CaseHeader;
+typedef BinarySuiteFile::ItemRecord ItemRecord;
+typedef BinarySuiteFile::Pair Pair;
+
+// the records are read in place, so their layout must not depend on
+// the compiler
+BOOST_STATIC_ASSERT(sizeof(Header) == 80);
+BOOST_STATIC_ASSERT(sizeof(StringRef) == 16);
+BOOST_STATIC_ASSERT(sizeof(CaseEntry) == 32);
+BOOST_STATIC_ASSERT(sizeof(CaseHeader) == 16);
+BOOST_STATIC_ASSERT(sizeof(ItemRecord) == 24);
+BOOST_STATIC_ASSERT(sizeof(Pair) == 16);
+
+const char BinarySuiteFile::MAGIC[8] = { 'O', 'H', 'T', 'B', '\r', '\n', '\032', '\n' };
+
+/// ///
+///
+/// mapped file
+///
+/// ///
+
+BinarySuiteFile::BinarySuiteFile()
+    : data_(0), size_(0)
+{
+}
+
+BinarySuiteFile::~BinarySuiteFile()
+{
+    if (data_)
+        ::munmap(const_cast<char*>(data_), size_);
+}
+
+// true if [offset, offset + count * size) is in a file of this size
+static bool inFile(boost::uint64_t offset, boost::uint64_t count, size_t size, size_t fileSize)
+{
+    return offset <= fileSize && count <= (fileSize - offset) / size;
+}
+
+static DataModel::TestCase::Index caseIndex(const CaseEntry& entry)
+{
+    DataModel::TestCase::Index index;
+    index.offset = entry.offset;
+    index.length = entry.length;
+    index.items = entry.items;
+    return index;
+}
+
+bool BinarySuiteFile::open(const std::string& filename)
+{
+    assert(!data_);
+    filename_ = filename;
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+    {
+        ::close(fd);
+        return false;
+    }
+    //the mapping stays valid when the file is renamed over
+    void* data = ::mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    data_ = static_cast<const char*>(data);
+    size_ = st.st_size;
+
+    const Header& h = *_header();
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0)
+        return false;
+    if (h.byteOrder != BYTE_ORDER_MARK || h.version != VERSION || h.fileSize != size_)
+    {
+        DEBUG(D_ERROR, "(BinarySuiteFile::open) " << filename
+              << " was written on another platform or version.");
+        return false;
+    }
+    if (!inFile(h.strings, h.stringCount, sizeof(StringRef), size_) ||
+        !inFile(h.cases, h.caseCount, sizeof(CaseEntry), size_) ||
+        !inFile(h.pairs, h.pairCount, sizeof(Pair), size_) ||
+        h.strings % 8 || h.cases % 8 || h.pairs % 8)
+        return false;
+
+    //the strings and the case blocks are checked once, so the readers
+    //only check the ids and counts
+    const StringRef* strings = reinterpret_cast<const StringRef*>(data_ + h.strings);
+    for (boost::uint64_t i = 0; i < h.stringCount; i++)
+        if (!inFile(strings[i].offset, boost::uint64_t(strings[i].length) + 1, 1, size_) ||
+            data_[strings[i].offset + strings[i].length] != '\0')
+            return false;
+    for (boost::uint64_t i = 0; i < h.caseCount; i++)
+        if (!caseBlock(caseIndex(cases()[i])) || !string(cases()[i].name))
+            return false;
+    return string(h.name) && string(h.appId);
+}
+
+const std::string& BinarySuiteFile::filename() const
+{
+    return filename_;
+}
+
+const Header* BinarySuiteFile::_header() const
+{
+    return reinterpret_cast<const Header*>(data_);
+}
+
+const Header& BinarySuiteFile::header() const
+{
+    return *_header();
+}
+
+const char* BinarySuiteFile::string(StringId id) const
+{
+    if (id >= _header()->stringCount)
+        return 0;
+    const StringRef* strings = reinterpret_cast<const StringRef*>(data_ + _header()->strings);
+    return data_ + strings[id].offset;
+}
+
+size_t BinarySuiteFile::stringLength(StringId id) const
+{
+    const StringRef* strings = reinterpret_cast<const StringRef*>(data_ + _header()->strings);
+    return strings[id].length;
+}
+
+const CaseEntry* BinarySuiteFile::cases() const
+{
+    return reinterpret_cast<const CaseEntry*>(data_ + _header()->cases);
+}
+
+const CaseHeader* BinarySuiteFile::caseBlock(const DataModel::TestCase::Index& index) const
+{
+    if (index.offset < 0 || index.offset % 8 ||
+        !inFile(index.offset, index.length, 1, size_) ||
+        static_cast<boost::uint64_t>(index.length) < sizeof(CaseHeader))
+        return 0;
+
+    const CaseHeader* block = reinterpret_cast<const CaseHeader*>(data_ + index.offset);
+    if (block->items != index.items ||
+        !inFile(0, block->items, sizeof(ItemRecord), index.length) ||
+        blockSize(block->pairCount, block->items, block->itemPairCount) !=
+            static_cast<boost::uint64_t>(index.length))
+        return 0;
+    return block;
+}
+
+const Pair* BinarySuiteFile::casePairs(const CaseHeader* block)
+{
+    return reinterpret_cast<const Pair*>(block + 1);
+}
+
+const ItemRecord* BinarySuiteFile::items(const CaseHeader* block)
+{
+    return reinterpret_cast<const ItemRecord*>(casePairs(block) + block->pairCount);
+}
+
+const Pair* BinarySuiteFile::itemPairs(const CaseHeader* block)
+{
+    return reinterpret_cast<const Pair*>(items(block) + block->items);
+}
+
+size_t BinarySuiteFile::blockSize(size_t casePairs, size_t items, size_t itemPairs)
+{
+    return sizeof(CaseHeader) + (casePairs + itemPairs) * sizeof(Pair) +
+            items * sizeof(ItemRecord);
+}
+
+/// ///
+///
+/// reading
+///
+/// ///
+
+///
+/// The keys and identifiers of a file are interned once per read,
+/// not once per item.
+///
+class InternedStrings
+{
+public:
+    explicit InternedStrings(const BinarySuiteFile& file)
+        : file_(file)
+    {
+    }
+
+    // 0 if the id is not in the table
+    InternedString get(StringId id)
+    {
+        Map::const_iterator it = map_.find(id);
+        if (it != map_.end())
+            return it->second;
+        const char* s = file_.string(id);
+        if (!s)
+            return 0;
+        return map_[id] = StringPool::intern(std::string(s, file_.stringLength(id)));
+    }
+
+private:
+    typedef boost::unordered_map<StringId, InternedString> Map;
+
+    const BinarySuiteFile& file_;
+    Map map_;
+};
+
+static bool readPairs(const BinarySuiteFile& file, const Pair* pairs, size_t count,
+                      InternedStrings& interned, DataModel::TestBase& tb)
+{
+    for (const Pair* p = pairs; p != pairs + count; ++p)
+    {
+        DataModel::FieldKey key = interned.get(p->key);
+        if (!key)
+            return false;
+
+        const char* s = 0;
+        if ((p->flags & Pair::METADATA) || p->type == DataModel::FieldValue::STRING)
+        {
+            s = file.string(p->value.s);
+            if (!s)
+                return false;
+        }
+
+        if (p->flags & Pair::METADATA)
+        {
+            tb.addMetadata(*key, std::string(s, file.stringLength(p->value.s)));
+            continue;
+        }
+        if (p->flags & Pair::UNTYPED)
+        {
+            if (p->type != DataModel::FieldValue::STRING)
+                return false;
+            tb.addUntypedData(*key, std::string(s, file.stringLength(p->value.s)));
+            continue;
+        }
+        switch (p->type)
+        {
+        case DataModel::FieldValue::INT:
+            tb.setInt(key, p->value.i);
+            break;
+        case DataModel::FieldValue::DOUBLE:
+            tb.setDouble(key, p->value.d);
+            break;
+        case DataModel::FieldValue::BOOL:
+            tb.setBool(key, p->value.i != 0);
+            break;
+        case DataModel::FieldValue::STRING:
+            if (p->flags & Pair::IDENTIFIER)
+                tb.setField(key, DataModel::FieldValue(interned.get(p->value.s)));
+            else
+                tb.setString(key, std::string(s, file.stringLength(p->value.s)));
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+// reads the data, metadata and items of the case from its block
+static bool readCase(const BinarySuiteFile& file, const DataModel::TestCase::Index& index,
+                     DataModel::TestCase& tc)
+{
+    const CaseHeader* block = file.caseBlock(index);
+    if (!block)
+        return false;
+
+    InternedStrings interned(file);
+    if (!readPairs(file, BinarySuiteFile::casePairs(block), block->pairCount, interned, tc))
+        return false;
+
+    const ItemRecord* items = BinarySuiteFile::items(block);
+    const Pair* itemPairs = BinarySuiteFile::itemPairs(block);
+    for (const ItemRecord* r = items; r != items + block->items; ++r)
+    {
+        if (r->firstPair > block->itemPairCount ||
+            r->pairCount > block->itemPairCount - r->firstPair)
+            return false;
+
+        DataModel::TestItem ti(r->type, r->subtype, r->timestamp);
+        if (!readPairs(file, itemPairs + r->firstPair, r->pairCount, interned, ti))
+            return false;
+        tc.takeTestItem(ti);
+    }
+    return true;
+}
+
+///
+/// The loader of the cases of a lazy suite, sharing the mapped file.
+///
+class BinaryCaseLoader : public DataModel::CaseLoader
+{
+public:
+    explicit BinaryCaseLoader(BinarySuiteFilePtr file)
+        : file_(file)
+    {
+    }
+
+    virtual bool load(DataModel::TestCase& tc)
+    {
+        if (readCase(*file_, tc.index(), tc))
+            return true;
+        DEBUG(D_ERROR, "(BinaryCaseLoader::load) Malformed TestCase " << tc.name()
+              << " at offset " << tc.index().offset << " of " << file_->filename());
+        return false;
+    }
+
+private:
+    BinarySuiteFilePtr file_;
+};
+
+///
+BinaryDataModelAdapter::BinaryDataModelAdapter()
+{
+}
+
+///
+std::string BinaryDataModelAdapter::id()
+{
+    return "BINDA";
+}
+
+///
+std::string BinaryDataModelAdapter::extension()
+{
+    return OHTB_FILE_EXTENSION;
+}
+
+static BinarySuiteFilePtr openFile(const std::string& filename)
+    throw (DataModelAdapter::conversion_error_exception)
+{
+    BinarySuiteFilePtr file(new BinarySuiteFile());
+    if (!file->open(filename))
+    {
+        std::cout << "(BinaryDataModelAdapter::openFile) ERROR the file " << filename
+                  << " is not a valid binary test suite." << std::endl;
+        throw DataModelAdapter::conversion_error_exception();
+    }
+    return file;
+}
+
+DataModel::TestSuite*
+        BinaryDataModelAdapter::_readSuite(const BinarySuiteFile& file)
+        throw (DataModelAdapter::conversion_error_exception)
+{
+    const Header& h = file.header();
+    std::auto_ptr<DataModel::TestSuite> tsuite(new DataModel::TestSuite());
+    tsuite->name(std::string(file.string(h.name), file.stringLength(h.name)));
+    tsuite->appId(std::string(file.string(h.appId), file.stringLength(h.appId)));
+
+    InternedStrings interned(file);
+    const Pair* pairs = reinterpret_cast<const Pair*>(
+                reinterpret_cast<const char*>(&h) + h.pairs);
+    if (!readPairs(file, pairs, h.pairCount, interned, *tsuite))
+    {
+        std::cout << "(BinaryDataModelAdapter::_readSuite) ERROR malformed data in the file "
+                  << file.filename() << "." << std::endl;
+        throw DataModelAdapter::conversion_error_exception();
+    }
+    return tsuite.release();
+}
+
+// reads the case i of the file (run by the CaseWorkers)
+static bool readCaseTask(const BinarySuiteFile* file,
+                         const std::vector<DataModel::TestCase*>* cases, size_t i)
+{
+    DataModel::TestCase& tc = *(*cases)[i];
+    if (readCase(*file, caseIndex(file->cases()[i]), tc))
+        return true;
+    std::cout << "(BinaryDataModelAdapter::file2testSuite) ERROR malformed TestCase "
+              << tc.name() << " in the file " << file->filename() << "." << std::endl;
+    return false;
+}
+
+DataModel::TestSuite*
+        BinaryDataModelAdapter::file2testSuite(const std::string& filename)
+        throw (DataModelAdapter::conversion_error_exception)
+{
+    BinarySuiteFilePtr file = openFile(filename);
+    std::auto_ptr<DataModel::TestSuite> tsuite(_readSuite(*file));
+
+    //the cases are added in file order, then read whole in parallel.
+    //The file is unmapped on return.
+    std::vector<DataModel::TestCase*> cases;
+    for (boost::uint64_t i = 0; i < file->header().caseCount; i++)
+    {
+        const CaseEntry& entry = file->cases()[i];
+        DataModel::TestCase* tcase = new DataModel::TestCase();
+        tcase->name(std::string(file->string(entry.name), file->stringLength(entry.name)));
+        tsuite->addTestCase(tcase);
+        cases.push_back(tcase);
+    }
+
+    CaseWorkers workers(cases.size(), threads(),
+                        boost::bind(&BinaryDataModelAdapter::reportProgress, this, _1, _2));
+    if (!workers.run(0, cases.size(), boost::bind(&readCaseTask, file.get(), &cases, _1)))
+        throw DataModelAdapter::conversion_error_exception();
+    return tsuite.release();
+}
+
+DataModel::TestSuite*
+        BinaryDataModelAdapter::file2lazyTestSuite(const std::string& filename)
+        throw (DataModelAdapter::conversion_error_exception)
+{
+    BinarySuiteFilePtr file = openFile(filename);
+    std::auto_ptr<DataModel::TestSuite> tsuite(_readSuite(*file));
+
+    DataModel::CaseLoaderPtr loader(new BinaryCaseLoader(file));
+    for (boost::uint64_t i = 0; i < file->header().caseCount; i++)
+    {
+        const CaseEntry& entry = file->cases()[i];
+        DataModel::TestCase* tcase = new DataModel::TestCase();
+        tcase->name(std::string(file->string(entry.name), file->stringLength(entry.name)));
+        tcase->setLoader(loader, caseIndex(entry));
+        tcase->unload();
+        tsuite->addTestCase(tcase);
+    }
+
+    DEBUG(D_BOTH, "(BinaryDataModelAdapter::file2lazyTestSuite) Indexed "
+          << file->header().caseCount << " test cases in " << filename << ".");
+    return tsuite.release();
+}
+
+/// ///
+///
+/// writing
+///
+/// ///
+
+///
+/// The ids of the strings of a file or of a case block.
+///
+class StringTable
+{
+public:
+    StringTable()
+    {
+    }
+
+    StringId id(const std::string& s)
+    {
+        std::pair<Ids::iterator, bool> it =
+                ids_.insert(Ids::value_type(s, static_cast<StringId>(strings_.size())));
+        if (it.second)
+            strings_.push_back(&it.first->first);
+        return it.first->second;
+    }
+
+    StringId id(InternedString s)
+    {
+        InternedIds::const_iterator it = internedIds_.find(s);
+        if (it != internedIds_.end())
+            return it->second;
+        return internedIds_[s] = id(*s);
+    }
+
+    size_t size() const
+    {
+        return strings_.size();
+    }
+
+    const std::string& string(StringId id) const
+    {
+        return *strings_[id];
+    }
+
+    // the data fields and metadata of tb, appended to out
+    void pairs(const DataModel::TestBase& tb, std::vector<Pair>& out)
+    {
+        Pair p;
+        std::memset(&p, 0, sizeof(p));
+
+        const DataModel::FieldList& fields = tb.fields();
+        for (DataModel::FieldList::const_iterator it = fields.begin(); it != fields.end(); ++it)
+        {
+            p.key = id(it->key);
+            p.type = it->value.type();
+            p.flags = 0;
+            p.value.i = 0;
+            switch (it->value.type())
+            {
+            case DataModel::FieldValue::INT:
+            case DataModel::FieldValue::BOOL:
+                p.value.i = it->value.toInt();
+                break;
+            case DataModel::FieldValue::DOUBLE:
+                p.value.d = it->value.toDouble();
+                break;
+            case DataModel::FieldValue::STRING:
+                if (it->value.interned())
+                {
+                    p.flags = Pair::IDENTIFIER;
+                    p.value.s = id(it->value.interned());
+                }
+                else
+                    p.value.s = id(it->value.string());
+                break;
+            }
+            out.push_back(p);
+        }
+
+        p.type = DataModel::FieldValue::STRING;
+        p.value.i = 0;
+        p.flags = Pair::UNTYPED;
+        _stringPairs(tb.untypedData(), p, out);
+        p.flags = Pair::METADATA;
+        _stringPairs(tb.metadataMap(), p, out);
+    }
+
+private:
+    // Do not copy (the strings point to the keys of ids_)
+    StringTable(const StringTable&);
+    StringTable& operator=(const StringTable&);
+
+    void _stringPairs(const DataModel::KeyValueMap& map, Pair& p, std::vector<Pair>& out)
+    {
+        DataModel::KeyValueMap::const_iterator it;
+        for (it = map.begin(); it != map.end(); ++it)
+        {
+            p.key = id(it->first);
+            p.value.s = id(it->second);
+            out.push_back(p);
+        }
+    }
+
+    typedef boost::unordered_map<std::string, StringId> Ids;
+    typedef boost::unordered_map<InternedString, StringId> InternedIds;
+
+    // the strings in id order point to the keys of ids_
+    Ids ids_;
+    InternedIds internedIds_;
+    std::vector<const std::string*> strings_;
+};
+
+///
+/// The records of a case, with the ids of its own strings. The blocks
+/// are built in parallel, and their ids changed to the ones of the
+/// file when they are written in order.
+///
+struct CaseBlock
+{
+    StringTable strings;
+    StringId name;
+    std::vector<Pair> casePairs;
+    std::vector<ItemRecord> items;
+    std::vector<Pair> itemPairs;
+};
+
+static bool encodeCase(const DataModel::TestCase& tc, CaseBlock& block)
+{
+    block.name = block.strings.id(tc.name());
+    block.strings.pairs(tc, block.casePairs);
+
+    const DataModel::TestCase::TestItemList& il = tc.testItemList();
+    block.items.reserve(il.size());
+    DataModel::TestCase::TestItemList::const_iterator it;
+    for (it = il.begin(); it != il.end(); ++it)
+    {
+        ItemRecord r;
+        r.type = it->type();
+        r.subtype = it->subtype();
+        r.timestamp = it->timestamp();
+        r.firstPair = block.itemPairs.size();
+        block.strings.pairs(*it, block.itemPairs);
+        r.pairCount = block.itemPairs.size() - r.firstPair;
+        r.reserved = 0;
+        block.items.push_back(r);
+    }
+    return block.casePairs.size() <= 0xffffffffu && block.itemPairs.size() <= 0xffffffffu;
+}
+
+// encodes the case i of a batch (run by the CaseWorkers). The unloaded
+// cases are loaded into a copy.
+static bool encodeCaseTask(const std::vector<const DataModel::TestCase*>* cases, size_t begin,
+                           boost::ptr_vector<CaseBlock>* blocks, size_t i)
+{
+    const DataModel::TestCase& tc = *(*cases)[i];
+    CaseBlock& block = (*blocks)[i - begin];
+    if (tc.loaded())
+        return encodeCase(tc, block);
+
+    DataModel::TestCase copy;
+    copy.name(tc.name());
+    copy.setLoader(tc.loader(), tc.index());
+    copy.unload();
+    return copy.load() && encodeCase(copy, block);
+}
+
+static void remapPairs(std::vector<Pair>& pairs, const std::vector<StringId>& ids)
+{
+    for (std::vector<Pair>::iterator it = pairs.begin(); it != pairs.end(); ++it)
+    {
+        it->key = ids[it->key];
+        if ((it->flags & Pair::METADATA) || it->type == DataModel::FieldValue::STRING)
+            it->value.s = ids[it->value.s];
+    }
+}
+
+///
+/// Writes the sections of a suite file in order, and keeps the ids
+/// of the strings written.
+///
+class SuiteWriter
+{
+public:
+    explicit SuiteWriter(std::FILE* file)
+        : file_(file), pos_(0), ok_(true)
+    {
+    }
+
+    boost::uint64_t pos() const
+    {
+        return pos_;
+    }
+
+    bool ok() const
+    {
+        return ok_;
+    }
+
+    StringTable& strings()
+    {
+        return strings_;
+    }
+
+    void write(const void* data, size_t size)
+    {
+        if (ok_ && size && std::fwrite(data, size, 1, file_) != 1)
+            ok_ = false;
+        pos_ += size;
+    }
+
+    template<class T>
+    void write(const std::vector<T>& records)
+    {
+        if (!records.empty())
+            write(&records[0], records.size() * sizeof(T));
+    }
+
+    void align()
+    {
+        static const char zeros[8] = { 0 };
+        write(zeros, (8 - pos_ % 8) % 8);
+    }
+
+    // writes the block with the string ids of the file
+    void block(CaseBlock& block, CaseEntry& entry)
+    {
+        std::vector<StringId> ids(block.strings.size());
+        for (size_t i = 0; i < ids.size(); i++)
+            ids[i] = strings_.id(block.strings.string(i));
+        remapPairs(block.casePairs, ids);
+        remapPairs(block.itemPairs, ids);
+
+        CaseHeader h;
+        h.items = block.items.size();
+        h.pairCount = block.casePairs.size();
+        h.itemPairCount = block.itemPairs.size();
+
+        entry.offset = pos_;
+        entry.length = BinarySuiteFile::blockSize(h.pairCount, h.items, h.itemPairCount);
+        entry.items = h.items;
+        entry.name = ids[block.name];
+        entry.reserved = 0;
+
+        write(&h, sizeof(h));
+        write(block.casePairs);
+        write(block.items);
+        write(block.itemPairs);
+    }
+
+    // the string table, at the current (aligned) position
+    void stringTable(Header& h)
+    {
+        h.strings = pos_;
+        h.stringCount = strings_.size();
+
+        std::vector<StringRef> refs(strings_.size());
+        boost::uint64_t offset = pos_ + refs.size() * sizeof(StringRef);
+        for (size_t i = 0; i < refs.size(); i++)
+        {
+            refs[i].offset = offset;
+            refs[i].length = strings_.string(i).size();
+            refs[i].reserved = 0;
+            offset += refs[i].length + 1;
+        }
+        write(refs);
+        for (size_t i = 0; i < refs.size(); i++)
+            write(strings_.string(i).c_str(), refs[i].length + 1);
+        align();
+    }
+
+private:
+    std::FILE* file_;
+    boost::uint64_t pos_;
+    bool ok_;
+    StringTable strings_;
+};
+
+void BinaryDataModelAdapter::testSuite2file(const DataModel::TestSuite& ts,
+                                            const std::string& filename)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    _writeFile(ts, filename, 0);
+}
+
+void BinaryDataModelAdapter::lazyTestSuite2file(DataModel::TestSuite& ts,
+                                                const std::string& filename)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    std::vector<DataModel::TestCase::Index> index;
+    _writeFile(ts, filename, &index);
+
+    //the cases are read from the new file from now on
+    DataModel::CaseLoaderPtr loader(new BinaryCaseLoader(openFile(filename)));
+    const DataModel::TestSuite::TestCaseList& tcl = ts.testCases();
+    DataModel::TestSuite::TestCaseList::const_iterator it;
+    size_t i = 0;
+    for (it = tcl.begin(); it != tcl.end(); ++it, ++i)
+        ts.getTestCase(it->name())->setLoader(loader, index[i]);
+}
+
+void BinaryDataModelAdapter::_writeFile(const DataModel::TestSuite& ts,
+                                        const std::string& filename,
+                                        std::vector<DataModel::TestCase::Index>* index)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    //the suite is written to a new file renamed over the old one, so
+    //a failed write does not leave a truncated suite, and the lazy
+    //suites mapping the old one still read it
+    std::string tmp = filename + ".tmp";
+    std::FILE* file = std::fopen(tmp.c_str(), "wb");
+    if (!file)
+        throw DataModelAdapter::conversion_error_exception();
+
+    SuiteWriter writer(file);
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    writer.write(&h, sizeof(h));
+
+    ///1. the case blocks, encoded in parallel by batches and written
+    ///in order
+    std::vector<const DataModel::TestCase*> cases;
+    const DataModel::TestSuite::TestCaseList& tcl = ts.testCases();
+    DataModel::TestSuite::TestCaseList::const_iterator it;
+    for (it = tcl.begin(); it != tcl.end(); ++it)
+        cases.push_back(&*it);
+
+    CaseWorkers workers(cases.size(), threads(),
+                        boost::bind(&BinaryDataModelAdapter::reportProgress, this, _1, _2));
+    std::vector<CaseEntry> entries(cases.size());
+    bool ok = true;
+    for (size_t begin = 0; ok && begin < cases.size(); begin += workers.batch())
+    {
+        size_t end = std::min(begin + workers.batch(), cases.size());
+        boost::ptr_vector<CaseBlock> blocks;
+        for (size_t i = begin; i < end; i++)
+            blocks.push_back(new CaseBlock());
+
+        ok = workers.run(begin, end, boost::bind(&encodeCaseTask, &cases, begin, &blocks, _1));
+        for (size_t i = begin; ok && i < end; i++)
+        {
+            writer.block(blocks[i - begin], entries[i]);
+            if (index)
+                index->push_back(caseIndex(entries[i]));
+        }
+    }
+
+    ///2. the suite data, the strings, the case index and the header
+    std::vector<Pair> pairs;
+    writer.strings().pairs(ts, pairs);
+    h.name = writer.strings().id(ts.name());
+    h.appId = writer.strings().id(ts.appId());
+    writer.stringTable(h);
+
+    h.cases = writer.pos();
+    h.caseCount = entries.size();
+    writer.write(entries);
+
+    h.pairs = writer.pos();
+    h.pairCount = pairs.size();
+    writer.write(pairs);
+
+    std::memcpy(h.magic, BinarySuiteFile::MAGIC, sizeof(h.magic));
+    h.byteOrder = BinarySuiteFile::BYTE_ORDER_MARK;
+    h.version = BinarySuiteFile::VERSION;
+    h.fileSize = writer.pos();
+
+    ok = ok && writer.ok() && std::fseek(file, 0, SEEK_SET) == 0 &&
+            std::fwrite(&h, sizeof(h), 1, file) == 1 &&
+            std::fflush(file) == 0 && ::fsync(fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+
+    if (!ok || std::rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        std::cout << "(BinaryDataModelAdapter::_writeFile) ERROR while writing the file " << filename << "." << std::endl;
+        std::remove(tmp.c_str());
+        throw DataModelAdapter::conversion_error_exception();
+    }
+}
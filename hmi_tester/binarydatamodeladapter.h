@@ -0,0 +1,213 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef BINARYDATAMODELADAPTER_H
+#define BINARYDATAMODELADAPTER_H
+
+#include <datamodeladapter.h>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+
+///
+/// binary test suite file
+///
+/// A suite file (.ohtb) made of fixed layout records, in host byte
+/// order and with every section 8 byte aligned:
+///   Header
+///   test cases, one block each: a CaseHeader, the Pairs of the case,
+///     its ItemRecords and the Pairs of the items
+///   string table: a StringRef per string, then their bytes (each one
+///     followed by a NUL)
+///   case index: a CaseEntry per case
+///   the Pairs of the suite
+/// Keys, names and string values are ids in the string table, so each
+/// distinct string is stored once.
+///
+/// The file is mapped: opening it only checks the header, the string
+/// table and the case index, and the records and strings are read in
+/// place. A file written on a host of the other byte order is not read.
+///
+class BinarySuiteFile
+{
+    // Do not copy
+    BinarySuiteFile(const BinarySuiteFile&);
+    BinarySuiteFile& operator=(const BinarySuiteFile&);
+
+public:
+    typedef boost::uint32_t StringId;
+
+    static const char MAGIC[8];
+    static const boost::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const boost::uint32_t VERSION = 1;
+
+    struct Header
+    {
+        char magic[8];
+        boost::uint32_t byteOrder;
+        boost::uint32_t version;
+        boost::uint64_t fileSize;
+        boost::uint64_t strings;        // offset of the string table
+        boost::uint64_t stringCount;
+        boost::uint64_t cases;          // offset of the case index
+        boost::uint64_t caseCount;
+        boost::uint64_t pairs;          // offset of the suite pairs
+        boost::uint32_t pairCount;
+        StringId name;
+        StringId appId;
+        boost::uint32_t reserved;
+    };
+
+    struct StringRef
+    {
+        boost::uint64_t offset;
+        boost::uint32_t length;
+        boost::uint32_t reserved;
+    };
+
+    struct CaseEntry
+    {
+        boost::uint64_t offset;         // of the CaseHeader
+        boost::uint64_t length;         // bytes of the block
+        boost::uint64_t items;
+        StringId name;
+        boost::uint32_t reserved;
+    };
+
+    struct CaseHeader
+    {
+        boost::uint64_t items;
+        boost::uint32_t pairCount;      // of the case
+        boost::uint32_t itemPairCount;  // of all its items
+    };
+
+    struct ItemRecord
+    {
+        boost::int32_t type;
+        boost::int32_t subtype;
+        boost::int32_t timestamp;
+        boost::uint32_t firstPair;      // in the item pairs of the case
+        boost::uint32_t pairCount;
+        boost::uint32_t reserved;
+    };
+
+    // a data field (typed as DataModel::FieldValue) or a metadata pair
+    struct Pair
+    {
+        enum
+        {
+            METADATA = 1,
+            IDENTIFIER = 2,             // STRING value kept interned
+            UNTYPED = 4                 // STRING data that is not a field
+                                        // (TestBase::untypedData)
+        };
+
+        StringId key;
+        boost::uint8_t type;
+        boost::uint8_t flags;
+        boost::uint16_t reserved;
+        union
+        {
+            boost::int64_t i;           // INT and BOOL
+            double d;
+            StringId s;
+        } value;
+    };
+
+    BinarySuiteFile();
+    ~BinarySuiteFile();
+
+    // maps the file, false if it is not a valid suite file
+    bool open(const std::string& filename);
+
+    const std::string& filename() const;
+    const Header& header() const;
+
+    // 0 if the id is not in the table
+    const char* string(StringId) const;
+    size_t stringLength(StringId) const;
+
+    const CaseEntry* cases() const;
+    // the block of a case, 0 if it is not a valid block
+    const CaseHeader* caseBlock(const DataModel::TestCase::Index&) const;
+
+    // the records of a valid block
+    static const Pair* casePairs(const CaseHeader*);
+    static const ItemRecord* items(const CaseHeader*);
+    static const Pair* itemPairs(const CaseHeader*);
+
+    static size_t blockSize(size_t casePairs, size_t items, size_t itemPairs);
+
+private:
+    const Header* _header() const;
+
+    std::string filename_;
+    const char* data_;
+    size_t size_;
+};
+
+typedef boost::shared_ptr<BinarySuiteFile> BinarySuiteFilePtr;
+
+///
+/// binary test suite adapter
+///
+/// Reads and writes the suites as BinarySuiteFiles. The lazy suites
+/// keep the file mapped, and a case is read from its block when it is
+/// loaded. The typed fields keep their types and the untyped data stays
+/// untyped, so a suite converted from or to XML (which writes the types
+/// too) has the same data.
+///
+class BinaryDataModelAdapter : public DataModelAdapter
+{
+public:
+    BinaryDataModelAdapter();
+
+    virtual std::string id();
+    virtual std::string extension();
+
+    virtual DataModel::TestSuite* file2testSuite(const std::string& filename)
+    throw (conversion_error_exception);
+
+    virtual void testSuite2file(const DataModel::TestSuite&,
+                                const std::string& filename) throw (conversion_error_exception);
+
+    // the test cases are indexed by the position of their block
+    virtual DataModel::TestSuite* file2lazyTestSuite(const std::string& filename)
+    throw (conversion_error_exception);
+
+    virtual void lazyTestSuite2file(DataModel::TestSuite&,
+                                    const std::string& filename) throw (conversion_error_exception);
+
+protected:
+    // the suite without its test cases
+    DataModel::TestSuite* _readSuite(const BinarySuiteFile&)
+    throw (conversion_error_exception);
+
+    // writes the suite to a new file renamed over the old one, and the
+    // index of each test case in it
+    void _writeFile(const DataModel::TestSuite&, const std::string& filename,
+                    std::vector<DataModel::TestCase::Index>* index)
+    throw (conversion_error_exception);
+};
+
+#endif // BINARYDATAMODELADAPTER_H
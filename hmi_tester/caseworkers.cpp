@@ -0,0 +1,100 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "caseworkers.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+
+CaseWorkers::CaseWorkers(size_t cases, unsigned threads, const Progress& progress)
+    : total_(cases), threads_(threads), progress_(progress),
+      next_(0), end_(0), done_(0), failed_(false)
+{
+    if (!threads_)
+        threads_ = std::max(1u, boost::thread::hardware_concurrency());
+}
+
+unsigned CaseWorkers::threads() const
+{
+    return threads_;
+}
+
+size_t CaseWorkers::batch() const
+{
+    return 4 * threads_;
+}
+
+bool CaseWorkers::run(size_t begin, size_t end, const Task& task)
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        next_ = begin;
+        end_ = end;
+        failed_ = false;
+    }
+
+    size_t helpers = std::min<size_t>(threads_, end - begin);
+    boost::thread_group group;
+    for (size_t i = 1; i < helpers; i++)
+        group.create_thread(boost::bind(&CaseWorkers::_work, this, &task));
+    _work(&task);
+    group.join_all();
+
+    return !failed_;
+}
+
+void CaseWorkers::_work(const Task* task)
+{
+    for (;;)
+    {
+        size_t i;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            if (failed_ || next_ == end_)
+                return;
+            i = next_++;
+        }
+
+        bool ok;
+        try
+        {
+            ok = (*task)(i);
+        }
+        catch (...)
+        {
+            ok = false;
+        }
+
+        //reported in order, under the lock
+        boost::mutex::scoped_lock lock(mutex_);
+        if (!ok)
+        {
+            failed_ = true;
+            continue;
+        }
+        done_++;
+        if (progress_)
+            progress_(done_, total_);
+    }
+}
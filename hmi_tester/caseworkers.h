@@ -0,0 +1,80 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef CASEWORKERS_H
+#define CASEWORKERS_H
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstddef>
+
+///
+/// test case workers
+///
+/// Runs a task for each test case of a suite on a pool of threads.
+/// The cases are handed out in order to the threads as they become
+/// free, and each task writes the result of its case in its own slot,
+/// so the results are merged in case order whatever thread ran them.
+/// The calling thread works too, and one thread runs the tasks in it.
+///
+/// The progress is the cases done of the total, reported from the
+/// worker threads after each case.
+///
+class CaseWorkers
+{
+    // Do not copy
+    CaseWorkers(const CaseWorkers&);
+    CaseWorkers& operator=(const CaseWorkers&);
+
+public:
+    typedef boost::function<bool (size_t)> Task;
+    typedef boost::function<void (size_t done, size_t total)> Progress;
+
+    // threads: 0 for one per core
+    CaseWorkers(size_t cases, unsigned threads, const Progress& = Progress());
+
+    unsigned threads() const;
+
+    // cases run at once by the writers: enough to keep the threads
+    // busy, without holding the output of the whole suite
+    size_t batch() const;
+
+    // runs the task for the cases in [begin, end), false if one of
+    // them failed or threw. The cases not started are skipped after
+    // a failure.
+    bool run(size_t begin, size_t end, const Task&);
+
+private:
+    void _work(const Task*);
+
+    size_t total_;
+    unsigned threads_;
+    Progress progress_;
+
+    boost::mutex mutex_;
+    size_t next_;
+    size_t end_;
+    size_t done_;
+    bool failed_;
+};
+
+#endif // CASEWORKERS_H
@@ -0,0 +1,360 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "compresseddatamodeladapter.h"
+
+#include <boost/bind.hpp>
+#include <zlib.h>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+#include <debug.h>
+
+namespace
+{
+
+const unsigned char GZIP_MAGIC[2] = { 0x1f, 0x8b };
+
+// windowBits of the gzip format for deflateInit2 and inflateInit2
+const int GZIP_WINDOW_BITS = 15 + 16;
+
+///
+/// plain suite file, removed when it goes out of scope
+///
+class PlainFile
+{
+    // Do not copy
+    PlainFile(const PlainFile&);
+    PlainFile& operator=(const PlainFile&);
+
+public:
+    // next to the suite file if its directory is writable, or in the
+    // temp directory
+    explicit PlainFile(const std::string& filename)
+    {
+        if (!_create(filename + ".XXXXXX"))
+        {
+            const char* dir = std::getenv("TMPDIR");
+            _create(std::string(dir && *dir ? dir : "/tmp") + "/oht-suite.XXXXXX");
+        }
+    }
+
+    ~PlainFile()
+    {
+        if (!name_.empty())
+            ::unlink(name_.c_str());
+    }
+
+    bool ok() const
+    {
+        return !name_.empty();
+    }
+
+    const std::string& name() const
+    {
+        return name_;
+    }
+
+private:
+    bool _create(const std::string& pattern)
+    {
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        int fd = ::mkstemp(&name[0]);
+        if (fd < 0)
+            return false;
+        ::close(fd);
+        name_ = &name[0];
+        return true;
+    }
+
+    std::string name_;
+};
+
+// streams a file into another one, written to a new file renamed over
+// it as the adapters do
+bool convertFile(const std::string& from, const std::string& to, int level)
+{
+    std::FILE* in = std::fopen(from.c_str(), "rb");
+    if (!in)
+        return false;
+
+    std::string tmp = to + ".tmp";
+    std::FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out)
+    {
+        std::fclose(in);
+        return false;
+    }
+
+    bool ok = level < 0 ? CompressedDataModelAdapter::decompress(in, out)
+                        : CompressedDataModelAdapter::compress(in, out, level);
+    ok = std::fflush(out) == 0 && ::fsync(fileno(out)) == 0 && ok;
+    ok = std::fclose(out) == 0 && ok;
+    std::fclose(in);
+
+    if (!ok || std::rename(tmp.c_str(), to.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
+
+CompressedDataModelAdapter::CompressedDataModelAdapter(DataModelAdapter* adapter, int level)
+    : adapter_(adapter), level_(level)
+{
+    assert(adapter);
+    adapter_->setProgress(boost::bind(&CompressedDataModelAdapter::reportProgress, this, _1, _2));
+}
+
+CompressedDataModelAdapter::~CompressedDataModelAdapter()
+{
+}
+
+DataModelAdapter* CompressedDataModelAdapter::adapter() const
+{
+    return adapter_.get();
+}
+
+void CompressedDataModelAdapter::setLevel(int level)
+{
+    level_ = level;
+}
+
+int CompressedDataModelAdapter::level() const
+{
+    return level_;
+}
+
+std::string CompressedDataModelAdapter::id()
+{
+    return adapter_->id();
+}
+
+std::string CompressedDataModelAdapter::extension()
+{
+    return adapter_->extension();
+}
+
+DataModel::TestSuite*
+        CompressedDataModelAdapter::file2testSuite(const std::string& filename)
+        throw (DataModelAdapter::conversion_error_exception)
+{
+    return _readSuite(filename, false);
+}
+
+DataModel::TestSuite*
+        CompressedDataModelAdapter::file2lazyTestSuite(const std::string& filename)
+        throw (DataModelAdapter::conversion_error_exception)
+{
+    return _readSuite(filename, true);
+}
+
+void CompressedDataModelAdapter::testSuite2file(const DataModel::TestSuite& ts,
+                                                const std::string& filename)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    _writeSuite(ts, 0, filename);
+}
+
+void CompressedDataModelAdapter::lazyTestSuite2file(DataModel::TestSuite& ts,
+                                                    const std::string& filename)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    _writeSuite(ts, &ts, filename);
+}
+
+DataModel::TestSuite*
+        CompressedDataModelAdapter::_readSuite(const std::string& filename, bool lazy)
+        throw (DataModelAdapter::conversion_error_exception)
+{
+    if (adapter_->threads() != threads())
+        adapter_->setThreads(threads());
+
+    if (!isCompressed(filename))
+        return lazy ? adapter_->file2lazyTestSuite(filename) : adapter_->file2testSuite(filename);
+
+    PlainFile plain(filename);
+    if (!plain.ok() || !convertFile(filename, plain.name(), -1))
+    {
+        std::cout << "(CompressedDataModelAdapter::_readSuite) ERROR while inflating the file " << filename << "." << std::endl;
+        throw DataModelAdapter::conversion_error_exception();
+    }
+    DEBUG(D_BOTH, "(CompressedDataModelAdapter::_readSuite) " << filename << " inflated to " << plain.name());
+
+    return lazy ? adapter_->file2lazyTestSuite(plain.name()) : adapter_->file2testSuite(plain.name());
+}
+
+void CompressedDataModelAdapter::_writeSuite(const DataModel::TestSuite& ts,
+                                             DataModel::TestSuite* lazy,
+                                             const std::string& filename)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    if (adapter_->threads() != threads())
+        adapter_->setThreads(threads());
+
+    if (!compressedName(filename))
+    {
+        if (lazy)
+            adapter_->lazyTestSuite2file(*lazy, filename);
+        else
+            adapter_->testSuite2file(ts, filename);
+        return;
+    }
+
+    PlainFile plain(filename);
+    if (!plain.ok())
+    {
+        std::cout << "(CompressedDataModelAdapter::_writeSuite) ERROR while creating a file for " << filename << "." << std::endl;
+        throw DataModelAdapter::conversion_error_exception();
+    }
+
+    if (lazy)
+        adapter_->lazyTestSuite2file(*lazy, plain.name());
+    else
+        adapter_->testSuite2file(ts, plain.name());
+
+    if (!convertFile(plain.name(), filename, level_))
+    {
+        std::cout << "(CompressedDataModelAdapter::_writeSuite) ERROR while writing the file " << filename << "." << std::endl;
+        throw DataModelAdapter::conversion_error_exception();
+    }
+}
+
+
+///
+/// file names and streams
+///
+
+bool CompressedDataModelAdapter::isCompressed(const std::string& filename)
+{
+    unsigned char magic[sizeof(GZIP_MAGIC)];
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file)
+        return false;
+    bool compressed = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+            std::memcmp(magic, GZIP_MAGIC, sizeof(magic)) == 0;
+    std::fclose(file);
+    return compressed;
+}
+
+bool CompressedDataModelAdapter::compressedName(const std::string& filename)
+{
+    static const std::string suffix = std::string(".") + COMPRESSED_FILE_EXTENSION;
+    return filename.size() > suffix.size() &&
+            filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string CompressedDataModelAdapter::plainName(const std::string& filename)
+{
+    if (!compressedName(filename))
+        return filename;
+    return filename.substr(0, filename.size() - std::strlen(COMPRESSED_FILE_EXTENSION) - 1);
+}
+
+bool CompressedDataModelAdapter::compress(std::FILE* in, std::FILE* out, int level)
+{
+    z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    std::vector<unsigned char> input(BLOCK_SIZE), output(BLOCK_SIZE);
+    bool ok = true;
+    int flush;
+    do
+    {
+        z.next_in = &input[0];
+        z.avail_in = std::fread(&input[0], 1, input.size(), in);
+        if (std::ferror(in))
+        {
+            ok = false;
+            break;
+        }
+        flush = std::feof(in) ? Z_FINISH : Z_NO_FLUSH;
+
+        //all the input is deflated, the output is full when there is more
+        do
+        {
+            z.next_out = &output[0];
+            z.avail_out = output.size();
+            deflate(&z, flush);
+            size_t n = output.size() - z.avail_out;
+            ok = std::fwrite(&output[0], 1, n, out) == n;
+        }
+        while (ok && z.avail_out == 0);
+    }
+    while (ok && flush != Z_FINISH);
+
+    deflateEnd(&z);
+    return ok;
+}
+
+bool CompressedDataModelAdapter::decompress(std::FILE* in, std::FILE* out)
+{
+    z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, GZIP_WINDOW_BITS) != Z_OK)
+        return false;
+
+    std::vector<unsigned char> input(BLOCK_SIZE), output(BLOCK_SIZE);
+    bool ok = true;
+    int ret = Z_OK;
+    for (;;)
+    {
+        if (z.avail_in == 0)
+        {
+            z.next_in = &input[0];
+            z.avail_in = std::fread(&input[0], 1, input.size(), in);
+            if (z.avail_in == 0)
+                break;
+        }
+        //concatenated gzip members are one stream, as for gunzip
+        if (ret == Z_STREAM_END && inflateReset(&z) != Z_OK)
+        {
+            ok = false;
+            break;
+        }
+
+        z.next_out = &output[0];
+        z.avail_out = output.size();
+        ret = inflate(&z, Z_NO_FLUSH);
+        size_t n = output.size() - z.avail_out;
+        if ((ret != Z_OK && ret != Z_STREAM_END) ||
+            std::fwrite(&output[0], 1, n, out) != n)
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    inflateEnd(&z);
+    //a truncated stream does not end
+    return ok && ret == Z_STREAM_END && !std::ferror(in);
+}
@@ -0,0 +1,104 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef COMPRESSEDDATAMODELADAPTER_H
+#define COMPRESSEDDATAMODELADAPTER_H
+
+#include <datamodeladapter.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+///
+/// compressed test suites
+///
+/// Adapter over the one of a suite format that reads and writes its
+/// files gzip compressed. The suites are much smaller that way, since
+/// the recorded items repeat the same keys and widget paths.
+///
+/// A file is read as compressed if it starts with the gzip magic
+/// bytes, whatever its name, and is written compressed if its name
+/// ends with the COMPRESSED_FILE_EXTENSION (suite.oht.gz). The other
+/// files are left to the adapter.
+///
+/// The suite is inflated to a plain file, next to the compressed one
+/// or in the temp directory, that the adapter reads and that is
+/// removed right after: the lazy suites keep reading their cases from
+/// it while it is open. The suites are deflated the other way round.
+/// Both are streamed, in blocks of BLOCK_SIZE bytes.
+///
+class CompressedDataModelAdapter : public DataModelAdapter
+{
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    // takes the adapter
+    explicit CompressedDataModelAdapter(DataModelAdapter* adapter,
+                                        int level = SUITE_COMPRESSION_LEVEL);
+    virtual ~CompressedDataModelAdapter();
+
+    DataModelAdapter* adapter() const;
+
+    // zlib level of the files written, 0 (stored) to 9
+    void setLevel(int level);
+    int level() const;
+
+    // the ones of the adapter
+    virtual std::string id();
+    virtual std::string extension();
+
+    virtual DataModel::TestSuite*
+    file2testSuite(const std::string& filename) throw (conversion_error_exception);
+
+    virtual void testSuite2file(const DataModel::TestSuite&,
+                                const std::string& filename) throw (conversion_error_exception);
+
+    virtual DataModel::TestSuite*
+    file2lazyTestSuite(const std::string& filename) throw (conversion_error_exception);
+
+    virtual void lazyTestSuite2file(DataModel::TestSuite& ts,
+                                    const std::string& filename) throw (conversion_error_exception);
+
+    // the file starts with the gzip magic bytes
+    static bool isCompressed(const std::string& filename);
+    // the name ends with the COMPRESSED_FILE_EXTENSION
+    static bool compressedName(const std::string& filename);
+    // the name without it
+    static std::string plainName(const std::string& filename);
+
+    // gzip streams, false on a read, write or format error
+    static bool compress(std::FILE* in, std::FILE* out, int level);
+    static bool decompress(std::FILE* in, std::FILE* out);
+
+private:
+    DataModel::TestSuite* _readSuite(const std::string& filename, bool lazy)
+            throw (conversion_error_exception);
+    // the adapter writes the plain file first (ts is lazy or not)
+    void _writeSuite(const DataModel::TestSuite& ts, DataModel::TestSuite* lazy,
+                     const std::string& filename) throw (conversion_error_exception);
+
+private:
+    std::auto_ptr<DataModelAdapter> adapter_;
+    int level_;
+};
+
+#endif // COMPRESSEDDATAMODELADAPTER_H
@@ -24,13 +24,18 @@
 #define DATAMODELADAPTER_H
 
 #include <datamodel.h>
+#include <caseworkers.h>
+#include <ohtbaseconfig.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <exception>
 
 
 class DataModelAdapter
 {
 public:
+    DataModelAdapter() : threads_(SUITE_IO_THREADS) {}
+    virtual ~DataModelAdapter() {}
 
     // conversion error exception
     class conversion_error_exception : public std::exception
@@ -44,12 +49,67 @@ public:
     // id method
     virtual std::string id() = 0;
 
+    // extension of the suite files of the adapter (without the dot),
+    // used to choose the adapter of a file
+    virtual std::string extension() = 0;
+
     // transformation methods
     virtual DataModel::TestSuite*
     file2testSuite(const std::string& filename) throw (conversion_error_exception)  = 0;
 
     virtual void testSuite2file(const DataModel::TestSuite&,
                                 const std::string& filename) throw (conversion_error_exception) = 0;
+
+    // lazy suites: only the index of the test cases is read, their
+    // items are read when they are loaded (see DataModel::CaseLoader).
+    // Adapters without an index read the whole suite.
+    virtual DataModel::TestSuite*
+    file2lazyTestSuite(const std::string& filename) throw (conversion_error_exception)
+    {
+        return file2testSuite(filename);
+    }
+
+    // writes a lazy suite and indexes its test cases in the new file,
+    // so they can be unloaded
+    virtual void lazyTestSuite2file(DataModel::TestSuite& ts,
+                                    const std::string& filename) throw (conversion_error_exception)
+    {
+        testSuite2file(ts, filename);
+    }
+
+    // threads reading or writing the test cases of a suite (0 for
+    // one per core, see CaseWorkers)
+    void setThreads(unsigned n)
+    {
+        threads_ = n;
+    }
+
+    unsigned threads() const
+    {
+        return threads_;
+    }
+
+    // called with the test cases done and their total as they are read
+    // or written, from the threads doing it. An empty one stops the
+    // reports.
+    void setProgress(const CaseWorkers::Progress& progress)
+    {
+        boost::mutex::scoped_lock lock(progressMutex_);
+        progress_ = progress;
+    }
+
+protected:
+    void reportProgress(size_t done, size_t total)
+    {
+        boost::mutex::scoped_lock lock(progressMutex_);
+        if (progress_)
+            progress_(done, total);
+    }
+
+private:
+    unsigned threads_;
+    boost::mutex progressMutex_;
+    CaseWorkers::Progress progress_;
 };
 
 #endif // DATAMODELADAPTER_H
@@ -22,6 +22,7 @@
  */
 
 #include "datamodelmanager.h"
+#include "compresseddatamodeladapter.h"
 
 
 DataModelManager::DataModelManager()
@@ -75,3 +76,18 @@ DataModelAdapter* DataModelManager::getCurrentDataModelAdapter() const
 {
     return currentAdapter_;
 }
+
+DataModelAdapter* DataModelManager::getDataModelAdapterForFile(const std::string& name)
+{
+    //the format of a compressed suite is the extension before
+    std::string filename = CompressedDataModelAdapter::plainName(name);
+    std::string::size_type dot = filename.rfind('.');
+    if (dot != std::string::npos && filename.find('/', dot) == std::string::npos)
+    {
+        std::string ext = filename.substr(dot + 1);
+        for (AdapterMap::iterator it = adapters_.begin(); it != adapters_.end(); ++it)
+            if (it->second->extension() == ext)
+                return it->second;
+    }
+    return currentAdapter_;
+}
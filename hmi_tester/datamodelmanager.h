@@ -55,6 +55,9 @@ public:
     StringList getDataModelAdapterKeys() const;
     bool setCurrentDataModelAdapter(const std::string& key) throw (not_exists);
     DataModelAdapter* getCurrentDataModelAdapter() const;
+    // the adapter of the file extension (the one before the
+    // COMPRESSED_FILE_EXTENSION, if any), or the current one
+    DataModelAdapter* getDataModelAdapterForFile(const std::string& filename);
 
 protected:
     DataModelAdapter* currentAdapter_;
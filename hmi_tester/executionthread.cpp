@@ -31,6 +31,7 @@ TODO in future work:
 #include <controlsignaling.h>
 #include <debug.h>
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 #include <boost/lexical_cast.hpp>
@@ -41,12 +42,19 @@ TODO in future work:
 ///
 /// constructors
 ///
-ExecutionThread::ExecutionThread(Comm *c, PlaybackObserver* pc , float speed)
+ExecutionThread::ExecutionThread(Comm *c, PlaybackObserver* pc , float speed, int window)
     : _comm (c), _observer (pc), _executionSpeed(speed)
 {
     // flags
     threadState_ = NONE;
+    pendingState_ = NONE;
     currentTestCase_ = NULL;
+
+    // window
+    sent_ = 0;
+    acked_ = 0;
+    client_ = 0;
+    _window = window > 0 ? window : 1;
 }
 
 ExecutionThread::~ExecutionThread()
@@ -88,6 +96,12 @@ void ExecutionThread::operator()()
     // set counters
     int total = currentTestCase_->count();
     int counter = 0;
+    {
+        boost::lock_guard<boost::mutex> lock(step_mutex_);
+        sent_ = 0;
+        acked_ = 0;
+        client_ = 0;
+    }
     DataModel::TestCase::TestItemList::const_iterator it;
     const DataModel::TestCase::TestItemList& il =
             currentTestCase_->testItemList();
@@ -100,9 +114,41 @@ void ExecutionThread::operator()()
         //counter control
         counter++;
 
-        //sending test item to preload module
-        _comm->handleSendTestItem(ti);
-        DEBUG(D_PLAYBACK, "(ExecutionThread::run) Item sent.");
+        //the process of the item, which may still be starting
+        int client;
+        if (!_itemClient(ti, client))
+        {
+            if (_stopRequested())
+            {
+                threadState_ = STOPPED;
+                pendingState_ = NONE;
+            }
+            else
+                threadState_ = ERROR;
+            break; // exit
+        }
+
+        //the acks are cumulative on each process only, so the items in
+        //flight are executed before switching to a different process
+        if (client != client_)
+        {
+            if (!waitExecution(0))
+            {
+                threadState_ = ERROR;
+                break; // exit
+            }
+            boost::lock_guard<boost::mutex> lock(step_mutex_);
+            client_ = client;
+        }
+
+        //sending test item to preload module, tagged with its sequence number
+        uint sequence;
+        {
+            boost::lock_guard<boost::mutex> lock(step_mutex_);
+            sequence = ++sent_;
+        }
+        _comm->handleSendTestItem(ti, sequence, client);
+        DEBUG(D_PLAYBACK, "(ExecutionThread::run) Item " << sequence << " sent.");
 
         //debug
         DEBUG(D_PLAYBACK, "(ExecutionThread::run) Executed testItem " <<
@@ -114,23 +160,45 @@ void ExecutionThread::operator()()
         //completed percentage notification
         _observer->completedPercentageNotification(counter * 100.0 / total);
 
-        //wait before continuing with the next test
-        waitExecution();
+        //wait until there is room in the window for the next test
+        if (!waitExecution(_window - 1))
+        {
+            threadState_ = ERROR;
+            break; // exit
+        }
 
         DEBUG(D_PLAYBACK, "(ExecutionThread::run) Continuing execution.");
 
-        // Once the command executed, attend pending PAUSE or STOP
+        //pausing: the items in flight are executed first
+        if (pendingState_ == PAUSED && !waitExecution(0))
+        {
+            threadState_ = ERROR;
+            break; // exit
+        }
+
+        // Once the commands executed, attend pending PAUSE or STOP
         if (pendingState_ == PAUSED)
         {
             //sending "PAUSE PLAYBACK COMMAND"
             _comm->handleSendTestItem(Control::CTI_PausePlayback());
-            threadState_  = PAUSED;
-            pendingState_ = NONE;
+            {
+                boost::lock_guard<boost::mutex> lock(pause_mutex_);
+                threadState_  = PAUSED;
+                pendingState_ = NONE;
+            }
 
             // lock the mutex
             boost::unique_lock<boost::mutex> lock(pause_mutex_);
-            resume_pause_.wait(lock);
+            while (threadState_ == PAUSED && !_stopRequested())
+                resume_pause_.wait(lock);
             DEBUG(D_PLAYBACK, "(ExecutionThread::run) Pause Mutex unlocked.");
+
+            if (_stopRequested())
+            {
+                threadState_ = STOPPED;
+                pendingState_ = NONE;
+                break; // exit
+            }
         } else if (pendingState_ == STOPPED)
         {
             threadState_ = STOPPED;
@@ -149,6 +217,10 @@ void ExecutionThread::operator()()
 
     } // for
 
+    // wait for the last items in flight
+    if (threadState_ == RUN && !waitExecution(0))
+        threadState_ = ERROR;
+
     // pause after replay
     _sleep(EXEC_PAUSE_AFTER_REPLAY);
 
@@ -163,6 +235,10 @@ void ExecutionThread::operator()()
 
     DEBUG(D_PLAYBACK, "(ExecutionThread::run) StopPlayback command sent.");
 
+    // the items for a process that did not connect are not sent
+    // to the next one with its client id
+    _comm->dropClientItems();
+
 
     DEBUG(D_PLAYBACK, "(ExecutionThread::run) Finishing."
           "________________________________________________________________");
@@ -206,6 +282,47 @@ void ExecutionThread::_sendStopPlayback()
 }
 
 
+///
+/// client of the tested process the item was recorded on. The
+/// process may be started by the items already played, so it waits
+/// for it to connect. False if it does not, or on stop.
+///
+bool ExecutionThread::_itemClient(const DataModel::TestItem& ti, int& client)
+{
+    std::string process;
+    try
+    {
+        process = ti.getMetadata(DataModel::PROCESS_METADATA);
+    }
+    catch (DataModel::not_found&)
+    {
+        //the main process, its items wait in the queue until it connects
+        client = 0;
+        return true;
+    }
+
+    //the suites recorded before the processes had keys use the
+    //connection order
+    bool legacy = boost::conversion::try_lexical_convert(process, client);
+
+    boost::posix_time::ptime deadline =
+            boost::posix_time::microsec_clock::universal_time() +
+            boost::posix_time::milliseconds(EXEC_PROCESS_TIMEOUT);
+    while (!_stopRequested())
+    {
+        if (legacy ? _comm->isConnected(client) : _comm->processClient(process, client))
+            return true;
+        if (boost::posix_time::microsec_clock::universal_time() > deadline)
+        {
+            DEBUG(D_ERROR, "(ExecutionThread::_itemClient) Process " << process
+                  << " is not connected, the test case cannot go on.");
+            return false;
+        }
+        _sleep(EXEC_POLL_INTERVAL);
+    }
+    return false;
+}
+
 void ExecutionThread::_sleep(int ms)
 {
     boost::this_thread::sleep(
@@ -234,16 +351,17 @@ void ExecutionThread::resume()
     // release the mutex, only if paused
     if (threadState_ == PAUSED)
     {
-        threadState_ = RUN;
-
         //sending "START PLAYBACK COMMAND"
         Control::CTI_StartPlayback cti;
         _comm->handleSendTestItem(cti);
 
         // notify resume
+        {
+            boost::lock_guard<boost::mutex> lock(pause_mutex_);
+            threadState_ = RUN;
+            pendingState_ = NONE;
+        }
         resume_pause_.notify_all();
-
-        pendingState_ = NONE;
     }
     // FIXME: else throw?
 }
@@ -258,7 +376,7 @@ void ExecutionThread::stop()
     DEBUG(D_PLAYBACK, "(ExecutionThread::stop)");
 
     pendingState_ = STOPPED;
-    continueExecution();
+    _wakeUp();
 }
 
 ///
@@ -269,7 +387,7 @@ void ExecutionThread::kill()
     DEBUG(D_PLAYBACK, "(ExecutionThread::kill)");
     //kill the thread and wait for it
     pendingState_ = STOPPED;
-    continueExecution();
+    _wakeUp();
 }
 
 ///
@@ -315,28 +433,87 @@ void ExecutionThread::currentTestCase(DataModel::TestCase* tc)
 
 
 ///
-/// //execution semaphore -> execution flow control
+/// //execution window -> execution flow control
 ///
 
 
 ///
-/// add one ticket to the semaphore
+/// acknowledges the items executed up to sequence
 ///
-void ExecutionThread::continueExecution()
+void ExecutionThread::continueExecution(uint sequence)
 {
-    DEBUG(D_PLAYBACK, "(ExecutionThread::continueExecution)");
+    DEBUG(D_PLAYBACK, "(ExecutionThread::continueExecution) Item " << sequence);
+    {
+        boost::lock_guard<boost::mutex> lock(step_mutex_);
+        //items are executed in order, so one ack covers the previous ones
+        if (sequence > acked_)
+            acked_ = sequence;
+    }
     next_step_ready_.notify_all();
     DEBUG(D_PLAYBACK, "(ExecutionThread::continueExecution) Exit.");
 }
 
 ///
-/// acquires one ticket from the semaphore
+/// waits until at most inFlight items are pending, or stop is requested.
+/// False if no item is acked for EXEC_ACK_TIMEOUT ms, or the secondary
+/// process the items were sent to disconnects (the main process
+/// closing stops the playback).
 ///
-void ExecutionThread::waitExecution()
+bool ExecutionThread::waitExecution(uint inFlight)
 {
     boost::unique_lock<boost::mutex> lock(step_mutex_);
 
     DEBUG(D_PLAYBACK, "(ExecutionThread::waitExecution)");
-    next_step_ready_.wait(lock);
+    uint acked = acked_;
+    boost::system_time deadline = boost::get_system_time() +
+            boost::posix_time::milliseconds(EXEC_ACK_TIMEOUT);
+    while (sent_ - acked_ > inFlight && !_stopRequested())
+    {
+        if (client_ > 0 && !_comm->isConnected(client_))
+        {
+            DEBUG(D_ERROR, "(ExecutionThread::waitExecution) Process " << client_
+                  << " disconnected with items in flight.");
+            return false;
+        }
+
+        //the deadline moves with each ack
+        boost::system_time now = boost::get_system_time();
+        if (acked_ != acked)
+        {
+            acked = acked_;
+            deadline = now + boost::posix_time::milliseconds(EXEC_ACK_TIMEOUT);
+        }
+        else if (now >= deadline)
+        {
+            DEBUG(D_ERROR, "(ExecutionThread::waitExecution) No item executed in "
+                  << EXEC_ACK_TIMEOUT << " ms.");
+            return false;
+        }
+
+        //woken up by the acks and stop, the disconnections are polled
+        next_step_ready_.timed_wait(lock, std::min(deadline,
+                now + boost::posix_time::milliseconds(EXEC_POLL_INTERVAL)));
+    }
     DEBUG(D_PLAYBACK, "(ExecutionThread::waitExecution) Exit.");
+    return true;
+}
+
+bool ExecutionThread::_stopRequested() const
+{
+    return pendingState_ == STOPPED || threadState_ == WANT_TERMINATE;
+}
+
+///
+/// wakes the thread up wherever it is waiting
+///
+void ExecutionThread::_wakeUp()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(step_mutex_);
+    }
+    next_step_ready_.notify_all();
+    {
+        boost::lock_guard<boost::mutex> lock(pause_mutex_);
+    }
+    resume_pause_.notify_all();
 }
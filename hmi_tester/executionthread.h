@@ -38,7 +38,7 @@ class ExecutionThread
     enum thread_state_t { NONE, PAUSED, RUN, STOPPED, WANT_TERMINATE, ERROR };
 
 public:
-    ExecutionThread(Comm*, PlaybackObserver*, float speed );
+    ExecutionThread(Comm*, PlaybackObserver*, float speed, int window );
     ~ExecutionThread();
 
 public:
@@ -57,9 +57,9 @@ public:
     //test case execution
     void currentTestCase(DataModel::TestCase*);
 
-    //execution semaphore
-    void continueExecution();
-    void waitExecution();
+    //execution window
+    void continueExecution(uint sequence);
+    bool waitExecution(uint inFlight);
 
 
 public:
@@ -79,6 +79,12 @@ private:
     boost::mutex step_mutex_;
     boost::condition_variable next_step_ready_;
 
+    // items in flight: sequence of the last item sent and acked
+    uint sent_;
+    uint acked_;
+    // client the items in flight were sent to
+    int client_;
+
     //test case to be executed
     DataModel::TestCase *currentTestCase_;
 
@@ -91,9 +97,15 @@ private:
     //execution speed
     float _executionSpeed;
 
+    //max number of items in flight
+    uint _window;
+
     void _sendStartPlayback();
     void _sendStopPlayback();
     void _sleep(int ms);
+    void _wakeUp();
+    bool _stopRequested() const;
+    bool _itemClient(const DataModel::TestItem&, int& client);
 };
 
 
@@ -14,7 +14,13 @@ SOURCES += hmitestercontrol.cpp \
     executionthread.cpp \
     itemmanager.cpp \
     newtsdialog.cpp \
-    newtcdialog.cpp
+    newtcdialog.cpp \
+    suitejournal.cpp \
+    recordfile.cpp \
+    recordingspool.cpp \
+    binarydatamodeladapter.cpp \
+    caseworkers.cpp \
+    compresseddatamodeladapter.cpp
 
 HEADERS += hmitestercontrol.h \
     executionobserver.h \
@@ -30,7 +36,13 @@ HEADERS += hmitestercontrol.h \
     newtcdialog.h \
     executionobserver.h \
     recordingobserver.h \
-    exceptions.h
+    exceptions.h \
+    suitejournal.h \
+    recordfile.h \
+    recordingspool.h \
+    binarydatamodeladapter.h \
+    caseworkers.h \
+    compresseddatamodeladapter.h
 
 SOURCES += qtutils.cpp
 HEADERS += qtutils.h
@@ -39,6 +51,6 @@ FORMS += hmitestercontrol.ui \
     newtsdialog.ui \
     newtcdialog.ui
 
-LIBS += -lboost_thread -lboost_system -lboost_serialization
+LIBS += -lboost_thread -lboost_system -lboost_serialization -lz
 
 RESOURCES += resources.qrc
@@ -39,18 +39,30 @@ equals(QT_MAJOR_VERSION, 5) {
     INCLUDEPATH += ../common/
 
     SOURCES += ../common/datamodel.cpp \
+               ../common/stringpool.cpp \
                ../common/comm.cpp \
                ../common/messageclientserver.cpp \
                ../common/utilclasses.cpp \
                ../common/uuid.cpp \
-               ../common/controlsignaling.cpp
+               ../common/controlsignaling.cpp \
+               ../common/protocol.cpp \
+               ../common/testitemcodec.cpp \
+               ../common/transport.cpp \
+               ../common/sockettransport.cpp \
+               ../common/shmtransport.cpp
 
     HEADERS += ../common/datamodel.h \
+               ../common/stringpool.h \
                ../common/comm.h \
                ../common/messageclientserver.h \
                ../common/utilclasses.h \
                ../common/uuid.h \
                ../common/controlsignaling.h \
+               ../common/protocol.h \
+               ../common/testitemcodec.h \
+               ../common/transport.h \
+               ../common/sockettransport.h \
+               ../common/shmtransport.h \
                ../common/ohtbaseconfig.h \
                ../common/debug.h
 }
@@ -69,7 +81,13 @@ SOURCES += hmitestercontrol.cpp \
     executionthread.cpp \
     itemmanager.cpp \
     newtsdialog.cpp \
-    newtcdialog.cpp
+    newtcdialog.cpp \
+    suitejournal.cpp \
+    recordfile.cpp \
+    recordingspool.cpp \
+    binarydatamodeladapter.cpp \
+    caseworkers.cpp \
+    compresseddatamodeladapter.cpp
 
 HEADERS += hmitestercontrol.h \
     executionobserver.h \
@@ -85,7 +103,13 @@ HEADERS += hmitestercontrol.h \
     newtcdialog.h \
     executionobserver.h \
     recordingobserver.h \
-    exceptions.h
+    exceptions.h \
+    suitejournal.h \
+    recordfile.h \
+    recordingspool.h \
+    binarydatamodeladapter.h \
+    caseworkers.h \
+    compresseddatamodeladapter.h
 
 SOURCES += qtutils.cpp
 HEADERS += qtutils.h
@@ -94,7 +118,7 @@ FORMS += hmitestercontrol.ui \
     newtsdialog.ui \
     newtcdialog.ui
 
-LIBS += -lboost_thread -lboost_system -lboost_serialization
+LIBS += -lboost_thread -lboost_system -lboost_serialization -lz
 
 OTHER_FILES += LICENSE.txt \
     hmi_tester.pri
@@ -52,6 +52,11 @@ HMITesterControl::HMITesterControl(PreloadingAction *pa, DataModelAdapter *dma,
     _processControl->context().keepAlive = false;
     _processControl->context().showTesterOnTop = true;
     _processControl->context().speed = 1;
+    _processControl->context().window = PLAYBACK_WINDOW;
+    _processControl->context().lazySuites = LAZY_TEST_SUITES;
+    _processControl->context().suiteMemoryBudget = TEST_SUITE_MEMORY_BUDGET;
+    _processControl->context().journaledSuites = JOURNALED_TEST_SUITES;
+    _processControl->context().streamRecordings = STREAM_RECORDINGS;
 
     ///
     /// initialize GUI
@@ -348,7 +353,7 @@ void HMITesterControl::action_open_triggered()
     QString path = "";
     path = QtUtils::openFileDialog("Please, select the file that contains the TestSuite:",
                                    lastOpenDir,
-                                   "*."OHT_FILE_EXTENSION);
+                                   OHT_FILE_FILTER);
     if (path == "") return;
 
     //open the testSuite
@@ -26,6 +26,7 @@
 #include <datamodelmanager.h>
 #include <controlsignaling.h>
 #include <debug.h>
+#include <boost/lexical_cast.hpp>
 
 /// ///
 ///
@@ -36,8 +37,10 @@ ItemManager::ItemManager(Comm* c, RecordingObserver* ro)
     : comm_(c), observer_(ro)
 {
     //signals from comm
-    connect(comm_, SIGNAL(receivedTestItem (DataModel::TestItem*)),
-            this, SLOT(handleNewTestItem ( DataModel::TestItem* )));
+    connect(comm_, SIGNAL(receivedTestItem (DataModel::TestItemPtr, uint, int)),
+            this, SLOT(handleNewTestItem ( DataModel::TestItemPtr, uint, int )));
+    connect(comm_, SIGNAL(clientConnected (int)),
+            this, SLOT(handleClientConnected (int)));
 
     //flags initialization
     f_recording_ = false;
@@ -58,12 +61,13 @@ ItemManager::~ItemManager()
 /// recording process control
 ///
 /// ///
-void ItemManager::recordTestCase(DataModel::TestCase* tc)
+void ItemManager::recordTestCase(DataModel::TestCase* tc, RecordingSpool* spool)
 {
     DEBUG(D_RECORDING, "(ItemManager::recordTestCase)");
     //current test case reference
     assert(tc);
     currentTestCase_ = tc;
+    spool_.reset(spool);
 
     //updating flags
     f_recording_ = true;
@@ -123,7 +127,7 @@ void ItemManager::stopRecording()
     comm_->handleSendTestItem(cti);
 
     //emiting the recording process finished signal
-    observer_->testRecordingFinished(currentTestCase_);
+    _finishRecording();
 
 }
 
@@ -143,10 +147,51 @@ void ItemManager::applicationFinished()
         rtiCounter_ = 0;
 
         //emiting the recording process finished signal
-        observer_->testRecordingFinished(currentTestCase_);
+        _finishRecording();
     }
 }
 
+void ItemManager::_finishRecording()
+{
+    //the spooled items are moved to the case before it is saved, and
+    //the spool is removed once all of them are. Otherwise it is left
+    //to be recovered.
+    std::auto_ptr<RecordingSpool> spool(spool_);
+    bool loaded = !spool.get() || spool->load(*currentTestCase_);
+    if (!loaded)
+    {
+        DEBUG(D_ERROR, "(ItemManager::_finishRecording) Error reading " << spool->filename()
+              << ", TestCase " << currentTestCase_->name() << " incomplete.");
+    }
+
+    bool saved = observer_->testRecordingFinished(currentTestCase_);
+
+    if (spool.get())
+    {
+        if (loaded && saved)
+            spool->remove();
+        else
+        {
+            DEBUG(D_ERROR, "(ItemManager::_finishRecording) The recording is kept in "
+                  << spool->filename() << ".");
+        }
+    }
+}
+
+void ItemManager::_unspool()
+{
+    DEBUG(D_ERROR, "(ItemManager::_unspool) Error writing " << spool_->filename()
+          << ", the recording continues in memory.");
+    if (spool_->load(*currentTestCase_))
+        spool_->remove();
+    else
+    {
+        DEBUG(D_ERROR, "(ItemManager::_unspool) Error reading " << spool_->filename()
+              << ", it is kept.");
+    }
+    spool_.reset();
+}
+
 /// ///
 ///
 /// recording process state
@@ -167,16 +212,34 @@ bool ItemManager::isPaused()
 /// messages received from Preload Module
 ///
 /// ///
-void ItemManager::handleNewTestItem (DataModel::TestItem* ti)
+void ItemManager::handleNewTestItem (DataModel::TestItemPtr ti, uint, int client)
 {
     DEBUG(D_RECORDING, "(ItemManager::handleNewTestItem)");
+    //the control items are handled by the process control
+    if (ti->type() == Control::CTI_TYPE)
+        return;
     //if it is in recording process...
     if (isRecording() && currentTestCase_)
     {
         DEBUG(D_RECORDING, "(ItemManager::handleNewTestItem) Adding new TestItem to the current TestCase.");
-        DEBUG(D_RECORDING, "(ItemManager::handleNewTestItem) TestItem type = " << ti->type());
-        //add the to a new TestItem
-        currentTestCase_->addTestItem(ti);
+        DEBUG(D_RECORDING, "(ItemManager::handleNewTestItem) TestItem type = " << ti->type()
+              << " process = " << client);
+        //tag the items of the secondary processes with the key of
+        //their process, so they can be routed back to it in playback
+        if (client > 0)
+        {
+            std::string process = comm_->processKey(client);
+            if (process.empty())
+                process = boost::lexical_cast<std::string>(client);
+            ti->addMetadata(DataModel::PROCESS_METADATA, process);
+        }
+        //the item goes to disk, only the last ones stay in memory
+        if (spool_.get() && !spool_->append(ti))
+            _unspool();
+        //or its data is moved into the current TestCase (the other
+        //receivers only look at the control items)
+        if (!spool_.get())
+            currentTestCase_->takeTestItem(*ti);
         //updating counter
         rtiCounter_++;
         //emiting rtiCounter signal
@@ -184,3 +247,15 @@ void ItemManager::handleNewTestItem (DataModel::TestItem* ti)
     }
 }
 
+void ItemManager::handleClientConnected (int client)
+{
+    //the first process gets the commands queued before it connected,
+    //the ones started later join the recording here
+    if (isRecording() && client > 0)
+    {
+        DEBUG(D_RECORDING, "(ItemManager::handleClientConnected) Process " << client
+              << " joins the recording.");
+        Control::CTI_StartRecording cti;
+        comm_->handleSendTestItem(cti, 0, client);
+    }
+}
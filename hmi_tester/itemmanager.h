@@ -26,7 +26,9 @@
 #include "comm.h"
 #include <datamodel.h>
 #include <recordingobserver.h>
+#include <recordingspool.h>
 #include <QObject>
+#include <memory>
 
 class ItemManager : public QObject
 {
@@ -40,7 +42,8 @@ class ItemManager : public QObject
 public slots:
 
     ///recording process control
-    void recordTestCase(DataModel::TestCase*);
+    //the items are spooled to disk if a spool is given (owned by this)
+    void recordTestCase(DataModel::TestCase*, RecordingSpool* spool = NULL);
     void pauseRecording();
     void resumeRecording();
     void stopRecording();
@@ -52,10 +55,18 @@ public slots:
     bool isPaused();
 
     //messages received from Preload Module
-    void handleNewTestItem ( DataModel::TestItem* );
+    void handleNewTestItem ( DataModel::TestItemPtr, uint sequence, int client );
+
+    //a new tested process connected
+    void handleClientConnected ( int client );
 
 private:
 
+    //moves the spooled items to the case and saves it
+    void _finishRecording();
+    //keeps recording in memory, if the spool can not be written
+    void _unspool();
+
     //recording flags
     bool f_recording_;
     bool f_paused_;
@@ -73,6 +84,8 @@ private:
 
     //current test case
     DataModel::TestCase *currentTestCase_;
+    //its items on disk, while recording
+    std::auto_ptr<RecordingSpool> spool_;
 };
 
 #endif // ITEMMANAGER_H
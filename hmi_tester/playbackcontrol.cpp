@@ -24,6 +24,7 @@
 #include "playbackcontrol.h"
 #include "executionthread.h"
 #include "debug.h"
+#include <controlsignaling.h>
 #include <boost/ref.hpp>
 
 PlaybackControl::PlaybackControl(Comm *c, PlaybackObserver* pc)
@@ -41,7 +42,7 @@ PlaybackControl::~PlaybackControl()
 /// execution process control
 ///
 /// ///
-bool PlaybackControl::runTestCase(DataModel::TestCase* tc, float speed)
+bool PlaybackControl::runTestCase(DataModel::TestCase* tc, float speed, int window)
 {
     // //execution thread should exist and be stoped
     // if (!executionThread_.get())
@@ -57,7 +58,7 @@ bool PlaybackControl::runTestCase(DataModel::TestCase* tc, float speed)
     // }
 
     // create a new execution thread for this testcase
-    executionThread_.reset(new ExecutionThread (comm_, observer_, speed));
+    executionThread_.reset(new ExecutionThread (comm_, observer_, speed, window));
 
 
     //execution thread
@@ -122,8 +123,19 @@ void PlaybackControl::applicationFinished()
     }
 }
 
-void PlaybackControl::handleEventExecutedOnPreloadModule()
+void PlaybackControl::handleEventExecutedOnPreloadModule(uint sequence)
 {
-    //add a new item on the execution semaphore
-    executionThread_->continueExecution();
+    //acknowledge the item on the execution window
+    executionThread_->continueExecution(sequence);
+}
+
+void PlaybackControl::handleClientConnected(int client)
+{
+    //the first process gets the commands queued before it connected,
+    //the ones started later join the playback here
+    if (client > 0 && executionThread_.get() && executionThread_->isRunning())
+    {
+        Control::CTI_StartPlayback cti;
+        comm_->handleSendTestItem(cti, 0, client);
+    }
 }
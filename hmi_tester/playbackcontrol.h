@@ -40,14 +40,15 @@ public:
     ~PlaybackControl();
 
     ///execution process control
-    bool runTestCase(DataModel::TestCase*, float speed);
+    bool runTestCase(DataModel::TestCase*, float speed, int window);
     bool pauseExecution();
     bool resumeExecution();
     bool stopExecution();
 
     //some notification signal handlers
     void applicationFinished();
-    void handleEventExecutedOnPreloadModule();
+    void handleEventExecutedOnPreloadModule(uint sequence);
+    void handleClientConnected(int client);
 
 private:
 
@@ -25,6 +25,7 @@
 
 #include <QObject>
 #include <string>
+#include <map>
 
 #include <exceptions.h>
 
@@ -34,6 +35,10 @@ class PreloadingAction : public QObject
 
 public:
 
+    ///
+    /// variables added to the application environment
+    ///
+    typedef std::map<std::string, std::string> Environment;
 
     ///
     /// returns lib preload location
@@ -47,7 +52,8 @@ public:
     virtual bool launchApplication( const std::string &binaryPath,
                                     const std::string &preloadLibraryPath,
                                     const std::string &outputFile,
-                                    const std::string &errorFile) throw (bin_error_exception, lib_error_exception) = 0;
+                                    const std::string &errorFile,
+                                    const Environment &environment) throw (bin_error_exception, lib_error_exception) = 0;
 
     ///
     /// stops the binary
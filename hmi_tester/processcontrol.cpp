@@ -27,11 +27,72 @@
 #include <debug.h>
 #include <qtutils.h>
 #include <hmitestercontrol.h>
+#include <binarydatamodeladapter.h>
+#include <compresseddatamodeladapter.h>
+
+#include <QEventLoop>
+#include <QProgressDialog>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
+
+///
+/// test suite files in background
+///
+
+static bool readSuiteTask(DataModelAdapter* adapter, const std::string& file, bool lazy,
+                          DataModel::TestSuite** ts)
+{
+    try
+    {
+        *ts = lazy ? adapter->file2lazyTestSuite(file) : adapter->file2testSuite(file);
+        return true;
+    }
+    catch (DataModelAdapter::conversion_error_exception&)
+    {
+        return false;
+    }
+}
+
+static bool writeSuiteTask(DataModelAdapter* adapter, DataModel::TestSuite* ts,
+                           const std::string& file, bool lazy)
+{
+    try
+    {
+        if (lazy)
+            adapter->lazyTestSuite2file(*ts, file);
+        else
+            adapter->testSuite2file(*ts, file);
+        return true;
+    }
+    catch (DataModelAdapter::conversion_error_exception&)
+    {
+        return false;
+    }
+}
+
+static void runTask(const boost::function<bool ()>& task, bool* ok, QEventLoop* loop)
+{
+    *ok = task();
+    QMetaObject::invokeMethod(loop, "quit", Qt::QueuedConnection);
+}
+
+// called from the adapter threads, shown by the GUI thread
+static void postProgress(QProgressDialog* dialog, size_t done, size_t total)
+{
+    QMetaObject::invokeMethod(dialog, "setMaximum", Qt::QueuedConnection,
+                              Q_ARG(int, static_cast<int>(total)));
+    QMetaObject::invokeMethod(dialog, "setValue", Qt::QueuedConnection,
+                              Q_ARG(int, static_cast<int>(done)));
+}
 
 ProcessControl::ProcessControl(PreloadingAction *pa, DataModelAdapter *dma)
 {
     //variable initialization
     gui_reference_ = NULL;
+    _current_testsuite = NULL;
+    _current_testcase = NULL;
     current_filename_ = "";
 
     // store specific preloading action
@@ -48,6 +109,7 @@ ProcessControl::ProcessControl(PreloadingAction *pa, DataModelAdapter *dma)
 
 ProcessControl::~ProcessControl()
 {
+    _finishCompaction();
 }
 
 /// ///
@@ -64,13 +126,18 @@ void ProcessControl::initialize()
 
     ///
     /// communication manager creation
-    _comm.reset (new Comm(TCP_PORT, true));
+    _comm.reset (new Comm(Transport::Endpoint::forSession(), true));
 
     ///
     /// dataModelManager
+    //the adapters also read and write the compressed suites
     dataModel_manager_ = new DataModelManager();
-    dataModel_manager_->addDataModelAdapter(dataModel_adapter_->id(), dataModel_adapter_);
+    dataModel_manager_->addDataModelAdapter(dataModel_adapter_->id(),
+                                            new CompressedDataModelAdapter(dataModel_adapter_));
     assert(dataModel_manager_->setCurrentDataModelAdapter(dataModel_adapter_->id()));
+    //the binary suites are read and written by their extension
+    DataModelAdapter* binary = new CompressedDataModelAdapter(new BinaryDataModelAdapter());
+    dataModel_manager_->addDataModelAdapter(binary->id(), binary);
 
     ///
     /// checking preload library
@@ -107,8 +174,10 @@ void ProcessControl::initialize()
     //signals between this and Comm
     connect(_comm.get(),SIGNAL(error(const std::string&)),
             this,SLOT(slot_handleCommError(const std::string&)));
-    connect(_comm.get(),SIGNAL(receivedTestItem (DataModel::TestItem*)),
-            this,SLOT(handleControlSignaling (DataModel::TestItem*)));
+    connect(_comm.get(),SIGNAL(receivedTestItem (DataModel::TestItemPtr, uint, int)),
+            this,SLOT(handleControlSignaling (DataModel::TestItemPtr, uint, int)));
+    connect(_comm.get(),SIGNAL(clientConnected (int)),
+            this,SLOT(slot_handleClientConnected (int)));
 
     //signals between preloadingAction and this
     connect(preloading_action_, SIGNAL(preloadingError(const std::string&)),
@@ -174,6 +243,8 @@ void ProcessControl::onPlay_playClicked()
         // get the first element of the queue
         _current_testcase = _testcases_queue.front();
         _testcases_queue.pop_front();
+        //the cases played before may be unloaded
+        _unloadTestCases();
 
         //if the current test case is OK...
         if (_current_testcase)
@@ -189,7 +260,8 @@ void ProcessControl::onPlay_playClicked()
                         _current_testsuite->appId(),//app
                         current_libPreload_path_,//preload lib
                         STANDARD_OUTPUT_FILE,//output file
-                        ERROR_OUTPUT_FILE);//error file
+                        ERROR_OUTPUT_FILE,//error file
+                        _preloadEnvironment());//endpoint
 
             //if not launched properly...
             if (!ok)
@@ -200,7 +272,8 @@ void ProcessControl::onPlay_playClicked()
 
             //start playback process
             DEBUG(D_PLAYBACK,"(ProcessControl::onPlay_playClicked) Starting playback process.");
-            ok = playback_control_->runTestCase(_current_testcase, context_.speed);
+            ok = playback_control_->runTestCase(_current_testcase, context_.speed,
+                                               context_.window);
             if (!ok)
             {
                 //stop the app
@@ -373,7 +446,8 @@ void ProcessControl::onRecord_recClicked()
                         _current_testsuite->appId(),//app
                         current_libPreload_path_,//preload lib
                         STANDARD_OUTPUT_FILE,//output file
-                        ERROR_OUTPUT_FILE);//error file
+                        ERROR_OUTPUT_FILE,//error file
+                        _preloadEnvironment());//endpoint
 
             //if not is launched properly...
             if (!ok)
@@ -388,7 +462,8 @@ void ProcessControl::onRecord_recClicked()
             _setState(RECORD);
 
             //start recording process
-            recording_control_->recordTestCase(_current_testcase);
+            recording_control_->recordTestCase(_current_testcase,
+                                               _recordingSpool(_current_testcase->name()));
 
             DEBUG(D_RECORDING,"(ProcessControl::onRecord_recClicked) Recording process started.");
         }
@@ -421,17 +496,28 @@ bool ProcessControl::openTestSuite(const std::string& file)
 {
     DEBUG(D_BOTH,"(ProcessControl::openTestSuite)");
 
-    ///get the testSuite object from the file
-    DataModel::TestSuite* ts;
-    try{
-        ts = dataModel_manager_->getCurrentDataModelAdapter()->file2testSuite(file);
-    }
-    //if a conversion error occurs...
-    catch (DataModelAdapter::conversion_error_exception&){
+    //the previous suite file is completed first
+    _finishCompaction();
+
+    ///get the testSuite object from the file, off the GUI thread
+    DataModel::TestSuite* ts = NULL;
+    DataModelAdapter* adapter = dataModel_manager_->getDataModelAdapterForFile(file);
+    if (!_runWithProgress("Opening the test suite...", adapter,
+                          boost::bind(&readSuiteTask, adapter, file, context_.lazySuites, &ts)))
+    {
+        //if a conversion error occurs...
         DEBUG(D_ERROR,"(ProcessControl::openTestSuite) Error converting from a file.");
         return false;
     }
 
+    //and the changes journaled since it was written
+    std::auto_ptr<SuiteJournal> journal;
+    if (context_.journaledSuites)
+    {
+        journal.reset(new SuiteJournal(file));
+        journal->replay(*ts);
+    }
+
     //check if the binary exists
     bool ok = QtUtils::isExecutable(QString(ts->appId().c_str()));//FIXME remove Qt from here
     if (!ok)
@@ -442,11 +528,14 @@ bool ProcessControl::openTestSuite(const std::string& file)
 
     //save the current fileName
     current_filename_ = file;
+    journal_ = journal;
 
     //if everithing OK...
 
     // FIXME: check if the memory is properly managed
     _current_testsuite = ts;
+    _recoverRecordings();
+    _compactJournal();
 
     //update the internal state
     _setState(STOP);
@@ -470,13 +559,15 @@ bool ProcessControl::newTestSuite(const std::string& file,
     _current_testsuite->name(name);
     _current_testsuite->appId(appId);
 
-    //dump the testSuite to a file
-    dataModel_manager_->getCurrentDataModelAdapter()->testSuite2file(*_current_testsuite,file);
-    DEBUG(D_BOTH, "(ProcessControl::newTestSuite) TestSuite file updated.");
-
     //save the current fileName
     current_filename_ = file;
 
+    //dump the testSuite to a file, dropping any older journal
+    _finishCompaction();
+    journal_.reset(context_.journaledSuites ? new SuiteJournal(file) : NULL);
+    _saveTestSuite();
+    DEBUG(D_BOTH, "(ProcessControl::newTestSuite) TestSuite file updated.");
+
     // TODO: try/catch. if exception current = aux
 
     //if everything ok...
@@ -504,8 +595,16 @@ bool ProcessControl::checkAndQueueTestCase(const std::string& tcName)
         try {
             //and the test case exists...
             tc = _current_testsuite->getTestCase(tcName);
+            //and its items can be read...
+            if (!tc->load())
+            {
+                DEBUG(D_ERROR, "(ProcessControl::checkAndQueueTestCase) Error loading the TestCase "
+                      << tcName << ".");
+                return false;
+            }
             // add to the queue
             _testcases_queue.push_back(tc);
+            _unloadTestCases();
             return true;
         }
         catch (DataModel::not_found&) {
@@ -529,7 +628,7 @@ bool ProcessControl::deleteTestCase(const std::string& tcName)
             _current_testsuite->deleteTestCase (tcName);
 
             //update the file
-            dataModel_manager_->getCurrentDataModelAdapter()->testSuite2file(*_current_testsuite, current_filename_);
+            _saveDeletion(tcName);
 
             //update the GUI
             gui_reference_->updateTestSuiteInfo(_current_testsuite);
@@ -662,7 +761,7 @@ void ProcessControl::completedPercentageNotification(int i)
 ///
 /// ///
 
-void ProcessControl::testRecordingFinished(DataModel::TestCase* tc)
+bool ProcessControl::testRecordingFinished(DataModel::TestCase* tc)
 {
     DEBUG(D_RECORDING,"(ProcessControl::testRecordingFinished)");
 
@@ -672,9 +771,11 @@ void ProcessControl::testRecordingFinished(DataModel::TestCase* tc)
     //update the GUI
     gui_reference_->updateTestSuiteInfo(_current_testsuite);
 
-    //dump the testSuite to a file
-    dataModel_manager_->getCurrentDataModelAdapter()->testSuite2file(*_current_testsuite, current_filename_);
+    //dump the testCase to the file
+    if (!_saveTestCase(*_current_testcase))
+        return false;
     DEBUG(D_BOTH, "(ProcessControl::testRecordingFinished) TestSuite file updated.");
+    return true;
 }
 
 void ProcessControl::testItemsReceivedCounter(int i)
@@ -728,6 +829,16 @@ void ProcessControl::slot_handleApplicationClosed(int i)
     }
 }
 
+void ProcessControl::slot_handleClientConnected(int client)
+{
+    DEBUG(D_BOTH,"(ProcessControl::slot_handleClientConnected) Process " << client);
+
+    //a process started while playing (the recording is
+    //handled by the item manager)
+    if (state_ == PLAY)
+        playback_control_->handleClientConnected(client);
+}
+
 void ProcessControl::slot_handlePreloadingError(const std::string& s)
 {
     DEBUG(D_ERROR, "(ProcessControl::preloading_handleErrorNotification) " + s);
@@ -739,7 +850,7 @@ void ProcessControl::slot_handlePreloadingError(const std::string& s)
 ///
 /// ///
 
-void ProcessControl::handleControlSignaling ( DataModel::TestItem* ti)
+void ProcessControl::handleControlSignaling ( DataModel::TestItemPtr ti, uint sequence, int client)
 {
     DEBUG(D_BOTH,"(ProcessControl::handleControlSignaling)");
 
@@ -751,7 +862,7 @@ void ProcessControl::handleControlSignaling ( DataModel::TestItem* ti)
         if (ti->subtype() == Control::CTI_ERROR)
         {
             DEBUG(D_BOTH,"(ProcessControl::handleControlSignaling) ERROR.");
-            Control::CTI_Error *cti = static_cast<Control::CTI_Error*>(ti);
+            Control::CTI_Error *cti = static_cast<Control::CTI_Error*>(ti.get());
             handle_CTI_Error(cti->description());
         }
         // 90 -> control signaling PM > OHT
@@ -759,7 +870,7 @@ void ProcessControl::handleControlSignaling ( DataModel::TestItem* ti)
         else if (ti->subtype() == Control::CTI_EVENT_EXECUTED)
         {
             DEBUG(D_BOTH,"(ProcessControl::handleControlSignaling) Event Executed.");
-            handle_CTI_EventExecuted();
+            handle_CTI_EventExecuted(sequence, client);
         }
     }
 }
@@ -772,15 +883,219 @@ void ProcessControl::handle_CTI_Error(const std::string& message)
     //TODO
 }
 
-void ProcessControl::handle_CTI_EventExecuted()
+void ProcessControl::handle_CTI_EventExecuted(uint sequence, int client)
 {
-    DEBUG(D_PLAYBACK,"(ProcessControl::handle_CTI_EventExecuted)");
-    playback_control_->handleEventExecutedOnPreloadModule();
+    DEBUG(D_PLAYBACK,"(ProcessControl::handle_CTI_EventExecuted) Item " << sequence
+          << " on process " << client);
+    playback_control_->handleEventExecutedOnPreloadModule(sequence);
 }
 
 ///
 ///support methods
 ///
+///
+/// environment telling the preload module where to connect
+///
+PreloadingAction::Environment ProcessControl::_preloadEnvironment()
+{
+    PreloadingAction::Environment env;
+    env[ENDPOINT_ENVVAR] = _comm->endpoint().toString();
+    return env;
+}
+
+bool ProcessControl::_runWithProgress(const std::string& label, DataModelAdapter* adapter,
+                                      const boost::function<bool ()>& task)
+{
+    //shown if the task takes long, busy until the first case is done
+    QProgressDialog progress(QString::fromStdString(label), QString(), 0, 0, gui_reference_);
+    progress.setMinimumDuration(SUITE_PROGRESS_DELAY);
+    adapter->setProgress(boost::bind(&postProgress, &progress, _1, _2));
+
+    //the GUI is repainted meanwhile, but takes no input
+    bool ok = false;
+    QEventLoop loop;
+    boost::thread worker(boost::bind(&runTask, task, &ok, &loop));
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+    worker.join();
+
+    adapter->setProgress(CaseWorkers::Progress());
+    return ok;
+}
+
+///
+/// test suite file and memory
+///
+void ProcessControl::_saveTestSuite()
+{
+    //a compaction would rename an older suite over this one
+    _finishCompaction();
+
+    //written off the GUI thread. The lazy cases are indexed in the new
+    //file, so the saved ones can be unloaded too.
+    DataModelAdapter* adapter = dataModel_manager_->getDataModelAdapterForFile(current_filename_);
+    if (!_runWithProgress("Saving the test suite...", adapter,
+                          boost::bind(&writeSuiteTask, adapter, _current_testsuite,
+                                      current_filename_, context_.lazySuites)))
+        throw DataModelAdapter::conversion_error_exception();
+    _unloadTestCases();
+
+    //the journaled changes are in the file now
+    if (journal_.get())
+        journal_->clear();
+}
+
+bool ProcessControl::_saveTestCase(const DataModel::TestCase& tc)
+{
+    if (journal_.get() && journal_->addTestCase(tc))
+    {
+        _compactJournal();
+        return true;
+    }
+
+    try
+    {
+        _saveTestSuite();
+    }
+    catch (DataModelAdapter::conversion_error_exception&)
+    {
+        DEBUG(D_ERROR, "(ProcessControl::_saveTestCase) Error saving the TestCase " << tc.name()
+              << " to " << current_filename_ << ".");
+        return false;
+    }
+    return true;
+}
+
+void ProcessControl::_saveDeletion(const std::string& tcName)
+{
+    if (journal_.get() && journal_->deleteTestCase(tcName))
+        _compactJournal();
+    else
+        _saveTestSuite();
+}
+
+void ProcessControl::_compactJournal()
+{
+    if (!journal_.get() || compaction_.get() ||
+        !journal_->compactable(JOURNAL_COMPACT_RATIO, JOURNAL_COMPACT_MIN))
+        return;
+
+    DEBUG(D_BOTH, "(ProcessControl::_compactJournal) Compacting " << journal_->filename()
+          << " (" << journal_->size() << " bytes).");
+    compaction_.reset(new SuiteCompaction(dataModel_manager_->getDataModelAdapterForFile(current_filename_),
+                                          current_filename_, journal_->size(),
+                                          context_.lazySuites));
+    compaction_thread_ = boost::thread(boost::bind(&ProcessControl::_runCompaction,
+                                                   this, compaction_.get()));
+}
+
+void ProcessControl::_runCompaction(SuiteCompaction* compaction)
+{
+    (*compaction)();
+    //finished in the GUI thread
+    QMetaObject::invokeMethod(this, "_compactionFinished", Qt::QueuedConnection);
+}
+
+void ProcessControl::_compactionFinished()
+{
+    _finishCompaction();
+}
+
+void ProcessControl::_finishCompaction()
+{
+    if (!compaction_.get())
+        return;
+    compaction_thread_.join();
+    std::auto_ptr<SuiteCompaction> compaction(compaction_);
+
+    assert(journal_.get());
+    std::set<std::string> changed = journal_->changedSince(compaction->journalSize());
+    if (!compaction->commit(*journal_))
+        return;
+
+    //the cases not changed since the compaction started are read from
+    //the new file, so the recorded ones can be unloaded too
+    DataModel::TestSuite* compacted = compaction->result();
+    if (!context_.lazySuites || !_current_testsuite || !compacted)
+        return;
+
+    const DataModel::TestSuite::TestCaseList& tcl = _current_testsuite->testCases();
+    DataModel::TestSuite::TestCaseList::const_iterator it;
+    for (it = tcl.begin(); it != tcl.end(); ++it)
+    {
+        DataModel::TestCase* tc = compacted->existsTestCase(it->name());
+        if (tc && tc->loader() && !changed.count(it->name()))
+            _current_testsuite->getTestCase(it->name())->setLoader(tc->loader(), tc->index());
+    }
+    _unloadTestCases();
+}
+
+void ProcessControl::_unloadTestCases()
+{
+    if (!_current_testsuite || !context_.lazySuites)
+        return;
+
+    //the queued cases and the one being played stay loaded
+    std::set<const DataModel::TestCase*> keep(_testcases_queue.begin(),
+                                              _testcases_queue.end());
+    if (_current_testcase)
+        keep.insert(_current_testcase);
+
+    _current_testsuite->unloadTestCases(context_.suiteMemoryBudget, keep);
+}
+
+RecordingSpool* ProcessControl::_recordingSpool(const std::string& tcName)
+{
+    if (!context_.streamRecordings || current_filename_.empty())
+        return NULL;
+
+    std::auto_ptr<RecordingSpool> spool(new RecordingSpool(current_filename_, tcName,
+                                                           RECORDING_TAIL_ITEMS,
+                                                           RECORDING_SYNC_ITEMS));
+    if (!spool->ok())
+    {
+        spool->remove();
+        return NULL;
+    }
+    return spool.release();
+}
+
+void ProcessControl::_recoverRecordings()
+{
+    std::vector<std::string> files = RecordingSpool::find(current_filename_);
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        std::auto_ptr<DataModel::TestCase> tc(new DataModel::TestCase());
+        //the file is kept until its items are saved
+        if (!RecordingSpool::recover(files[i], *tc))
+        {
+            DEBUG(D_ERROR, "(ProcessControl::_recoverRecordings) " << files[i]
+                  << " could not be read, it is kept.");
+            continue;
+        }
+        if (tc->count() > 0)
+        {
+            //a case recorded again keeps its saved version
+            std::string name = tc->name();
+            for (int n = 1; _current_testsuite->existsTestCase(name); n++)
+                name = tc->name() + " (recovered" +
+                        (n > 1 ? " " + boost::lexical_cast<std::string>(n) : "") + ")";
+            tc->name(name);
+
+            DEBUG(D_BOTH, "(ProcessControl::_recoverRecordings) Recovered " << tc->count()
+                  << " items of the TestCase " << name << " from " << files[i] << ".");
+            DataModel::TestCase* recovered = tc.release();
+            _current_testsuite->addTestCase(recovered);
+            if (!_saveTestCase(*recovered))
+            {
+                DEBUG(D_ERROR, "(ProcessControl::_recoverRecordings) " << files[i]
+                      << " is kept until the TestCase " << name << " is saved.");
+                continue;
+            }
+        }
+        std::remove(files[i].c_str());
+    }
+}
+
 void ProcessControl::_setState(OHTProcessState s)
 {
     //STOP
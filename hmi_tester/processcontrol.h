@@ -31,8 +31,11 @@
 #include <preloadingaction.h>
 #include <executionobserver.h>
 #include <recordingobserver.h>
+#include <suitejournal.h>
 
 #include <QObject>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
 #include <memory>
 
 // Fwd
@@ -60,6 +63,11 @@ public:
     {
         bool keepAlive;
         float speed;
+        int window;//playback items in flight (1 = wait every item)
+        bool lazySuites;//read the test cases when they are played
+        size_t suiteMemoryBudget;//bytes of loaded test items
+        bool journaledSuites;//append the changes instead of rewriting the suite
+        bool streamRecordings;//spool the recorded items to disk
         bool showTesterOnTop;
     } OHTProcessContext;
 
@@ -84,7 +92,7 @@ public:
     ///
     /// RecordingObserver implementation
     ///
-    virtual void testRecordingFinished(DataModel::TestCase*);
+    virtual bool testRecordingFinished(DataModel::TestCase*);
     virtual void testItemsReceivedCounter(int);
 
 public slots:
@@ -153,13 +161,25 @@ private slots:
     void slot_handleApplicationClosed(int);
     void slot_handlePreloadingError(const std::string&);
 
+    ///
+    /// handled signals from comm
+    ///
+
+    void slot_handleClientConnected(int);
+
     ///
     /// control signaling handle
     ///
 
-    void handleControlSignaling (DataModel::TestItem*);
+    void handleControlSignaling (DataModel::TestItemPtr, uint sequence, int client);
     void handle_CTI_Error(const std::string& message);
-    void handle_CTI_EventExecuted();
+    void handle_CTI_EventExecuted(uint sequence, int client);
+
+    ///
+    /// journal compaction
+    ///
+
+    void _compactionFinished();
 
 
 private:
@@ -169,6 +189,30 @@ private:
     ///
 
     void _setState(OHTProcessState);
+    PreloadingAction::Environment _preloadEnvironment();
+
+    //runs an adapter call in a thread, showing its progress while the
+    //GUI thread waits for it
+    bool _runWithProgress(const std::string& label, DataModelAdapter*,
+                          const boost::function<bool ()>& task);
+    //writes the current testSuite to its file
+    void _saveTestSuite();
+    //unloads the test cases not in use above the memory budget
+    void _unloadTestCases();
+    //append a recorded or deleted test case to the journal, or write
+    //the whole testSuite if it can not be journaled
+    // false if it could not be written to the journal or the file
+    bool _saveTestCase(const DataModel::TestCase&);
+    void _saveDeletion(const std::string& tcName);
+    //compacts the journal in background when it is large enough
+    void _compactJournal();
+    void _runCompaction(SuiteCompaction*);
+    //waits for the compaction and renames the new file over the suite
+    void _finishCompaction();
+    //the spool of a test case to be recorded, NULL to record in memory
+    RecordingSpool* _recordingSpool(const std::string& tcName);
+    //adds the recordings interrupted by a crash to the testSuite
+    void _recoverRecordings();
 
     ///
     ///variables
@@ -198,6 +242,10 @@ private:
     DataModel::TestCase* _current_testcase;
     //current fileName
     std::string current_filename_;
+    //changes not yet written to the file, and its compaction
+    std::auto_ptr<SuiteJournal> journal_;
+    std::auto_ptr<SuiteCompaction> compaction_;
+    boost::thread compaction_thread_;
     // current lib preload path
     std::string current_libPreload_path_;
     // current oht bin path
@@ -0,0 +1,261 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "recordfile.h"
+#include <debug.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    const long long RECORD_HEADER_SIZE = 9;
+
+    void put32(std::string& s, unsigned int v)
+    {
+        for (int i = 0; i < 4; i++)
+            s += char((v >> (8 * i)) & 0xff);
+    }
+
+    unsigned int get32(const char* p)
+    {
+        unsigned int v = 0;
+        for (int i = 0; i < 4; i++)
+            v |= (unsigned int)(unsigned char)p[i] << (8 * i);
+        return v;
+    }
+
+    // FNV-1a of the type and the payload
+    unsigned int checksum(char type, const std::string& payload)
+    {
+        unsigned int h = 2166136261u;
+        h = (h ^ (unsigned char)type) * 16777619u;
+        for (size_t i = 0; i < payload.size(); i++)
+            h = (h ^ (unsigned char)payload[i]) * 16777619u;
+        return h;
+    }
+
+    bool writeAll(int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+}
+
+const long long RecordFile::HEADER_SIZE;
+const unsigned int RecordFile::MAX_PAYLOAD;
+
+RecordFile::RecordFile(const std::string& filename, const char* magic)
+    : filename_(filename), magic_(magic, HEADER_SIZE), fd_(-1)
+{
+    size_ = scan(0, -1, Visitor());
+}
+
+RecordFile::~RecordFile()
+{
+    _close();
+}
+
+const std::string& RecordFile::filename() const
+{
+    return filename_;
+}
+
+long long RecordFile::size() const
+{
+    return size_;
+}
+
+bool RecordFile::append(char type, const std::string& payload, bool sync)
+{
+    if (payload.size() > MAX_PAYLOAD)
+    {
+        DEBUG(D_ERROR, "(RecordFile::append) Record of " << payload.size()
+              << " bytes too big for " << filename_ << ".");
+        return false;
+    }
+    if (!_open(false))
+    {
+        DEBUG(D_ERROR, "(RecordFile::append) Error opening " << filename_ << ".");
+        return false;
+    }
+
+    std::string record(1, type);
+    put32(record, payload.size());
+    put32(record, checksum(type, payload));
+    record += payload;
+
+    if (!writeAll(fd_, record.data(), record.size()) ||
+        (sync && ::fdatasync(fd_) != 0))
+    {
+        //the partial record is not left before the next ones
+        if (::ftruncate(fd_, size_) != 0)
+            _close();
+        DEBUG(D_ERROR, "(RecordFile::append) Error writing " << filename_ << ".");
+        return false;
+    }
+    size_ += record.size();
+    return true;
+}
+
+bool RecordFile::sync()
+{
+    return fd_ < 0 || ::fdatasync(fd_) == 0;
+}
+
+long long RecordFile::scan(long long from, long long to, const Visitor& visit) const
+{
+    std::ifstream in(filename_.c_str(), std::ios::in | std::ios::binary);
+    std::string magic(HEADER_SIZE, '\0');
+    if (!in.read(&magic[0], HEADER_SIZE) || magic != magic_)
+        return 0;
+
+    in.seekg(0, std::ios::end);
+    long long end = in.tellg();
+
+    long long pos = from > HEADER_SIZE ? from : HEADER_SIZE;
+    in.seekg(pos);
+    std::string payload;
+    char header[RECORD_HEADER_SIZE];
+    while ((to < 0 || pos < to) && in.read(header, sizeof(header)))
+    {
+        //a torn or corrupt length ends the records
+        unsigned int length = get32(header + 1);
+        if (length > MAX_PAYLOAD || pos + RECORD_HEADER_SIZE + length > end)
+            break;
+        payload.resize(length);
+        if (length && !in.read(&payload[0], length))
+            break;
+        if (get32(header + 5) != checksum(header[0], payload))
+            break;
+        if (visit)
+            visit(header[0], payload);
+        pos += RECORD_HEADER_SIZE + length;
+    }
+    return pos;
+}
+
+bool RecordFile::discard(long long upto)
+{
+    if (upto <= HEADER_SIZE || size_ == 0)
+        return true;
+
+    //the newer records are copied to a new file
+    std::string content = magic_;
+    if (upto < size_)
+    {
+        std::ifstream in(filename_.c_str(), std::ios::in | std::ios::binary);
+        in.seekg(upto);
+        std::string records(size_ - upto, '\0');
+        if (!in.read(&records[0], records.size()))
+            return false;
+        content += records;
+    }
+
+    std::string tmp = filename_ + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    bool ok = writeAll(fd, content.data(), content.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(tmp.c_str(), filename_.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        DEBUG(D_ERROR, "(RecordFile::discard) Error writing " << filename_ << ".");
+        return false;
+    }
+
+    _close();
+    size_ = content.size();
+    return true;
+}
+
+bool RecordFile::truncate()
+{
+    _close();
+    return _open(true);
+}
+
+bool RecordFile::remove()
+{
+    _close();
+    size_ = 0;
+    return std::remove(filename_.c_str()) == 0 || errno == ENOENT;
+}
+
+bool RecordFile::_open(bool truncate)
+{
+    if (fd_ >= 0)
+        return true;
+
+    fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0)
+        return false;
+
+    //a file with no records is only started over if it is empty or
+    //has (the beginning of) our magic, another kind of file is kept
+    if (!truncate && size_ == 0)
+    {
+        char header[HEADER_SIZE];
+        ssize_t n = ::pread(fd_, header, sizeof(header), 0);
+        if (n < 0 || magic_.compare(0, n, header, n) != 0)
+        {
+            DEBUG(D_ERROR, "(RecordFile::_open) " << filename_
+                  << " is not a file of this kind, it is not overwritten.");
+            _close();
+            return false;
+        }
+    }
+
+    //a record cut by a crash is dropped, and a new file started
+    if (truncate)
+        size_ = 0;
+    if (::ftruncate(fd_, size_) != 0 ||
+        (size_ == 0 && !writeAll(fd_, magic_.data(), magic_.size())))
+    {
+        _close();
+        return false;
+    }
+    if (size_ == 0)
+        size_ = HEADER_SIZE;
+    return true;
+}
+
+void RecordFile::_close()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = -1;
+}
@@ -0,0 +1,87 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef RECORDFILE_H
+#define RECORDFILE_H
+
+#include <boost/function.hpp>
+#include <string>
+
+///
+/// append-only record file
+///
+/// A file of records written by appending: an 8 byte magic, then for
+/// each record its type (1 byte), payload length and checksum (4
+/// bytes each, little endian) and the payload. Only the complete
+/// records are read, so a record cut by a crash is ignored, and it is
+/// dropped when the next one is appended. A file with another magic
+/// is never appended to.
+///
+class RecordFile
+{
+    // Do not copy
+    RecordFile(const RecordFile&);
+    RecordFile& operator=(const RecordFile&);
+
+public:
+    typedef boost::function<void (char type, const std::string& payload)> Visitor;
+
+    static const long long HEADER_SIZE = 8;
+    // bigger records are not written, and end the scan when read
+    static const unsigned int MAX_PAYLOAD = 64 * 1024 * 1024;
+
+    // magic: the first HEADER_SIZE bytes of the files of this kind
+    RecordFile(const std::string& filename, const char* magic);
+    ~RecordFile();
+
+    const std::string& filename() const;
+
+    // bytes of the complete records, 0 if there is no such file
+    long long size() const;
+
+    // appends a record, synced to disk if sync is set
+    bool append(char type, const std::string& payload, bool sync);
+    // syncs the records appended
+    bool sync();
+
+    // visits the complete records in [from, to) (to the end if to is
+    // -1), returns the end of the last one
+    long long scan(long long from, long long to, const Visitor&) const;
+
+    // drops the records before the offset
+    bool discard(long long upto);
+    // starts an empty file
+    bool truncate();
+    // removes the file
+    bool remove();
+
+private:
+    bool _open(bool truncate);
+    void _close();
+
+    std::string filename_;
+    std::string magic_;
+    int fd_;
+    long long size_;
+};
+
+#endif // RECORDFILE_H
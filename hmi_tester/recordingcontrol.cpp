@@ -40,9 +40,9 @@ RecordingControl::~RecordingControl()
 /// recording process control
 ///
 /// ///
-void RecordingControl::recordTestCase(DataModel::TestCase* tc)
+void RecordingControl::recordTestCase(DataModel::TestCase* tc, RecordingSpool* spool)
 {
-    itemManager_->recordTestCase(tc);
+    itemManager_->recordTestCase(tc, spool);
 }
 
 void RecordingControl::pauseRecording()
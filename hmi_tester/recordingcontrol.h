@@ -42,7 +42,7 @@ public:
     ~RecordingControl();
 
     ///recording process control
-    void recordTestCase(DataModel::TestCase*);
+    void recordTestCase(DataModel::TestCase*, RecordingSpool* spool = NULL);
     void pauseRecording();
     void resumeRecording();
     void stopRecording();
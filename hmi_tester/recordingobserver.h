@@ -28,8 +28,9 @@ class RecordingObserver
 {
     public:
 
-    //indicates that a test case recording has finished
-    virtual void testRecordingFinished(DataModel::TestCase*) = 0;
+    //indicates that a test case recording has finished. False if the
+    //test case could not be saved.
+    virtual bool testRecordingFinished(DataModel::TestCase*) = 0;
     //indicates the amount of test cases received
     //up to this moment
     virtual void testItemsReceivedCounter(int) = 0;
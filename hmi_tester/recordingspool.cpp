@@ -0,0 +1,190 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "recordingspool.h"
+#include <debug.h>
+
+#include <cstdio>
+#include <dirent.h>
+
+namespace
+{
+    const char MAGIC[] = { 'O', 'H', 'T', 'R', 'E', 'C', 'S', '1' };
+    const char SUFFIX[] = ".recording";
+
+    const char NAME_RECORD = 'N';
+    const char ITEM_RECORD = 'I';
+
+    // <suite>.<FNV-1a of the name>.recording
+    std::string spoolName(const std::string& suiteFile, const std::string& caseName)
+    {
+        unsigned int h = 2166136261u;
+        for (size_t i = 0; i < caseName.size(); i++)
+            h = (h ^ (unsigned char)caseName[i]) * 16777619u;
+        char hash[9];
+        std::sprintf(hash, "%08x", h);
+        return suiteFile + "." + hash + SUFFIX;
+    }
+
+    struct ReadSpool
+    {
+        DataModel::TestCase* tc;
+        Protocol::TestItemCodec::Dictionary* dictionary;
+        bool* named;
+        bool* ok;
+
+        void operator()(char type, const std::string& payload) const
+        {
+            if (type == NAME_RECORD)
+            {
+                tc->name(payload);
+                *named = true;
+            }
+            else if (type == ITEM_RECORD && *ok)
+            {
+                DataModel::TestItem ti;
+                if (Protocol::TestItemCodec::decode(payload.data(), payload.size(),
+                                                    *dictionary, ti))
+                    tc->takeTestItem(ti);
+                else
+                    *ok = false;
+            }
+        }
+    };
+
+    // reads the items of the spool into the case
+    bool readSpool(const RecordFile& file, DataModel::TestCase& tc, bool& named)
+    {
+        Protocol::TestItemCodec::Dictionary dictionary;
+        bool ok = true;
+        named = false;
+        ReadSpool read = { &tc, &dictionary, &named, &ok };
+        file.scan(0, -1, read);
+        if (!ok)
+        {
+            DEBUG(D_ERROR, "(RecordingSpool) Malformed item in " << file.filename() << ".");
+        }
+        return ok;
+    }
+}
+
+RecordingSpool::RecordingSpool(const std::string& suiteFile, const std::string& caseName,
+                               size_t tailSize, size_t syncItems)
+    : file_(spoolName(suiteFile, caseName), MAGIC), caseName_(caseName),
+      count_(0), tailSize_(tailSize), syncItems_(syncItems ? syncItems : 1)
+{
+    ok_ = file_.truncate() && file_.append(NAME_RECORD, caseName, true);
+    if (!ok_)
+    {
+        DEBUG(D_ERROR, "(RecordingSpool) Error creating " << file_.filename() << ".");
+    }
+}
+
+RecordingSpool::~RecordingSpool()
+{
+}
+
+bool RecordingSpool::ok() const
+{
+    return ok_;
+}
+
+const std::string& RecordingSpool::filename() const
+{
+    return file_.filename();
+}
+
+const std::string& RecordingSpool::caseName() const
+{
+    return caseName_;
+}
+
+bool RecordingSpool::append(const DataModel::TestItemPtr& ti)
+{
+    std::string payload;
+    Protocol::TestItemCodec::encode(*ti, dictionary_, payload);
+    if (!file_.append(ITEM_RECORD, payload, (count_ + 1) % syncItems_ == 0))
+    {
+        ok_ = false;
+        return false;
+    }
+    count_++;
+
+    tail_.push_back(ti);
+    if (tail_.size() > tailSize_)
+        tail_.pop_front();
+    return true;
+}
+
+size_t RecordingSpool::count() const
+{
+    return count_;
+}
+
+const std::deque<DataModel::TestItemPtr>& RecordingSpool::tail() const
+{
+    return tail_;
+}
+
+bool RecordingSpool::load(DataModel::TestCase& tc)
+{
+    tail_.clear();
+    bool named;
+    return readSpool(file_, tc, named) && tc.count() == count_;
+}
+
+void RecordingSpool::remove()
+{
+    file_.remove();
+}
+
+std::vector<std::string> RecordingSpool::find(const std::string& suiteFile)
+{
+    std::vector<std::string> files;
+
+    std::string::size_type slash = suiteFile.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : suiteFile.substr(0, slash + 1);
+    std::string prefix = (slash == std::string::npos ? suiteFile : suiteFile.substr(slash + 1)) + ".";
+    const size_t suffix = sizeof(SUFFIX) - 1;
+
+    DIR* d = ::opendir(dir.c_str());
+    if (!d)
+        return files;
+    while (struct dirent* e = ::readdir(d))
+    {
+        std::string name(e->d_name);
+        if (name.size() == prefix.size() + 8 + suffix &&
+            name.compare(0, prefix.size(), prefix) == 0 &&
+            name.compare(name.size() - suffix, suffix, SUFFIX) == 0)
+            files.push_back(slash == std::string::npos ? name : dir + name);
+    }
+    ::closedir(d);
+    return files;
+}
+
+bool RecordingSpool::recover(const std::string& filename, DataModel::TestCase& tc)
+{
+    RecordFile file(filename, MAGIC);
+    bool named;
+    return readSpool(file, tc, named) && named;
+}
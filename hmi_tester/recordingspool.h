@@ -0,0 +1,87 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef RECORDINGSPOOL_H
+#define RECORDINGSPOOL_H
+
+#include <datamodel.h>
+#include <recordfile.h>
+#include <testitemcodec.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+///
+/// recording spool
+///
+/// The items of the test case being recorded are appended to a file
+/// next to the suite (<suite>.<hash of the case name>.recording) as
+/// they arrive, and only the last ones are kept in memory. The file
+/// is synced every few items, and read into the test case when the
+/// recording finishes. The items are written with the wire codec and
+/// a dictionary of the whole file (see Protocol::TestItemCodec). A
+/// recording interrupted by a crash is left in its file, to be
+/// recovered when the suite is opened again.
+///
+class RecordingSpool
+{
+public:
+    // the spool of a case of the suite, started empty
+    RecordingSpool(const std::string& suiteFile, const std::string& caseName,
+                   size_t tailSize, size_t syncItems);
+    ~RecordingSpool();
+
+    // false if the file could not be written
+    bool ok() const;
+    const std::string& filename() const;
+    const std::string& caseName() const;
+
+    // appends the item and keeps it in the tail
+    bool append(const DataModel::TestItemPtr&);
+    size_t count() const;
+    // the last items appended
+    const std::deque<DataModel::TestItemPtr>& tail() const;
+
+    // moves the spooled items to the case, false if some can not be read
+    bool load(DataModel::TestCase&);
+    // removes the file, once the case is saved
+    void remove();
+
+    // the spool files left by interrupted recordings of the suite
+    static std::vector<std::string> find(const std::string& suiteFile);
+    // reads a spool file left by a crash: the name of the case and
+    // its items until the last complete one. False if it has no name
+    // or a malformed item.
+    static bool recover(const std::string& filename, DataModel::TestCase&);
+
+private:
+    RecordFile file_;
+    std::string caseName_;
+    bool ok_;
+    size_t count_;
+    size_t tailSize_;
+    size_t syncItems_;
+    Protocol::TestItemCodec::Dictionary dictionary_;
+    std::deque<DataModel::TestItemPtr> tail_;
+};
+
+#endif // RECORDINGSPOOL_H
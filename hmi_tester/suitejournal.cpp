@@ -0,0 +1,303 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "suitejournal.h"
+#include <debug.h>
+#include <compresseddatamodeladapter.h>
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+
+#include <cassert>
+#include <cstdio>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace
+{
+    const char MAGIC[] = { 'O', 'H', 'T', 'J', 'R', 'N', 'L', '1' };
+
+    const char ADD_RECORD = 'A';
+    const char DELETE_RECORD = 'D';
+
+    // the payload starts with the name of the test case
+    std::string namePayload(const std::string& name)
+    {
+        std::string payload;
+        unsigned int length = name.size();
+        for (int i = 0; i < 4; i++)
+            payload += char((length >> (8 * i)) & 0xff);
+        return payload + name;
+    }
+
+    std::string nameOf(const std::string& payload)
+    {
+        if (payload.size() < 4)
+            return std::string();
+        size_t length = 0;
+        for (int i = 0; i < 4; i++)
+            length |= size_t((unsigned char)payload[i]) << (8 * i);
+        return payload.substr(4, length);
+    }
+
+    struct ReplayRecord
+    {
+        DataModel::TestSuite* ts;
+        size_t* count;
+
+        void operator()(char type, const std::string& payload) const
+        {
+            std::string name = nameOf(payload);
+            if (type == ADD_RECORD)
+            {
+                std::auto_ptr<DataModel::TestCase> tc(new DataModel::TestCase());
+                try
+                {
+                    std::istringstream iss(payload.substr(4 + name.size()));
+                    boost::archive::binary_iarchive ia(iss);
+                    ia >> *tc;
+                }
+                catch (boost::archive::archive_exception& e)
+                {
+                    DEBUG(D_ERROR, "(SuiteJournal::replay) TestCase " << name
+                          << " not read: " << e.what());
+                    return;
+                }
+                if (ts->existsTestCase(name))
+                    ts->deleteTestCase(name);
+                ts->addTestCase(tc.release());
+            }
+            else if (type == DELETE_RECORD)
+            {
+                if (ts->existsTestCase(name))
+                    ts->deleteTestCase(name);
+            }
+            else
+                return;
+            ++*count;
+        }
+    };
+
+    struct CollectName
+    {
+        std::set<std::string>* names;
+
+        void operator()(char, const std::string& payload) const
+        {
+            names->insert(nameOf(payload));
+        }
+    };
+}
+
+/// ///
+///
+/// SuiteJournal
+///
+/// ///
+
+SuiteJournal::SuiteJournal(const std::string& suiteFile)
+    : suiteFile_(suiteFile), file_(suiteFile + ".journal", MAGIC)
+{
+}
+
+SuiteJournal::~SuiteJournal()
+{
+}
+
+const std::string& SuiteJournal::suiteFile() const
+{
+    return suiteFile_;
+}
+
+const std::string& SuiteJournal::filename() const
+{
+    return file_.filename();
+}
+
+bool SuiteJournal::addTestCase(const DataModel::TestCase& tc)
+{
+    std::string payload = namePayload(tc.name());
+    {
+        std::ostringstream oss;
+        boost::archive::binary_oarchive oa(oss);
+        oa << tc;
+        payload += oss.str();
+    }
+    return file_.append(ADD_RECORD, payload, true);
+}
+
+bool SuiteJournal::deleteTestCase(const std::string& name)
+{
+    return file_.append(DELETE_RECORD, namePayload(name), true);
+}
+
+size_t SuiteJournal::replay(DataModel::TestSuite& ts, long long upto) const
+{
+    size_t count = 0;
+    ReplayRecord replay = { &ts, &count };
+    file_.scan(0, upto, replay);
+    if (count)
+    {
+        DEBUG(D_BOTH, "(SuiteJournal::replay) " << count << " records applied from "
+              << filename() << ".");
+    }
+    return count;
+}
+
+long long SuiteJournal::size() const
+{
+    return file_.size();
+}
+
+bool SuiteJournal::compactable(double ratio, long long minimum) const
+{
+    struct stat st;
+    if (size() < minimum || ::stat(suiteFile_.c_str(), &st) != 0)
+        return false;
+    return size() > ratio * st.st_size;
+}
+
+std::set<std::string> SuiteJournal::changedSince(long long offset) const
+{
+    std::set<std::string> names;
+    CollectName collect = { &names };
+    file_.scan(offset, size(), collect);
+    return names;
+}
+
+bool SuiteJournal::discard(long long upto)
+{
+    return file_.discard(upto);
+}
+
+bool SuiteJournal::clear()
+{
+    return file_.remove();
+}
+
+/// ///
+///
+/// SuiteCompaction
+///
+/// ///
+
+// the compacted suite is written next to the suite file, keeping its
+// compression suffix so the adapter compresses it the same way
+static std::string compactFileName(const std::string& suiteFile)
+{
+    std::string plain = CompressedDataModelAdapter::plainName(suiteFile);
+    return plain + ".compact" + suiteFile.substr(plain.size());
+}
+
+SuiteCompaction::SuiteCompaction(DataModelAdapter* adapter, const std::string& suiteFile,
+                                 long long journalSize, bool lazy)
+    : adapter_(adapter), suiteFile_(suiteFile),
+      compactFile_(compactFileName(suiteFile)),
+      journalSize_(journalSize), lazy_(lazy), ok_(false)
+{
+}
+
+SuiteCompaction::~SuiteCompaction()
+{
+}
+
+void SuiteCompaction::operator()()
+{
+    try
+    {
+        if (lazy_)
+            result_.reset(adapter_->file2lazyTestSuite(suiteFile_));
+        else
+            result_.reset(adapter_->file2testSuite(suiteFile_));
+
+        SuiteJournal(suiteFile_).replay(*result_, journalSize_);
+
+        if (lazy_)
+            adapter_->lazyTestSuite2file(*result_, compactFile_);
+        else
+            adapter_->testSuite2file(*result_, compactFile_);
+        ok_ = true;
+    }
+    //the compaction runs in its own thread: nothing may escape it
+    catch (DataModelAdapter::conversion_error_exception&)
+    {
+        DEBUG(D_ERROR, "(SuiteCompaction) Error compacting " << suiteFile_ << ".");
+        std::remove(compactFile_.c_str());
+    }
+    catch (std::exception& e)
+    {
+        DEBUG(D_ERROR, "(SuiteCompaction) Error compacting " << suiteFile_ << ": " << e.what());
+        std::remove(compactFile_.c_str());
+    }
+    catch (...)
+    {
+        DEBUG(D_ERROR, "(SuiteCompaction) Unknown error compacting " << suiteFile_ << ".");
+        std::remove(compactFile_.c_str());
+    }
+}
+
+bool SuiteCompaction::ok() const
+{
+    return ok_;
+}
+
+const std::string& SuiteCompaction::suiteFile() const
+{
+    return suiteFile_;
+}
+
+long long SuiteCompaction::journalSize() const
+{
+    return journalSize_;
+}
+
+DataModel::TestSuite* SuiteCompaction::result() const
+{
+    return result_.get();
+}
+
+bool SuiteCompaction::commit(SuiteJournal& journal)
+{
+    assert(journal.suiteFile() == suiteFile_);
+    if (!ok_)
+        return false;
+    ok_ = false;
+
+    //the records are still in the journal if it stops here: replaying
+    //them again on the new file gives the same suite
+    if (std::rename(compactFile_.c_str(), suiteFile_.c_str()) != 0)
+    {
+        DEBUG(D_ERROR, "(SuiteCompaction::commit) Error renaming " << compactFile_ << ".");
+        abort();
+        return false;
+    }
+    journal.discard(journalSize_);
+    DEBUG(D_BOTH, "(SuiteCompaction::commit) Journal compacted into " << suiteFile_ << ".");
+    return true;
+}
+
+void SuiteCompaction::abort()
+{
+    ok_ = false;
+    std::remove(compactFile_.c_str());
+}
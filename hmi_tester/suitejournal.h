@@ -0,0 +1,128 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef SUITEJOURNAL_H
+#define SUITEJOURNAL_H
+
+#include <datamodel.h>
+#include <datamodeladapter.h>
+#include <recordfile.h>
+#include <memory>
+#include <set>
+#include <string>
+
+///
+/// test suite journal
+///
+/// The test cases recorded or deleted after the suite file was
+/// written are appended to a journal next to it (<suite>.journal)
+/// instead of rewriting the whole suite. Each record is synced to
+/// disk before the call returns, and a record cut by a crash is
+/// ignored when the journal is read (see RecordFile).
+///
+/// The payload of the records is the name of the test case and, for
+/// the added ones, the case as a boost binary archive.
+/// An added case replaces the one with the same name, so replaying
+/// records already in the suite file gives the same suite.
+///
+class SuiteJournal
+{
+    // Do not copy
+    SuiteJournal(const SuiteJournal&);
+    SuiteJournal& operator=(const SuiteJournal&);
+
+public:
+    explicit SuiteJournal(const std::string& suiteFile);
+    ~SuiteJournal();
+
+    const std::string& suiteFile() const;
+    const std::string& filename() const;
+
+    // appends a record, false if it could not be written
+    bool addTestCase(const DataModel::TestCase&);
+    bool deleteTestCase(const std::string& name);
+
+    // applies the records before the offset (all if -1) to the suite
+    // read from the suite file, returns how many were applied
+    size_t replay(DataModel::TestSuite&, long long upto = -1) const;
+
+    // bytes of the complete records, 0 if there is no journal
+    long long size() const;
+    // whether the journal has at least minimum bytes and is larger
+    // than this fraction of the suite file
+    bool compactable(double ratio, long long minimum) const;
+    // names of the test cases changed by the records after the offset
+    std::set<std::string> changedSince(long long offset) const;
+
+    // drops the records before the offset, they have been written to
+    // the suite file
+    bool discard(long long upto);
+    // drops all the records
+    bool clear();
+
+private:
+    std::string suiteFile_;
+    RecordFile file_;
+};
+
+///
+/// journal compaction
+///
+/// Writes the suite file and its journal to a new suite file
+/// (<suite>.compact), to be run in its own thread: it reads the
+/// files with its own adapter calls and does not touch the suite in
+/// use. commit() renames the new file over the suite file and drops
+/// the compacted records; it is called from the thread that appends
+/// to the journal.
+///
+class SuiteCompaction
+{
+public:
+    SuiteCompaction(DataModelAdapter*, const std::string& suiteFile,
+                    long long journalSize, bool lazy);
+    ~SuiteCompaction();
+
+    void operator()();
+
+    bool ok() const;
+    const std::string& suiteFile() const;
+    // journal bytes written to the new file
+    long long journalSize() const;
+    // the compacted suite. The lazy cases are read from the new file,
+    // also after it is renamed.
+    DataModel::TestSuite* result() const;
+
+    bool commit(SuiteJournal&);
+    // removes the new file if it was not committed
+    void abort();
+
+private:
+    DataModelAdapter* adapter_;
+    std::string suiteFile_;
+    std::string compactFile_;
+    long long journalSize_;
+    bool lazy_;
+    bool ok_;
+    std::auto_ptr<DataModel::TestSuite> result_;
+};
+
+#endif // SUITEJOURNAL_H
@@ -0,0 +1,189 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+
+#include "commthread.h"
+#include <ohtbaseconfig.h>
+#include <debug.h>
+#include <QMetaType>
+#include <cassert>
+
+CommThread::CommThread(const Transport::Endpoint& endpoint)
+    : endpoint_(endpoint), comm_(0), queue_(SEND_QUEUE_SIZE), flushScheduled_(0),
+      overflow_(false), dropped_(0)
+{
+    //the received items reach the GUI thread through queued connections
+    qRegisterMetaType<DataModel::TestItemPtr>("DataModel::TestItemPtr");
+
+    //the comm exists before it connects, so its signals can be
+    //connected before the first frame arrives
+    comm_ = new Comm(endpoint_, false);
+    comm_->moveToThread(&thread_);
+    moveToThread(&thread_);
+}
+
+CommThread::~CommThread()
+{
+    stopComm();
+    //never started
+    delete comm_;
+}
+
+///
+/// control (caller thread)
+///
+bool CommThread::startComm()
+{
+    thread_.start();
+
+    bool ok = false;
+    QMetaObject::invokeMethod(this, "_start", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok));
+    return ok;
+}
+
+void CommThread::stopComm()
+{
+    if (!thread_.isRunning())
+        return;
+
+    QMetaObject::invokeMethod(this, "_stop", Qt::BlockingQueuedConnection);
+    thread_.quit();
+    thread_.wait();
+}
+
+Comm* CommThread::comm()
+{
+    return comm_;
+}
+
+///
+/// sending (producer thread)
+///
+void CommThread::handleSendTestItem(const DataModel::TestItem& ti)
+{
+    handleSendTestItem(ti, 0);
+}
+
+void CommThread::handleSendTestItem(const DataModel::TestItem& ti, uint sequence)
+{
+    QueuedItem qi;
+    qi.item = new DataModel::TestItem(ti);
+    qi.sequence = sequence;
+    _push(qi);
+}
+
+void CommThread::handleTakeTestItem(DataModel::TestItem* ti)
+{
+    QueuedItem qi;
+    qi.item = new DataModel::TestItem();
+    qi.item->take(ti);
+    qi.sequence = 0;
+    _push(qi);
+}
+
+void CommThread::_push(const QueuedItem& qi)
+{
+    bool pushed = queue_.push(qi);
+
+    //a full queue means the I/O thread is behind: it is given a
+    //moment to catch up, but the application is never blocked for
+    //longer, a stalled connection only loses items
+    if (!pushed && !overflow_)
+    {
+        _scheduleFlush();
+        boost::system_time deadline = boost::get_system_time() +
+                boost::posix_time::milliseconds(SEND_QUEUE_WAIT);
+        boost::unique_lock<boost::mutex> lock(roomMutex_);
+        while (!(pushed = queue_.push(qi)) &&
+               room_.timed_wait(lock, deadline))
+            ;
+        if (!pushed)
+        {
+            overflow_ = true;
+            DEBUG(D_ERROR, "(CommThread::_push) Send queue full, dropping items.");
+        }
+    }
+
+    if (!pushed)
+    {
+        delete qi.item;
+        dropped_++;
+    }
+    else if (overflow_)
+    {
+        overflow_ = false;
+        DEBUG(D_ERROR, "(CommThread::_push) Send queue available again, "
+              << dropped_ << " items dropped.");
+        dropped_ = 0;
+    }
+    _scheduleFlush();
+}
+
+void CommThread::_scheduleFlush()
+{
+    //only the first item after a flush posts a new one
+    if (flushScheduled_.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "_flush", Qt::QueuedConnection);
+}
+
+///
+/// I/O thread
+///
+bool CommThread::_start()
+{
+    DEBUG(D_COMM, "(CommThread::_start) Starting comm on " << endpoint_.toString());
+    return comm_ && comm_->resetAndStart();
+}
+
+void CommThread::_stop()
+{
+    _flush();
+    if (comm_)
+    {
+        comm_->stop();
+        delete comm_;
+        comm_ = 0;
+    }
+    DEBUG(D_COMM, "(CommThread::_stop) Comm stopped.");
+}
+
+void CommThread::_flush()
+{
+    //cleared before draining, so the items pushed meanwhile
+    //schedule a new flush
+    flushScheduled_.fetchAndStoreOrdered(0);
+
+    QueuedItem qi;
+    while (queue_.pop(qi))
+    {
+        //the producer may be waiting for room
+        {
+            boost::lock_guard<boost::mutex> lock(roomMutex_);
+        }
+        room_.notify_one();
+
+        if (comm_)
+            comm_->handleSendTestItem(*qi.item, qi.sequence);
+        delete qi.item;
+    }
+}
@@ -0,0 +1,115 @@
+// -*- mode: c++; c-basic-offset: 4; c-basic-style: bsd; -*-
+/*
+ *   This program is free software; you can redistribute it and/or
+ *   modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 3.0 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *   02111-1307 USA
+ *
+ *   This file is part of the Open-HMI Tester,
+ *   http://openhmitester.sourceforge.net
+ *
+ */
+#ifndef COMMTHREAD_H
+#define COMMTHREAD_H
+
+#include <comm.h>
+#include <transport.h>
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+///
+/// Comm running in its own thread
+///
+/// The items sent from the GUI thread are copied (or moved, with
+/// handleTakeTestItem) into a lock-free queue, and the I/O thread
+/// encodes and writes them, so capturing an event does not wait for
+/// the connection. Only one thread may send items (single producer).
+///
+class CommThread : public QObject
+{
+    Q_OBJECT
+
+public:
+    CommThread(const Transport::Endpoint& endpoint);
+    ~CommThread();
+
+    ///
+    /// starts the thread and connects, waiting for the result. The
+    /// comm signals must be connected before, the frames received
+    /// right after connecting are emitted at once.
+    ///
+    bool startComm();
+
+    ///
+    /// sends the queued items and stops the thread
+    ///
+    void stopComm();
+
+    ///
+    /// the comm, living in the I/O thread (0 once stopped). Its signals
+    /// reach the objects of other threads through queued connections.
+    ///
+    Comm* comm();
+
+public slots:
+    ///
+    /// queues an item for sending (connect with Qt::DirectConnection)
+    ///
+    void handleSendTestItem(const DataModel::TestItem&);
+    void handleSendTestItem(const DataModel::TestItem&, uint sequence);
+    ///
+    /// queues an item moving its data (TestItem::take), for the
+    /// items discarded after sending
+    ///
+    void handleTakeTestItem(DataModel::TestItem*);
+
+private slots:
+    ///
+    /// I/O thread methods
+    ///
+    bool _start();
+    void _stop();
+    void _flush();
+
+private:
+    typedef struct
+    {
+        DataModel::TestItem* item;
+        uint sequence;
+    } QueuedItem;
+
+    void _push(const QueuedItem&);
+    void _scheduleFlush();
+
+    Transport::Endpoint endpoint_;
+    QThread thread_;
+    Comm* comm_;
+
+    boost::lockfree::spsc_queue<QueuedItem> queue_;
+    // 1 while a flush is posted to the I/O thread
+    QAtomicInt flushScheduled_;
+
+    // a full queue is waited for once, with a bound; until it has
+    // room again the new items are dropped (producer thread only)
+    boost::mutex roomMutex_;
+    boost::condition_variable room_;
+    bool overflow_;
+    unsigned long dropped_;
+};
+
+#endif // COMMTHREAD_H
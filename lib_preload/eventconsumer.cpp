@@ -30,5 +30,5 @@ EventConsumer::EventConsumer()
 
 void EventConsumer::sendNewTestItem(DataModel::TestItem& ti)
 {
-    emit newTestItem(ti);
+    emit newTestItem(&ti);
 }
@@ -58,9 +58,10 @@ private:
 signals:
 
     ///
+    /// the item only lives during the emission, and the receiver
+    /// may take its data (connect with Qt::DirectConnection)
     ///
-    ///
-    void newTestItem(const DataModel::TestItem&);
+    void newTestItem(DataModel::TestItem*);
 };
 
 #endif // EVENTCONSUMER_H
@@ -35,7 +35,9 @@ public:
     virtual void install() = 0;
 
     ///
-    /// this method is called when a new testItem arrives
+    /// this method is called when a new testItem arrives. The
+    /// executor may take its data (TestItem::take), the item is
+    /// discarded afterwards.
     ///
     virtual void handleNewTestItemReceived(DataModel::TestItem*) = 0;
 
@@ -7,10 +7,12 @@ DEPENDPATH += $$PWD
 ###
 
 SOURCES += preloadcontroller.cpp \
+    commthread.cpp \
     eventconsumer.cpp \
     preloadingcontrol.cpp
 
 HEADERS += preloadcontroller.h \
+    commthread.h \
     LibPreload_global.h \
     eventconsumer.h \
     eventexecutor.h \
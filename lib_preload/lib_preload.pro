@@ -40,18 +40,30 @@ equals(QT_MAJOR_VERSION, 5) {
     INCLUDEPATH += ../common/
 
     SOURCES += ../common/datamodel.cpp \
+               ../common/stringpool.cpp \
                ../common/comm.cpp \
                ../common/messageclientserver.cpp \
                ../common/utilclasses.cpp \
                ../common/uuid.cpp \
-               ../common/controlsignaling.cpp
+               ../common/controlsignaling.cpp \
+               ../common/protocol.cpp \
+               ../common/testitemcodec.cpp \
+               ../common/transport.cpp \
+               ../common/sockettransport.cpp \
+               ../common/shmtransport.cpp
 
     HEADERS += ../common/datamodel.h \
+               ../common/stringpool.h \
                ../common/comm.h \
                ../common/messageclientserver.h \
                ../common/utilclasses.h \
                ../common/uuid.h \
                ../common/controlsignaling.h \
+               ../common/protocol.h \
+               ../common/testitemcodec.h \
+               ../common/transport.h \
+               ../common/sockettransport.h \
+               ../common/shmtransport.h \
                ../common/ohtbaseconfig.h \
                ../common/debug.h
 }
@@ -61,16 +73,18 @@ equals(QT_MAJOR_VERSION, 5) {
 ###
 
 SOURCES += preloadcontroller.cpp \
+    commthread.cpp \
     eventconsumer.cpp \
     preloadingcontrol.cpp
 
 HEADERS += preloadcontroller.h \
+    commthread.h \
     LibPreload_global.h \
     eventconsumer.h \
     eventexecutor.h \
     preloadingcontrol.h
 
-LIBS += -lboost_serialization
+LIBS += -lboost_thread -lboost_system -lboost_serialization
 
 OTHER_FILES += \
     lib_preload.pri
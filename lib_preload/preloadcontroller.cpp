@@ -30,12 +30,16 @@ PreloadController::PreloadController(PreloadingControl* pc, EventConsumer *ec, E
 {
     _ev_consumer = ec;
     _ev_executor = ex;
+    _comm = NULL;
+    executing_ = false;
 }
 
 PreloadController::~PreloadController()
 {
+    clearPending();
+
     if (_comm != NULL){
-        _comm->stop();
+        _comm->stopComm();
         delete _comm;
     }
 }
@@ -45,35 +49,47 @@ PreloadController::~PreloadController()
 ///
 bool PreloadController::initialize()
 {
-    //create and start comm
-    _comm = new Comm(TCP_PORT, false);
-    _comm->resetAndStart();
-
-    //install consumer
-    _ev_consumer->install();
-
-    //install executor
-    _ev_executor->install();
+    //create comm, in its own thread so sending the captured items
+    //does not stall the application
+    _comm = new CommThread(Transport::Endpoint::fromEnvironment());
 
     ///
     /// signals connection
     ///
 
-    //signals between comm and preloadController
+    //signals between comm and preloadController, connected before the
+    //comm connects: the server sends its pending items right away.
+    //The items are sent through the comm thread queue, from this
+    //thread only.
     connect(this, SIGNAL(sendTestItem(const DataModel::TestItem&)),
-            _comm, SLOT(handleSendTestItem (const DataModel::TestItem&)));
-    connect(_comm, SIGNAL(receivedTestItem (DataModel::TestItem*)),
-            this, SLOT(handleReceivedTestItem (DataModel::TestItem*)));
+            _comm, SLOT(handleSendTestItem (const DataModel::TestItem&)),
+            Qt::DirectConnection);
+    connect(_comm->comm(), SIGNAL(receivedTestItem (DataModel::TestItemPtr, uint, int)),
+            this, SLOT(handleReceivedTestItem (DataModel::TestItemPtr, uint)));
 
     //signals between eventConsumer and comm
-    connect(_ev_consumer, SIGNAL(newTestItem(const DataModel::TestItem&)),
-            _comm, SLOT(handleSendTestItem(const DataModel::TestItem&)));
+    connect(_ev_consumer, SIGNAL(newTestItem(DataModel::TestItem*)),
+            _comm, SLOT(handleTakeTestItem(DataModel::TestItem*)),
+            Qt::DirectConnection);
 
     ///
     /// process state control
     ///
     state_ = STOP;
 
+    //start comm
+    if (!_comm->startComm())
+    {
+        DEBUG(D_ERROR, "(PreloadController::initialize) Unable to connect to the HMI Tester.");
+        return false;
+    }
+
+    //install consumer
+    _ev_consumer->install();
+
+    //install executor
+    _ev_executor->install();
+
     return true;
 }
 
@@ -88,34 +104,64 @@ PreloadController::ProcessState PreloadController::state() const
 ///
 ///input method (comm signal handle)
 ///
-void PreloadController::handleReceivedTestItem (DataModel::TestItem* ti)
+void PreloadController::handleReceivedTestItem (DataModel::TestItemPtr ti, uint sequence)
 {
     DEBUG(D_PRELOAD, "(PreloadController::handleReceivedTestItem)");
     //if it is a control item...
     if (ti->type() == Control::CTI_TYPE)
     {
-        handleReceivedControl(static_cast<Control::ControlTestItem*>(ti));
+        handleReceivedControl(static_cast<Control::ControlTestItem*>(ti.get()));
         DEBUG(D_PRELOAD, "(PreloadController::handleReceivedTestItem) Control event handled.");
     }
     //if not...
     else
     {
-        //if play process is enabled redirect the event
+        //if play process is enabled queue the event
         if (state() == PLAY)
         {
-            _ev_executor->handleNewTestItemReceived(ti);
-            //TODO delete the item here????
-            DEBUG(D_PRELOAD, "(PreloadController::handleReceivedTestItem) Event handled. Type = "
-                  << ti->type() << " Subtype = " << ti->subtype());
-
-            //and send a control event to synchronize the process
-            Control::CTI_EventExecuted cti;
-            _comm->handleSendTestItem(cti);
-            DEBUG(D_PRELOAD, "(PreloadController::handleReceivedTestItem) Event executed notified.");
+            pending_.push_back(std::make_pair(ti, sequence));
+            executePending();
         }
     }
 }
 
+///
+///executes the queued items in order
+///
+void PreloadController::executePending()
+{
+    //the executor may run a nested event loop. The items received
+    //meanwhile are queued and executed by the outer call.
+    if (executing_)
+        return;
+    executing_ = true;
+
+    while (!pending_.empty() && state() == PLAY)
+    {
+        std::pair<DataModel::TestItemPtr, uint> item = pending_.front();
+        pending_.pop_front();
+
+        //the executor takes the data of the item, which is released
+        //at the end of the iteration
+        _ev_executor->handleNewTestItemReceived(item.first.get());
+        DEBUG(D_PRELOAD, "(PreloadController::executePending) Event handled. Type = "
+              << item.first->type() << " Subtype = " << item.first->subtype());
+
+        //and ack the item to synchronize the process
+        Control::CTI_EventExecuted cti;
+        _comm->handleSendTestItem(cti, item.second);
+        DEBUG(D_PRELOAD, "(PreloadController::executePending) Event "
+              << item.second << " executed notified.");
+    }
+
+    executing_ = false;
+}
+
+void PreloadController::clearPending()
+{
+    pending_.clear();
+}
+
 ///
 ///input method (control signaling)
 ///
@@ -139,6 +185,8 @@ void PreloadController::handleReceivedControl (Control::ControlTestItem* cti)
     {
         state_ = STOP;
         DEBUG(D_PRELOAD, "(PreloadController::handleReceivedControl) STATE: Stop playback.");
+        //the items in flight are discarded
+        clearPending();
         execution_stop();
     }
     //const int CTI_PAUSE_PLAYBACK = 13;
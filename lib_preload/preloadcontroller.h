@@ -25,11 +25,12 @@
 
 #include <LibPreload_global.h>
 #include <preloadingcontrol.h>
-#include <comm.h>
+#include <commthread.h>
 #include <controlsignaling.h>
 #include <eventconsumer.h>
 #include <eventexecutor.h>
 #include <QObject>
+#include <deque>
 
 class LIBPRELOADSHARED_EXPORT PreloadController : public QObject
 {
@@ -61,7 +62,7 @@ public:
 
 public slots:
     //input method (comm signal handle)
-    void handleReceivedTestItem (DataModel::TestItem*);
+    void handleReceivedTestItem (DataModel::TestItemPtr, uint sequence);
 
     //input method (control signaling)
     void handleReceivedControl (Control::ControlTestItem*);
@@ -82,8 +83,18 @@ private:
     void execution_stop();
     ProcessState state_;
 
+    ///
+    ///playback queue
+    ///
+    void executePending();
+    void clearPending();
+    //items received and not executed yet, with their sequence number
+    std::deque<std::pair<DataModel::TestItemPtr, uint> > pending_;
+    //true while an item is being executed
+    bool executing_;
+
 private:
-    Comm* _comm;
+    CommThread* _comm;
     EventConsumer* _ev_consumer;
     EventExecutor* _ev_executor;
 };
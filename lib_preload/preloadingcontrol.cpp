@@ -43,6 +43,10 @@ void PreloadingControl::initPreload()
 {
     //create a new Preload Controller
     PreloadController *pc = new PreloadController(this,_event_consumer,_event_executor);
-    pc->initialize();
+    if (!pc->initialize())
+    {
+        DEBUG(D_ERROR,"(PreloadingControl::initPreload) Preload Controller not initialized, the application is not tested.");
+        return;
+    }
     DEBUG(D_PRELOAD,"(PreloadingControl::initPreload) Preload Controller instance initiallized.");
 }
@@ -44,7 +44,8 @@ std::string LinuxPreloadingAction::libPreloadPath()
 bool LinuxPreloadingAction::launchApplication ( const std::string &binaryPath,
                                                 const std::string &preloadLibraryPath,
                                                 const std::string &outputFile,
-                                                const std::string &errorFile) throw (bin_error_exception, lib_error_exception)
+                                                const std::string &errorFile,
+                                                const Environment &environment) throw (bin_error_exception, lib_error_exception)
 {
     //checking if the binary exists
     if ( !QtUtils::isExecutable ( QString (binaryPath.c_str()) ) )
@@ -75,6 +76,9 @@ bool LinuxPreloadingAction::launchApplication ( const std::string &binaryPath,
     //setting preloading environment for the process
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert(PRELOAD_ENVVAR, QString(preloadLibraryPath.c_str()));
+    Environment::const_iterator it;
+    for (it = environment.begin(); it != environment.end(); ++it)
+        env.insert(QString(it->first.c_str()), QString(it->second.c_str()));
     //env.insert(PRELOAD_ENVVAR, "/home/pedro/svn_catedra/anotaciones/testing/imp_HMITester_github/openhmitester/build/qt_linux_lib_preload/libOHTPreload.so");
     process_->setProcessEnvironment(env);
 
@@ -90,6 +94,8 @@ bool LinuxPreloadingAction::launchApplication ( const std::string &binaryPath,
     //DEBUG(D_PRELOAD," - envvar = " << envvar.toStdString());
     DEBUG(D_PRELOAD," - outputFile = " << outputFile);
     DEBUG(D_PRELOAD," - errorFile = " << errorFile);
+    for (it = environment.begin(); it != environment.end(); ++it)
+        DEBUG(D_PRELOAD," - " << it->first << " = " << it->second);
     DEBUG(D_PRELOAD,"==========================================");
 
     //process execution
@@ -48,7 +48,8 @@ public:
     virtual bool launchApplication ( const std::string &binaryPath,
                                      const std::string &preloadLibraryPath,
                                      const std::string &outputFile,
-                                     const std::string &errorFile) throw (bin_error_exception, lib_error_exception);
+                                     const std::string &errorFile,
+                                     const Environment &environment) throw (bin_error_exception, lib_error_exception);
     virtual bool stopApplication ();
 
 private slots:
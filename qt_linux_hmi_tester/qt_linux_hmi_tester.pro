@@ -19,18 +19,30 @@ equals(QT_MAJOR_VERSION, 5) {
     INCLUDEPATH += ../common/
 
     SOURCES += ../common/datamodel.cpp \
+               ../common/stringpool.cpp \
                ../common/comm.cpp \
                ../common/messageclientserver.cpp \
                ../common/utilclasses.cpp \
                ../common/uuid.cpp \
-               ../common/controlsignaling.cpp
+               ../common/controlsignaling.cpp \
+               ../common/protocol.cpp \
+               ../common/testitemcodec.cpp \
+               ../common/transport.cpp \
+               ../common/sockettransport.cpp \
+               ../common/shmtransport.cpp
 
     HEADERS += ../common/datamodel.h \
+               ../common/stringpool.h \
                ../common/comm.h \
                ../common/messageclientserver.h \
                ../common/utilclasses.h \
                ../common/uuid.h \
                ../common/controlsignaling.h \
+               ../common/protocol.h \
+               ../common/testitemcodec.h \
+               ../common/transport.h \
+               ../common/sockettransport.h \
+               ../common/shmtransport.h \
                ../common/ohtbaseconfig.h \
                ../common/debug.h
 }
@@ -59,7 +71,13 @@ equals(QT_MAJOR_VERSION, 5) {
         ../hmi_tester/executionthread.cpp \
         ../hmi_tester/itemmanager.cpp \
         ../hmi_tester/newtsdialog.cpp \
-        ../hmi_tester/newtcdialog.cpp
+        ../hmi_tester/newtcdialog.cpp \
+        ../hmi_tester/suitejournal.cpp \
+        ../hmi_tester/recordfile.cpp \
+        ../hmi_tester/recordingspool.cpp \
+        ../hmi_tester/binarydatamodeladapter.cpp \
+        ../hmi_tester/caseworkers.cpp \
+        ../hmi_tester/compresseddatamodeladapter.cpp
 
     HEADERS += ../hmi_tester/hmitestercontrol.h \
         ../hmi_tester/executionobserver.h \
@@ -75,7 +93,13 @@ equals(QT_MAJOR_VERSION, 5) {
         ../hmi_tester/newtcdialog.h \
         ../hmi_tester/executionobserver.h \
         ../hmi_tester/recordingobserver.h \
-        ../hmi_tester/exceptions.h
+        ../hmi_tester/exceptions.h \
+        ../hmi_tester/suitejournal.h \
+        ../hmi_tester/recordfile.h \
+        ../hmi_tester/recordingspool.h \
+        ../hmi_tester/binarydatamodeladapter.h \
+        ../hmi_tester/caseworkers.h \
+        ../hmi_tester/compresseddatamodeladapter.h
 
     SOURCES += ../hmi_tester/qtutils.cpp
     HEADERS += ../hmi_tester/qtutils.h
@@ -84,7 +108,7 @@ equals(QT_MAJOR_VERSION, 5) {
         ../hmi_tester/newtsdialog.ui \
         ../hmi_tester/newtcdialog.ui
 
-    LIBS += -lboost_thread -lboost_system -lboost_serialization
+    LIBS += -lboost_thread -lboost_system -lboost_serialization -lz
 
     RESOURCES += ../hmi_tester/resources.qrc
 }
@@ -23,11 +23,22 @@
 
 #include "xmldatamodeladapter.h"
 
-#include <QDomDocument>
+#include <QBuffer>
 #include <QFile>
+#include <QXmlStreamReader>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast/try_lexical_convert.hpp>
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <debug.h>
+#include <ohtbaseconfig.h>
 
 XMLDataModelAdapter::XMLDataModelAdapter()
 {
@@ -41,6 +52,12 @@ std::string XMLDataModelAdapter::id()
     return "XMLDA";
 }
 
+///
+std::string XMLDataModelAdapter::extension()
+{
+    return OHT_FILE_EXTENSION;
+}
+
 
 /// ///
 /// xml names
@@ -58,16 +75,22 @@ const QString TI_SUBTYPE = "subtype";
 const QString TI_TIMESTAMP = "timestamp";
 const QString KEY = "key";
 const QString VALUE = "value";
+const QString TYPE = "type";
+
+// data types (the data without one is read as in the older files)
+const QString INT_DATA = "int";
+const QString DOUBLE_DATA = "double";
+const QString BOOL_DATA = "bool";
+const QString STRING_DATA = "string";
+const QString IDENTIFIER_DATA = "identifier";
+const QString UNTYPED_DATA = "text";
 
 /// ///
-/// xml tags
+/// xml tags (to find the elements in the raw file)
 /// ///
 
 const QString BEGo = "<";
 const QString BEGc = "</";
-const QString ENDo = ">";
-const QString ENDc = ">\n";
-const QString ENDs = "/>\n";
 
 /// ///
 ///
@@ -75,14 +98,398 @@ const QString ENDs = "/>\n";
 ///
 /// ///
 
+// The readers are called on the start element of what they read, and
+// return after its end element or with the reader in error (see
+// readError).
+
+// the text of an element holding a number
+static double readNumber(QXmlStreamReader& xml)
+{
+    QString name = xml.name().toString();
+    bool ok = false;
+    double value = xml.readElementText().toDouble(&ok);
+    if (!ok && !xml.hasError())
+        xml.raiseError("Invalid number in the element " + name);
+    return value;
+}
+
+// the key and value of a meta element
+static void readPair(QXmlStreamReader& xml, std::string& key, std::string& value)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+    key = attributes.value(KEY).toString().toStdString();
+    value = attributes.value(VALUE).toString().toStdString();
+    xml.skipCurrentElement();
+}
+
+// a data element, typed by its type attribute. The older ones without
+// it are imported (values parsed) or added as strings.
+static void readData(QXmlStreamReader& xml, DataModel::TestBase& tb, bool import)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+    std::string key = attributes.value(KEY).toString().toStdString();
+    std::string value = attributes.value(VALUE).toString().toStdString();
+    QString type = attributes.value(TYPE).toString();
+    xml.skipCurrentElement();
+
+    long long n;
+    double d;
+    if (type.isEmpty())
+    {
+        if (import)
+            tb.importData(key, value);
+        else
+            tb.addData(key, value);
+    }
+    else if (type == INT_DATA && boost::conversion::try_lexical_convert(value, n))
+        tb.setInt(DataModel::fieldKey(key), n);
+    else if (type == DOUBLE_DATA && boost::conversion::try_lexical_convert(value, d))
+        tb.setDouble(DataModel::fieldKey(key), d);
+    else if (type == BOOL_DATA && (value == "1" || value == "0"))
+        tb.setBool(DataModel::fieldKey(key), value == "1");
+    else if (type == STRING_DATA)
+        tb.setString(DataModel::fieldKey(key), value);
+    else if (type == IDENTIFIER_DATA)
+        tb.setIdentifier(DataModel::fieldKey(key), value);
+    else if (type == UNTYPED_DATA)
+        tb.addUntypedData(key, value);
+    else if (!xml.hasError())
+        xml.raiseError("Invalid " + type + " data " + QString::fromStdString(key));
+}
+
+// reads the content of a TestItem element
+static void readTestItem(QXmlStreamReader& xml, DataModel::TestItem& titem)
+{
+    std::string key, value;
+    while (xml.readNextStartElement())
+    {
+        //TestItem - type
+        if ( xml.name() == TI_TYPE )
+            titem.type(readNumber(xml));
+        //TestItem - subtype
+        else if ( xml.name() == TI_SUBTYPE )
+            titem.subtype(readNumber(xml));
+        //TestItem - timestamp
+        else if ( xml.name() == TI_TIMESTAMP )
+            titem.timestamp(readNumber(xml));
+        //TestItem - data
+        else if ( xml.name() == DATA_VALUE )
+        {
+            readData(xml, titem, true);
+        }
+        //TestItem - meta
+        else if ( xml.name() == META_VALUE )
+        {
+            readPair(xml, key, value);
+            titem.addMetadata(key, value);
+        }
+        else
+            xml.skipCurrentElement();
+    }
+}
+
+// reads the content of a TestCase element
+static void readTestCase(QXmlStreamReader& xml, DataModel::TestCase* tcase)
+{
+    std::string key, value;
+    while (xml.readNextStartElement())
+    {
+        //TestCase - name
+        if ( xml.name() == TSC_NAME )
+            tcase->name(xml.readElementText().toStdString());
+        //TestCase - data
+        else if ( xml.name() == DATA_VALUE )
+        {
+            readData(xml, *tcase, false);
+        }
+        //TestCase - meta
+        else if ( xml.name() == META_VALUE )
+        {
+            readPair(xml, key, value);
+            tcase->addMetadata(key, value);
+        }
+        //TestItem content, moved to the testCase
+        else if ( xml.name() == TESTITEM )
+        {
+            DataModel::TestItem titem;
+            readTestItem(xml, titem);
+            tcase->takeTestItem(titem);
+        }
+        else
+            xml.skipCurrentElement();
+    }
+}
+
+// reads the content of the TestSuite element
+static void readTestSuite(QXmlStreamReader& xml, DataModel::TestSuite* tsuite)
+{
+    std::string key, value;
+    while (xml.readNextStartElement())
+    {
+        //TestSuite - name
+        if ( xml.name() == TSC_NAME )
+            tsuite->name(xml.readElementText().toStdString());
+        //TestSuite - appId
+        else if ( xml.name() == TS_ID )
+            tsuite->appId(xml.readElementText().toStdString());
+        //TestSuite - data
+        else if ( xml.name() == DATA_VALUE )
+        {
+            readData(xml, *tsuite, false);
+        }
+        //TestSuite - metadata
+        else if ( xml.name() == META_VALUE )
+        {
+            readPair(xml, key, value);
+            tsuite->addMetadata(key, value);
+        }
+        //TestCase content
+        else if ( xml.name() == TESTCASE )
+        {
+            DataModel::TestCase* tcase = new DataModel::TestCase();
+            readTestCase(xml, tcase);
+
+            //adding the test case to the test suite
+            tsuite->addTestCase(tcase);
+        }
+        else
+            xml.skipCurrentElement();
+    }
+}
+
+// moves the reader into the root element, which must have this tag
+static bool readRoot(QXmlStreamReader& xml, const QString& tag)
+{
+    if (xml.readNextStartElement() && xml.name() == tag)
+        return true;
+    if (!xml.hasError())
+        xml.raiseError("The document is not a " + tag);
+    return false;
+}
+
+// the reader error, with its position
+static std::string readError(const QXmlStreamReader& xml)
+{
+    return "line " + QString::number(xml.lineNumber()).toStdString() +
+            ", column " + QString::number(xml.columnNumber()).toStdString() +
+            ": " + xml.errorString().toStdString();
+}
+
+/// ///
+///
+/// lazy TestSuite
+///
+/// ///
+
+///
+/// The test cases are found in the raw bytes of the file, without
+/// parsing their items: the index keeps where each TestCase element
+/// is, and the loader parses it alone when the case is loaded. The
+/// loader keeps the file open, so it still reads the same file when
+/// a new one is renamed over it (see _writeFile). Its size and
+/// modification time are checked before reading, so a file changed
+/// in place by another program is not read at the old places. The
+/// reads do not move the file position, so several threads may read
+/// cases at once.
+///
+class XMLCaseLoader : public DataModel::CaseLoader
+{
+public:
+    XMLCaseLoader(const std::string& filename)
+        : file_(filename.c_str()), size_(-1), modified_(0)
+    {
+        struct stat st;
+        if (file_.open(QIODevice::ReadOnly) && ::fstat(file_.handle(), &st) == 0)
+        {
+            size_ = st.st_size;
+            modified_ = st.st_mtime;
+        }
+    }
+
+    virtual bool load(DataModel::TestCase& tc)
+    {
+        QByteArray bytes;
+        if (!read(tc, bytes))
+            return false;
+
+        QXmlStreamReader xml(bytes);
+        if (readRoot(xml, TESTCASE))
+            readTestCase(xml, &tc);
+        if (xml.hasError())
+        {
+            DEBUG(D_ERROR, "(XMLCaseLoader::load) Malformed TestCase " << tc.name()
+                  << " at offset " << tc.index().offset << ", " << readError(xml));
+            return false;
+        }
+        return true;
+    }
+
+    // the TestCase element, as it is in the file
+    bool read(const DataModel::TestCase& tc, QByteArray& bytes) const
+    {
+        struct stat st;
+        if (!file_.isOpen() || ::fstat(file_.handle(), &st) != 0 ||
+            st.st_size != size_ || st.st_mtime != modified_)
+        {
+            DEBUG(D_ERROR, "(XMLCaseLoader::read) The file " << file_.fileName().toStdString()
+                  << " has changed, TestCase " << tc.name() << " not read.");
+            return false;
+        }
+        bytes.resize(tc.index().length);
+        ssize_t n = ::pread(file_.handle(), bytes.data(), bytes.size(), tc.index().offset);
+        return n == bytes.size();
+    }
+
+private:
+    QFile file_;
+    qint64 size_;
+    time_t modified_;
+};
+
+// position of the next element with this tag, or -1
+static int findElement(const QByteArray& xml, const QString& tag, int from)
+{
+    QByteArray open = (BEGo + tag).toUtf8();
+    int pos;
+    while ((pos = xml.indexOf(open, from)) >= 0)
+    {
+        int next = pos + open.size();
+        if (next < xml.size() &&
+            (xml[next] == '>' || xml[next] == '/' || isspace(static_cast<unsigned char>(xml[next]))))
+            return pos;
+        from = next;
+    }
+    return -1;
+}
+
+// position after the end of the element starting at start, or -1
+static int elementEnd(const QByteArray& xml, const QString& tag, int start)
+{
+    int gt = xml.indexOf('>', start);
+    if (gt < 0)
+        return -1;
+    //empty element
+    if (xml[gt - 1] == '/')
+        return gt + 1;
+
+    int close = xml.indexOf((BEGc + tag).toUtf8(), gt);
+    if (close < 0)
+        return -1;
+    gt = xml.indexOf('>', close);
+    return gt < 0 ? -1 : gt + 1;
+}
+
+// the name of the TestCase element, before its items
+static QString caseName(const QByteArray& xml)
+{
+    int start = findElement(xml, TSC_NAME, 0);
+    int items = findElement(xml, TESTITEM, 0);
+    if (start < 0 || (items >= 0 && items < start))
+        return QString();
+
+    int end = elementEnd(xml, TSC_NAME, start);
+    if (end < 0)
+        return QString();
+    QXmlStreamReader name(xml.mid(start, end - start));
+    return readRoot(name, TSC_NAME) ? name.readElementText() : QString();
+}
+
+static size_t countElements(const QByteArray& xml, const QString& tag)
+{
+    size_t count = 0;
+    for (int pos = findElement(xml, tag, 0); pos >= 0; pos = findElement(xml, tag, pos + 1))
+        count++;
+    return count;
+}
+
+typedef std::pair<QString, DataModel::TestCase::Index> CaseEntry;
+
+// indexes the test cases of the open file and reads the rest of the
+// suite. The content of the file stays mapped while it is open.
+static DataModel::TestSuite* readIndexedSuite(QFile& file, const std::string& caller,
+                                              QByteArray& xml, std::vector<CaseEntry>& cases)
+    throw (DataModelAdapter::conversion_error_exception)
+{
+    const char* data = reinterpret_cast<const char*>(file.map(0, file.size()));
+    if (data)
+        xml = QByteArray::fromRawData(data, file.size());
+    else
+        xml = file.readAll();
+
+    ///1. index the test cases, and copy the rest of the suite
+    QByteArray skeleton;
+    int pos = 0;
+    int start;
+    while ((start = findElement(xml, TESTCASE, pos)) >= 0)
+    {
+        int end = elementEnd(xml, TESTCASE, start);
+        if (end < 0)
+        {
+            std::cout << caller << " ERROR unterminated TestCase in file "
+                      << file.fileName().toStdString() << "." << std::endl;
+            throw DataModelAdapter::conversion_error_exception();
+        }
+        skeleton.append(xml.constData() + pos, start - pos);
+
+        QByteArray content = QByteArray::fromRawData(xml.constData() + start, end - start);
+        DataModel::TestCase::Index index;
+        index.offset = start;
+        index.length = end - start;
+        index.items = countElements(content, TESTITEM);
+        cases.push_back(CaseEntry(caseName(content), index));
+
+        pos = end;
+    }
+    skeleton.append(xml.constData() + pos, xml.size() - pos);
+
+    ///2. read the TestSuite without its cases
+    std::auto_ptr<DataModel::TestSuite> tsuite(new DataModel::TestSuite());
+    QXmlStreamReader reader(skeleton);
+    if (readRoot(reader, TESTSUITE))
+        readTestSuite(reader, tsuite.get());
+    if ( reader.hasError() )
+    {
+        std::cout << caller << " ERROR in the file " << file.fileName().toStdString()
+                  << " without its test cases, " << readError(reader) << std::endl;
+        throw DataModelAdapter::conversion_error_exception();
+    }
+    return tsuite.release();
+}
+
+// the reader error of a case, with its position in the file
+static std::string caseError(const QByteArray& xml, const DataModel::TestCase::Index& index,
+                             const QXmlStreamReader& reader)
+{
+    const char* begin = xml.constData();
+    qint64 line = std::count(begin, begin + index.offset, '\n') + reader.lineNumber();
+    qint64 column = reader.columnNumber();
+    if (reader.lineNumber() == 1)
+        column += index.offset - (index.offset ? xml.lastIndexOf('\n', index.offset - 1) + 1 : 0);
+    return "line " + QString::number(line).toStdString() +
+            ", column " + QString::number(column).toStdString() +
+            ": " + reader.errorString().toStdString();
+}
+
+// reads the case i of the file (run by the CaseWorkers)
+static bool readCaseTask(const QByteArray* xml, const std::vector<CaseEntry>* cases,
+                         const std::vector<DataModel::TestCase*>* tcases, size_t i)
+{
+    const DataModel::TestCase::Index& index = (*cases)[i].second;
+    QXmlStreamReader reader(QByteArray::fromRawData(xml->constData() + index.offset, index.length));
+    if (readRoot(reader, TESTCASE))
+        readTestCase(reader, (*tcases)[i]);
+    if (!reader.hasError())
+        return true;
+
+    std::cout << "(XMLDataModelAdapter::file2testSuite) ERROR in the TestCase "
+              << (*cases)[i].first.toStdString() << ", " << caseError(*xml, index, reader) << std::endl;
+    return false;
+}
+
 DataModel::TestSuite*
         XMLDataModelAdapter::file2testSuite(const std::string& filename)
         throw (DataModelAdapter::conversion_error_exception)
 {
-    DataModel::TestSuite* tsuite = new DataModel::TestSuite();
-
-    ///1. create a DOM document from a file
-    QDomDocument doc ( "mydocument" );
     QFile file (filename.c_str());
     //if the file can not be opened...
     if ( !file.open( QIODevice::ReadOnly ) )
@@ -90,143 +497,65 @@ DataModel::TestSuite*
         std::cout << "(XMLDataModelAdapter::file2testSuite) ERROR while opening the file " << filename << "." << std::endl;
         throw DataModelAdapter::conversion_error_exception();
     }
-    //if the content can not be set...
-    if ( !doc.setContent ( &file ) )
+
+    ///1. the suite and the index of its test cases
+    QByteArray xml;
+    std::vector<CaseEntry> cases;
+    std::auto_ptr<DataModel::TestSuite> tsuite(
+                readIndexedSuite(file, "(XMLDataModelAdapter::file2testSuite)", xml, cases));
+
+    ///2. the test cases are added in file order, then parsed in parallel
+    std::vector<DataModel::TestCase*> tcases;
+    for (size_t i = 0; i < cases.size(); i++)
     {
-        file.close();
-        std::cout << "(XMLDataModelAdapter::file2testSuite) ERROR while setting the content from file " << filename << "." << std::endl;
-        throw DataModelAdapter::conversion_error_exception();
+        DataModel::TestCase* tcase = new DataModel::TestCase();
+        tcase->name(cases[i].first.toStdString());
+        tsuite->addTestCase(tcase);
+        tcases.push_back(tcase);
     }
+
+    CaseWorkers workers(cases.size(), threads(),
+                        boost::bind(&XMLDataModelAdapter::reportProgress, this, _1, _2));
+    if (!workers.run(0, cases.size(), boost::bind(&readCaseTask, &xml, &cases, &tcases, _1)))
+        throw DataModelAdapter::conversion_error_exception();
     file.close();
 
-    ///2. Create a TestSuite
-    QDomElement docElem = doc.documentElement();
+    return tsuite.release();
+}
 
-    //TestSuite content
-    for ( QDomNode n1 = docElem.firstChild(); !n1.isNull(); n1 = n1.nextSibling() )
+DataModel::TestSuite*
+        XMLDataModelAdapter::file2lazyTestSuite(const std::string& filename)
+        throw (DataModelAdapter::conversion_error_exception)
+{
+    QFile file (filename.c_str());
+    //if the file can not be opened...
+    if ( !file.open( QIODevice::ReadOnly ) )
     {
-        QDomElement e1 = n1.toElement();
-        if ( !e1.isNull() )
-        {
-            //TestSuite - name
-            if ( e1.tagName() == TSC_NAME )
-            {
-                tsuite->name(e1.text().toStdString());
-            }
-            //TestSuite - appId
-            else if ( e1.tagName() == TS_ID )
-            {
-                tsuite->appId(e1.text().toStdString());
-            }
-            //TestSuite - data
-            else if ( e1.tagName() == DATA_VALUE )
-            {
-                QString key = e1.attribute ( KEY );
-                QString value = e1.attribute ( VALUE );
-                tsuite->addData(key.toStdString(), value.toStdString());
-            }
-            //TestSuite - metadata
-            else if ( e1.tagName() == META_VALUE )
-            {
-                QString key = e1.attribute ( KEY );
-                QString value = e1.attribute ( VALUE );
-                tsuite->addMetadata(key.toStdString(), value.toStdString());
-            }
-            //TestCase content
-            else if ( e1.tagName() == TESTCASE )
-            {
-                DataModel::TestCase* tcase = new DataModel::TestCase();
-
-                for ( QDomNode n2 = n1.firstChild(); !n2.isNull(); n2 = n2.nextSibling() )
-                {
-                    QDomElement e2 = n2.toElement();
-                    if ( !e2.isNull() )
-                    {
-                        //TestCase - name
-                        if ( e2.tagName() == TSC_NAME )
-                        {
-                            tcase->name(e2.text().toStdString());
-                        }
-                        //TestCase - data
-                        else if ( e2.tagName() == DATA_VALUE )
-                        {
-                            QString key = e2.attribute ( KEY );
-                            QString value = e2.attribute ( VALUE );
-                            tcase->addData(key.toStdString(), value.toStdString());
-                        }
-                        //TestCase - meta
-                        else if ( e2.tagName() == META_VALUE )
-                        {
-                            QString key = e2.attribute ( KEY );
-                            QString value = e2.attribute ( VALUE );
-                            tcase->addMetadata(key.toStdString(), value.toStdString());
-                        }
-                        //TestItem content
-                        else if ( e2.tagName() == TESTITEM )
-                        {
-                            DataModel::TestItem* titem = new DataModel::TestItem();
-
-                            for ( QDomNode n3 = n2.firstChild(); !n3.isNull(); n3 = n3.nextSibling() )
-                            {
-                                QDomElement e3 = n3.toElement();
-                                if ( !e3.isNull() )
-                                {
-                                    //TestItem - type
-                                    if ( e3.tagName() == TI_TYPE )
-                                    {
-                                        QString value = e3.text();
-                                        bool ok = false;
-                                        titem->type(value.toInt(&ok));
-                                        assert(ok);
-                                    }
-                                    //TestItem - subtype
-                                    else if ( e3.tagName() == TI_SUBTYPE )
-                                    {
-                                        QString value = e3.text();
-                                        bool ok = false;
-                                        titem->subtype(value.toInt(&ok));
-                                        assert(ok);
-                                    }
-                                    //TestItem - timestamp
-                                    else if ( e3.tagName() == TI_TIMESTAMP )
-                                    {
-                                        QString value = e3.text();
-                                        bool ok = false;
-                                        titem->timestamp(value.toDouble(&ok));
-                                        assert(ok);
-                                    }
-                                    //TestItem - data
-                                    else if ( e3.tagName() == DATA_VALUE )
-                                    {
-                                        QString key = e3.attribute ( KEY );
-                                        QString value = e3.attribute ( VALUE );
-                                        titem->addData(key.toStdString(), value.toStdString());
-                                    }
-                                    //TestItem - meta
-                                    else if ( e3.tagName() == META_VALUE )
-                                    {
-                                        QString key = e3.attribute ( KEY );
-                                        QString value = e3.attribute ( VALUE );
-                                        titem->addMetadata(key.toStdString(), value.toStdString());
-                                    }
-                                }
-                            }
-
-                            //adding testItem to the testCase
-                            tcase->addTestItem(titem);
-
-                        }//end testItem content
-                    }
-                }
-
-                //adding the test case to the test suite
-                tsuite->addTestCase(tcase);
-            }//end testCase content
-        }
-    }//end TestSuite content
+        std::cout << "(XMLDataModelAdapter::file2lazyTestSuite) ERROR while opening the file " << filename << "." << std::endl;
+        throw DataModelAdapter::conversion_error_exception();
+    }
 
-    //return
-    return tsuite;
+    ///1. the suite and the index of its test cases, only the index is kept
+    QByteArray xml;
+    std::vector<CaseEntry> cases;
+    std::auto_ptr<DataModel::TestSuite> tsuite(
+                readIndexedSuite(file, "(XMLDataModelAdapter::file2lazyTestSuite)", xml, cases));
+    file.close();
+
+    ///2. Create a TestSuite with the unloaded cases
+    DataModel::CaseLoaderPtr loader(new XMLCaseLoader(filename));
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        DataModel::TestCase* tcase = new DataModel::TestCase();
+        tcase->name(cases[i].first.toStdString());
+        tcase->setLoader(loader, cases[i].second);
+        tcase->unload();
+        tsuite->addTestCase(tcase);
+    }
+
+    DEBUG(D_BOTH, "(XMLDataModelAdapter::file2lazyTestSuite) Indexed " << cases.size()
+          << " test cases in " << filename << ".");
+    return tsuite.release();
 }
 
 /// ///
@@ -238,16 +567,55 @@ void XMLDataModelAdapter::testSuite2file(const DataModel::TestSuite& ts,
                                          const std::string& filename)
 throw (DataModelAdapter::conversion_error_exception)
 {
-    //geting the content of the file
-    QString content = pre_TestSuite(ts) + visit_TestSuite(ts) + post_TestSuite(ts);
+    _writeFile(ts, filename, 0);
+}
+
+void XMLDataModelAdapter::lazyTestSuite2file(DataModel::TestSuite& ts,
+                                             const std::string& filename)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    std::vector<DataModel::TestCase::Index> index;
+    _writeFile(ts, filename, &index);
+
+    //the cases are read from the new file from now on
+    DataModel::CaseLoaderPtr loader(new XMLCaseLoader(filename));
+    const DataModel::TestSuite::TestCaseList& tcl = ts.testCases();
+    DataModel::TestSuite::TestCaseList::const_iterator it;
+    size_t i = 0;
+    for (it = tcl.begin(); it != tcl.end(); ++it, ++i)
+        ts.getTestCase(it->name())->setLoader(loader, index[i]);
+}
 
-    //creating the file
-    QFile file(filename.c_str());
-    if (!file.open(QIODevice::Text | QIODevice::WriteOnly))
+void XMLDataModelAdapter::_writeFile(const DataModel::TestSuite& ts,
+                                     const std::string& filename,
+                                     std::vector<DataModel::TestCase::Index>* index)
+throw (DataModelAdapter::conversion_error_exception)
+{
+    //the suite is written to a new file renamed over the old one, so
+    //a failed write does not leave a truncated suite
+    std::string tmp = filename + ".tmp";
+    QFile file(tmp.c_str());
+    if (!file.open(QIODevice::WriteOnly))
         throw DataModelAdapter::conversion_error_exception();
 
-    file.write(content.toStdString().c_str(), qstrlen(content.toStdString().c_str()));
+    QXmlStreamWriter xml(&file);
+    bool ok = false;
+    try
+    {
+        visit_TestSuite(xml, ts, index);
+        ok = !xml.hasError() && file.flush() && ::fsync(file.handle()) == 0;
+    }
+    catch (DataModelAdapter::conversion_error_exception&)
+    {
+    }
     file.close();
+
+    if (!ok || std::rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        std::cout << "(XMLDataModelAdapter::_writeFile) ERROR while writing the file " << filename << "." << std::endl;
+        std::remove(tmp.c_str());
+        throw DataModelAdapter::conversion_error_exception();
+    }
 }
 
 
@@ -257,159 +625,233 @@ throw (DataModelAdapter::conversion_error_exception)
 ///
 /// ///
 
-///
-/// TestBase
-///
+// the elements are written one per line
+static void newLine(QXmlStreamWriter& xml)
+{
+    xml.writeCharacters("\n");
+}
 
-QString XMLDataModelAdapter::_visit_TestBase (const DataModel::TestBase& tc)
+// position after the content written, once the pending start tag is closed
+static qint64 writerPos(QXmlStreamWriter& xml)
 {
-    QString xml;
+    xml.writeCharacters(QString());
+    return xml.device()->pos();
+}
 
-    ///
-    /// maps
-    ///
+// the type attribute of a typed field
+static QString dataType(const DataModel::FieldValue& value)
+{
+    switch (value.type())
+    {
+    case DataModel::FieldValue::INT: return INT_DATA;
+    case DataModel::FieldValue::DOUBLE: return DOUBLE_DATA;
+    case DataModel::FieldValue::BOOL: return BOOL_DATA;
+    default: return value.interned() ? IDENTIFIER_DATA : STRING_DATA;
+    }
+}
 
+static void writeMap(QXmlStreamWriter& xml, const QString& tag,
+                     const DataModel::KeyValueMap& map)
+{
     DataModel::KeyValueMap::const_iterator it;
-    const DataModel::KeyValueMap& kv1 = tc.dataMap();
-
-    //data
-    for(it= kv1.begin(); it != kv1.end(); ++it)
+    for (it = map.begin(); it != map.end(); ++it)
     {
-        xml += BEGo + DATA_VALUE + " " +
-               KEY + "=\"" + QString(it->first.c_str()) + "\"" + " " +
-               VALUE + "=\"" + QString(it->second.c_str()) + "\"" +
-               ENDs;
+        xml.writeEmptyElement(tag);
+        xml.writeAttribute(KEY, QString::fromStdString(it->first));
+        xml.writeAttribute(VALUE, QString::fromStdString(it->second));
+        newLine(xml);
     }
+}
 
-    const DataModel::KeyValueMap& kv2 = tc.metadataMap();
+///
+/// TestBase
+///
 
-    //meta
-    for(it= kv2.begin(); it != kv2.end(); ++it)
+void XMLDataModelAdapter::_visit_TestBase (QXmlStreamWriter& xml, const DataModel::TestBase& tb)
+{
+    //data, with the typed fields as strings (not kept in the item)
+    //and their types, in key order
+    DataModel::KeyValueMap data;
+    tb.copyDataMap(data);
+    std::map<std::string, const DataModel::FieldValue*> fields;
+    const DataModel::FieldList& fl = tb.fields();
+    for (DataModel::FieldList::const_iterator it = fl.begin(); it != fl.end(); ++it)
+        fields[*it->key] = &it->value;
+
+    DataModel::KeyValueMap::const_iterator it;
+    for (it = data.begin(); it != data.end(); ++it)
     {
-        xml += BEGo + META_VALUE + " " +
-               KEY + "=\"" + QString(it->first.c_str()) + "\"" +
-               VALUE + "=\"" + QString(it->second.c_str()) + "\"" +
-               ENDs;
+        std::map<std::string, const DataModel::FieldValue*>::const_iterator f =
+                fields.find(it->first);
+        xml.writeEmptyElement(DATA_VALUE);
+        xml.writeAttribute(KEY, QString::fromStdString(it->first));
+        xml.writeAttribute(VALUE, QString::fromStdString(it->second));
+        xml.writeAttribute(TYPE, f != fields.end() ? dataType(*f->second) : UNTYPED_DATA);
+        newLine(xml);
     }
 
-    return xml;
+    //meta
+    writeMap(xml, META_VALUE, tb.metadataMap());
 }
 
 ///
 /// TestSuite
 ///
-QString XMLDataModelAdapter::pre_TestSuite(const DataModel::TestSuite&)
-{
-    return BEGo + TESTSUITE + ENDc;
-}
 
-QString XMLDataModelAdapter::visit_TestSuite(const DataModel::TestSuite& ts)
+void XMLDataModelAdapter::visit_TestSuite(QXmlStreamWriter& xml, const DataModel::TestSuite& ts,
+                                          std::vector<DataModel::TestCase::Index>* index)
+throw (DataModelAdapter::conversion_error_exception)
 {
-    QString xml;
-
-    //name
-    xml += BEGo + TSC_NAME + ENDo +
-           ts.name().c_str() +
-           BEGc + TSC_NAME + ENDc;
-
-    //binary path
-    xml += BEGo + TS_ID + ENDo +
-           ts.appId().c_str() +
-           BEGc + TS_ID + ENDc;
+    xml.writeStartDocument();
+    newLine(xml);
+    xml.writeStartElement(TESTSUITE);
+    newLine(xml);
 
-    //maps
-    xml += _visit_TestBase (ts);
+    _visit_TestSuiteHeader(xml, ts);
 
-    // children
+    // children, written to buffers in parallel by batches and copied
+    // in order
+    std::vector<const DataModel::TestCase*> cases;
     const DataModel::TestSuite::TestCaseList& tcl = ts.testCases();
-    DataModel::TestSuite::TestCaseList::const_iterator it2;
-    for(it2= tcl.begin(); it2 != tcl.end(); ++it2)
+    DataModel::TestSuite::TestCaseList::const_iterator it;
+    for (it = tcl.begin(); it != tcl.end(); ++it)
+        cases.push_back(&*it);
+
+    CaseWorkers workers(cases.size(), threads(),
+                        boost::bind(&XMLDataModelAdapter::reportProgress, this, _1, _2));
+    for (size_t begin = 0; begin < cases.size(); begin += workers.batch())
     {
-        xml += pre_TestCase(*it2) + visit_TestCase(*it2) + post_TestCase(*it2);
+        size_t end = std::min(begin + workers.batch(), cases.size());
+        std::vector<QByteArray> elements(end - begin);
+        if (!workers.run(begin, end, boost::bind(&XMLDataModelAdapter::_writeTestCase, this,
+                                                 &cases, begin, &elements, _1)))
+            throw DataModelAdapter::conversion_error_exception();
+
+        for (size_t i = begin; i < end; i++)
+        {
+            DataModel::TestCase::Index ci;
+            ci.offset = writerPos(xml);
+            xml.device()->write(elements[i - begin]);
+            //the element, without the line break
+            ci.length = writerPos(xml) - ci.offset;
+            ci.items = cases[i]->count();
+            if (index)
+                index->push_back(ci);
+            newLine(xml);
+        }
     }
 
-    //return
-    return xml;
+    xml.writeEndElement();
+    newLine(xml);
+    xml.writeEndDocument();
 }
 
-QString XMLDataModelAdapter::post_TestSuite(const DataModel::TestSuite&)
+void XMLDataModelAdapter::_visit_TestSuiteHeader(QXmlStreamWriter& xml, const DataModel::TestSuite& ts)
 {
-    return BEGc + TESTSUITE + ENDc;
+    //name
+    xml.writeTextElement(TSC_NAME, QString::fromStdString(ts.name()));
+    newLine(xml);
+
+    //binary path
+    xml.writeTextElement(TS_ID, QString::fromStdString(ts.appId()));
+    newLine(xml);
+
+    //maps
+    _visit_TestBase (xml, ts);
 }
 
 ///
 /// TestCase
 ///
-QString XMLDataModelAdapter::pre_TestCase(const DataModel::TestCase&)
-{
-    return BEGo + TESTCASE + ENDc;
-}
 
-QString XMLDataModelAdapter::visit_TestCase(const DataModel::TestCase& tc)
+void XMLDataModelAdapter::visit_TestCase(QXmlStreamWriter& xml, const DataModel::TestCase& tc)
+throw (DataModelAdapter::conversion_error_exception)
 {
-    QString xml;
+    //the unloaded cases are copied from their file, or loaded from
+    //other formats into a copy
+    if (!tc.loaded())
+    {
+        XMLCaseLoader* loader = dynamic_cast<XMLCaseLoader*>(tc.loader().get());
+        if (!loader)
+        {
+            DataModel::TestCase copy;
+            copy.name(tc.name());
+            copy.setLoader(tc.loader(), tc.index());
+            copy.unload();
+            if (!copy.load())
+            {
+                std::cout << "(XMLDataModelAdapter::visit_TestCase) ERROR while loading the TestCase " << tc.name() << "." << std::endl;
+                throw DataModelAdapter::conversion_error_exception();
+            }
+            visit_TestCase(xml, copy);
+            return;
+        }
+
+        QByteArray bytes;
+        if (!loader->read(tc, bytes))
+        {
+            std::cout << "(XMLDataModelAdapter::visit_TestCase) ERROR while reading the TestCase " << tc.name() << "." << std::endl;
+            throw DataModelAdapter::conversion_error_exception();
+        }
+        writerPos(xml);
+        xml.device()->write(bytes);
+        return;
+    }
+
+    xml.writeStartElement(TESTCASE);
+    newLine(xml);
 
     //name
-    xml += BEGo + TSC_NAME + ENDo +
-           tc.name().c_str() +
-           BEGc + TSC_NAME + ENDc;
+    xml.writeTextElement(TSC_NAME, QString::fromStdString(tc.name()));
+    newLine(xml);
 
     // maps
-    xml += _visit_TestBase (tc);
+    _visit_TestBase (xml, tc);
 
     // children
     const DataModel::TestCase::TestItemList& il = tc.testItemList();
-    DataModel::TestCase::TestItemList::const_iterator it2;
-    for(it2= il.begin(); it2 != il.end(); ++it2)
-    {
-        xml += pre_TestItem(*it2) + visit_TestItem(*it2) + post_TestItem(*it2);
-    }
+    DataModel::TestCase::TestItemList::const_iterator it;
+    for (it = il.begin(); it != il.end(); ++it)
+        visit_TestItem(xml, *it);
 
-    //return
-    return xml;
+    xml.writeEndElement();
 }
 
-QString XMLDataModelAdapter::post_TestCase(const DataModel::TestCase&)
+bool XMLDataModelAdapter::_writeTestCase(const std::vector<const DataModel::TestCase*>* cases,
+                                         size_t begin, std::vector<QByteArray>* elements,
+                                         size_t i)
 {
-    return BEGc + TESTCASE + ENDc;
+    QBuffer buffer(&(*elements)[i - begin]);
+    buffer.open(QIODevice::WriteOnly);
+    QXmlStreamWriter xml(&buffer);
+    visit_TestCase(xml, *(*cases)[i]);
+    writerPos(xml);
+    return !xml.hasError();
 }
 
 ///
 /// TestItem
 ///
-QString XMLDataModelAdapter::pre_TestItem(const DataModel::TestItem&)
-{
-    return BEGo + TESTITEM + ENDc;
-}
 
-QString XMLDataModelAdapter::visit_TestItem(const DataModel::TestItem& ti)
+void XMLDataModelAdapter::visit_TestItem(QXmlStreamWriter& xml, const DataModel::TestItem& ti)
 {
-    QString xml;
+    xml.writeStartElement(TESTITEM);
+    newLine(xml);
 
     //type
-    xml += BEGo + TI_TYPE + ENDo +
-           QString::number(ti.type()) +
-           BEGc + TI_TYPE + ENDc;
+    xml.writeTextElement(TI_TYPE, QString::number(ti.type()));
+    newLine(xml);
 
     //subtype
-    xml += BEGo + TI_SUBTYPE + ENDo +
-           QString::number(ti.subtype()) +
-           BEGc + TI_SUBTYPE + ENDc;
+    xml.writeTextElement(TI_SUBTYPE, QString::number(ti.subtype()));
+    newLine(xml);
 
     //timestamp
-    xml += BEGo + TI_TIMESTAMP + ENDo +
-           QString::number(ti.timestamp()) +
-           BEGc + TI_TIMESTAMP + ENDc;
-
-
-    xml += _visit_TestBase (ti);
+    xml.writeTextElement(TI_TIMESTAMP, QString::number(ti.timestamp()));
+    newLine(xml);
 
-    //return
-    return xml;
-}
+    _visit_TestBase (xml, ti);
 
-QString XMLDataModelAdapter::post_TestItem(const DataModel::TestItem&)
-{
-    return BEGc + TESTITEM + ENDc;
+    xml.writeEndElement();
+    newLine(xml);
 }
-
@@ -24,7 +24,11 @@
 #define XMLDATAMODELADAPTER_H
 
 #include <datamodeladapter.h>
+#include <QByteArray>
+#include <QIODevice>
 #include <QString>
+#include <QXmlStreamWriter>
+#include <vector>
 
 class XMLDataModelAdapter : public DataModelAdapter
 {
@@ -32,6 +36,7 @@ public:
     XMLDataModelAdapter();
 
     virtual std::string id();
+    virtual std::string extension();
 
     virtual DataModel::TestSuite* file2testSuite(const std::string& filename)
     throw (conversion_error_exception);
@@ -39,23 +44,38 @@ public:
     virtual void testSuite2file(const DataModel::TestSuite&,
                                 const std::string& filename) throw (conversion_error_exception);
 
-    // XML Visitors
-    QString pre_TestSuite(const DataModel::TestSuite&);
-    QString visit_TestSuite(const DataModel::TestSuite&);
-    QString post_TestSuite(const DataModel::TestSuite&);
-
-    QString pre_TestCase(const DataModel::TestCase&);
-    QString visit_TestCase(const DataModel::TestCase&);
-    QString post_TestCase(const DataModel::TestCase&);
-
-    QString pre_TestItem(const DataModel::TestItem&);
-    QString visit_TestItem(const DataModel::TestItem&);
-    QString post_TestItem(const DataModel::TestItem&);
+    // the test cases are indexed by their position in the file
+    virtual DataModel::TestSuite* file2lazyTestSuite(const std::string& filename)
+    throw (conversion_error_exception);
 
+    virtual void lazyTestSuite2file(DataModel::TestSuite&,
+                                    const std::string& filename) throw (conversion_error_exception);
 
+    // XML Visitors: they write the elements as they visit them. The
+    // writer must be on the device the unloaded test cases are
+    // copied to, and the index gets where each test case is in it.
+    // The test cases of a suite are visited in parallel (see
+    // DataModelAdapter::setThreads).
+    void visit_TestSuite(QXmlStreamWriter&, const DataModel::TestSuite&,
+                         std::vector<DataModel::TestCase::Index>* index)
+    throw (conversion_error_exception);
+    void visit_TestCase(QXmlStreamWriter&, const DataModel::TestCase&)
+    throw (conversion_error_exception);
+    void visit_TestItem(QXmlStreamWriter&, const DataModel::TestItem&);
 
 protected:
-    QString _visit_TestBase (const DataModel::TestBase& tc);
+    void _visit_TestBase (QXmlStreamWriter&, const DataModel::TestBase& tc);
+    void _visit_TestSuiteHeader (QXmlStreamWriter&, const DataModel::TestSuite& ts);
+    // writes the case i of a batch starting at begin to its element
+    // (run by the CaseWorkers)
+    bool _writeTestCase(const std::vector<const DataModel::TestCase*>* cases, size_t begin,
+                        std::vector<QByteArray>* elements, size_t i);
+
+    // writes the suite to a new file renamed over the old one, and the
+    // index of each test case in it
+    void _writeFile(const DataModel::TestSuite&, const std::string& filename,
+                    std::vector<DataModel::TestCase::Index>* index)
+    throw (conversion_error_exception);
 
 };
 
@@ -19,18 +19,30 @@ equals(QT_MAJOR_VERSION, 5) {
     INCLUDEPATH += ../common/
 
     SOURCES += ../common/datamodel.cpp \
+               ../common/stringpool.cpp \
                ../common/comm.cpp \
                ../common/messageclientserver.cpp \
                ../common/utilclasses.cpp \
                ../common/uuid.cpp \
-               ../common/controlsignaling.cpp
+               ../common/controlsignaling.cpp \
+               ../common/protocol.cpp \
+               ../common/testitemcodec.cpp \
+               ../common/transport.cpp \
+               ../common/sockettransport.cpp \
+               ../common/shmtransport.cpp
 
     HEADERS += ../common/datamodel.h \
+               ../common/stringpool.h \
                ../common/comm.h \
                ../common/messageclientserver.h \
                ../common/utilclasses.h \
                ../common/uuid.h \
                ../common/controlsignaling.h \
+               ../common/protocol.h \
+               ../common/testitemcodec.h \
+               ../common/transport.h \
+               ../common/sockettransport.h \
+               ../common/shmtransport.h \
                ../common/ohtbaseconfig.h \
                ../common/debug.h
 }
@@ -52,16 +64,18 @@ equals(QT_MAJOR_VERSION, 5) {
     INCLUDEPATH += ../lib_preload/
 
     SOURCES += ../lib_preload/preloadcontroller.cpp \
+        ../lib_preload/commthread.cpp \
         ../lib_preload/eventconsumer.cpp \
         ../lib_preload/preloadingcontrol.cpp
 
     HEADERS += ../lib_preload/preloadcontroller.h \
+        ../lib_preload/commthread.h \
         ../lib_preload/LibPreload_global.h \
         ../lib_preload/eventconsumer.h \
         ../lib_preload/eventexecutor.h \
         ../lib_preload/preloadingcontrol.h
 
-    LIBS += -lboost_serialization
+    LIBS += -lboost_thread -lboost_system -lboost_serialization
 }
 
 
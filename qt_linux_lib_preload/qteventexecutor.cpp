@@ -116,7 +116,7 @@ void QtEventExecutor::handleNewTestItemReceived(DataModel::TestItem* ti)
     {
         //executeCloseEvent(dynamic_cast<QOE::QOE_WindowClose*>(ti));
         QOE::QOE_WindowClose qoe;
-        qoe.copy(ti);
+        qoe.take(ti);
         executeCloseEvent(&qoe);
     }
     //mouse events
@@ -124,28 +124,28 @@ void QtEventExecutor::handleNewTestItemReceived(DataModel::TestItem* ti)
     {
         //executeMousePressEvent(dynamic_cast<QOE::QOE_MousePress*>(ti));
         QOE::QOE_MousePress qoe;
-        qoe.copy(ti);
+        qoe.take(ti);
         executeMousePressEvent(&qoe);
     }
     else if (ti->type() == QOE::QOE_MOUSE_RELEASE)
     {
         //executeMouseReleaseEvent(dynamic_cast<QOE::QOE_MouseRelease*>(ti));
         QOE::QOE_MouseRelease qoe;
-        qoe.copy(ti);
+        qoe.take(ti);
         executeMouseReleaseEvent(&qoe);
     }
     else if (ti->type() == QOE::QOE_MOUSE_DOUBLE)
     {
         //executeMouseDoubleEvent(dynamic_cast<QOE::QOE_MouseDouble*>(ti));
         QOE::QOE_MouseDouble qoe;
-        qoe.copy(ti);
+        qoe.take(ti);
         executeMouseDoubleEvent(&qoe);
     }
     else if (ti->type() == QOE::QOE_MOUSE_WHEEL)
     {
         //executeWheelEvent(dynamic_cast<QOE::QOE_MouseWheel*>(ti));
         QOE::QOE_MouseWheel qoe;
-        qoe.copy(ti);
+        qoe.take(ti);
         executeWheelEvent(&qoe);
     }
     //keyboard events
@@ -153,7 +153,7 @@ void QtEventExecutor::handleNewTestItemReceived(DataModel::TestItem* ti)
     {
         //executeKeyPressEvent(dynamic_cast<QOE::QOE_KeyPress*>(ti));
         QOE::QOE_KeyPress qoe;
-        qoe.copy(ti);
+        qoe.take(ti);
         executeKeyPressEvent(&qoe);
     }
 }
@@ -27,7 +27,6 @@
 #include <QApplication>
 #include <QCloseEvent>
 #include <QTest>
-#include <boost/lexical_cast.hpp>
 
 #include <debug.h>
 
@@ -36,44 +35,64 @@
 
 using namespace QOE;
 
+///
+/// field keys (registered once, the accessors neither format nor parse)
+///
+static const DataModel::FieldKey Key_Widget = DataModel::fieldKey(QOE_Base_Widget);
+static const DataModel::FieldKey Key_WidgetValue = DataModel::fieldKey(QOE_Base_WidgetValue);
+static const DataModel::FieldKey Key_X = DataModel::fieldKey(QOE_Base_X);
+static const DataModel::FieldKey Key_Y = DataModel::fieldKey(QOE_Base_Y);
+static const DataModel::FieldKey Key_GlobalX = DataModel::fieldKey(QOE_Base_GlobalX);
+static const DataModel::FieldKey Key_GlobalY = DataModel::fieldKey(QOE_Base_GlobalY);
+static const DataModel::FieldKey Key_IsSensitive = DataModel::fieldKey(QOE_Base_IsSensitive);
+static const DataModel::FieldKey Key_SensitiveValue = DataModel::fieldKey(QOE_Base_SensitiveValue);
+static const DataModel::FieldKey Key_MouseButton = DataModel::fieldKey(QOE_Mouse_Button);
+static const DataModel::FieldKey Key_MouseButtons = DataModel::fieldKey(QOE_Mouse_Buttons);
+static const DataModel::FieldKey Key_MouseModifiers = DataModel::fieldKey(QOE_Mouse_Modifiers);
+static const DataModel::FieldKey Key_WheelDelta = DataModel::fieldKey(QOE_Mouse_Wheel_Delta);
+static const DataModel::FieldKey Key_WheelOrientation = DataModel::fieldKey(QOE_Mouse_Wheel_Orientation);
+static const DataModel::FieldKey Key_Key = DataModel::fieldKey(QOE_Key_Key);
+static const DataModel::FieldKey Key_KeyModifiers = DataModel::fieldKey(QOE_Key_Modifiers);
+static const DataModel::FieldKey Key_KeyText = DataModel::fieldKey(QOE_Key_Text);
+
 ///
 /// QOEvent test item base
 ///
 
 std::string QOE_Base::widget()
 {
-    return getData(QOE_Base_Widget);
+    return getString(Key_Widget);
 }
 void QOE_Base::widget(const std::string& text)
 {
-    addData(QOE_Base_Widget,text);
+    setString(Key_Widget, text);
 }
 
 std::string QOE_Base::widgetValue()
 {
-    return getData(QOE_Base_WidgetValue);
+    return getString(Key_WidgetValue);
 }
 void QOE_Base::widgetValue(const std::string& text)
 {
-    addData(QOE_Base_WidgetValue,text);
+    setString(Key_WidgetValue, text);
 }
 
 int QOE_Base::x()
 {
-    return boost::lexical_cast<int>(getData(QOE_Base_X));
+    return getInt(Key_X);
 }
 void QOE_Base::x(int n)
 {
-    addData(QOE_Base_X,boost::lexical_cast<std::string>(n));
+    setInt(Key_X, n);
 }
 
 int QOE_Base::y()
 {
-    return boost::lexical_cast<int>(getData(QOE_Base_Y));
+    return getInt(Key_Y);
 }
 void QOE_Base::y(int n)
 {
-    addData(QOE_Base_Y,boost::lexical_cast<std::string>(n));
+    setInt(Key_Y, n);
 }
 
 QPoint QOE_Base::position()
@@ -83,21 +102,21 @@ QPoint QOE_Base::position()
 
 int QOE_Base::globalX()
 {
-    return boost::lexical_cast<int>(getData(QOE_Base_GlobalX));
+    return getInt(Key_GlobalX);
 }
 void QOE_Base::globalX(int n)
 {
-    addData(QOE_Base_GlobalX,boost::lexical_cast<std::string>(n));
+    setInt(Key_GlobalX, n);
 }
 
 int QOE_Base::globalY()
 {
-    return boost::lexical_cast<int>(getData(QOE_Base_GlobalY));
+    return getInt(Key_GlobalY);
 }
 
 void QOE_Base::globalY(int n)
 {
-    addData(QOE_Base_GlobalY,boost::lexical_cast<std::string>(n));
+    setInt(Key_GlobalY, n);
 }
 
 QPoint QOE_Base::globalPosition()
@@ -107,22 +126,22 @@ QPoint QOE_Base::globalPosition()
 
 bool QOE_Base::isSensitive()
 {
-    return boost::lexical_cast<bool>(getData(QOE_Base_IsSensitive));
+    return getBool(Key_IsSensitive);
 }
 
 void QOE_Base::isSensitive(bool b)
 {
-    addData(QOE_Base_IsSensitive,boost::lexical_cast<std::string>(b));
+    setBool(Key_IsSensitive, b);
 }
 
 std::string QOE_Base::sensitiveValue()
 {
-    return getData(QOE_Base_SensitiveValue);
+    return getString(Key_SensitiveValue);
 }
 
 void QOE_Base::sensitiveValue(const std::string& text)
 {
-    addData(QOE_Base_SensitiveValue,text);
+    setString(Key_SensitiveValue, text);
 }
 
 ///
@@ -158,32 +177,32 @@ void QOE_WindowClose::execute(QWidget* w)
 //accesor
 Qt::MouseButton QOE_Mouse::button()
 {
-    return static_cast<Qt::MouseButton>(boost::lexical_cast<int>(getData(QOE_Mouse_Button)));
+    return static_cast<Qt::MouseButton>(getInt(Key_MouseButton));
 }
 
 void QOE_Mouse::button(Qt::MouseButton n)
 {
-    addData(QOE_Mouse_Button,boost::lexical_cast<std::string>(n));
+    setInt(Key_MouseButton, int(n));
 }
 
 Qt::MouseButtons QOE_Mouse::buttons()
 {
-    return static_cast<Qt::MouseButtons>(boost::lexical_cast<int>(getData(QOE_Mouse_Buttons)));
+    return static_cast<Qt::MouseButtons>(getInt(Key_MouseButtons));
 }
 
 void QOE_Mouse::buttons(Qt::MouseButtons n)
 {
-    addData(QOE_Mouse_Buttons,boost::lexical_cast<std::string>(n));
+    setInt(Key_MouseButtons, int(n));
 }
 
 Qt::KeyboardModifiers QOE_Mouse::modifiers()
 {
-    return static_cast<Qt::KeyboardModifiers>(boost::lexical_cast<int>(getData(QOE_Mouse_Modifiers)));
+    return static_cast<Qt::KeyboardModifiers>(getInt(Key_MouseModifiers));
 }
 
 void QOE_Mouse::modifiers(Qt::KeyboardModifiers n)
 {
-    addData(QOE_Mouse_Modifiers,boost::lexical_cast<std::string>(n));
+    setInt(Key_MouseModifiers, int(n));
 }
 
 ///
@@ -268,22 +287,22 @@ void QOE_MouseWheel::execute(QWidget* w)
 //accesor
 int QOE_MouseWheel::delta()
 {
-    return boost::lexical_cast<int>(getData(QOE_Mouse_Wheel_Delta));
+    return getInt(Key_WheelDelta);
 }
 
 void QOE_MouseWheel::delta(int n)
 {
-    addData(QOE_Mouse_Wheel_Delta,boost::lexical_cast<std::string>(n));
+    setInt(Key_WheelDelta, n);
 }
 
 Qt::Orientation QOE_MouseWheel::orientation()
 {
-    return static_cast<Qt::Orientation>(boost::lexical_cast<int>(getData(QOE_Mouse_Wheel_Orientation)));
+    return static_cast<Qt::Orientation>(getInt(Key_WheelOrientation));
 }
 
 void QOE_MouseWheel::orientation(Qt::Orientation n)
 {
-    addData(QOE_Mouse_Wheel_Orientation,boost::lexical_cast<std::string>(n));
+    setInt(Key_WheelOrientation, int(n));
 }
 
 ///
@@ -292,32 +311,32 @@ void QOE_MouseWheel::orientation(Qt::Orientation n)
 
 int QOE_Key::key()
 {
-    return boost::lexical_cast<int>(getData(QOE_Key_Key));
+    return getInt(Key_Key);
 }
 
 void QOE_Key::key(int n)
 {
-    addData(QOE_Key_Key,boost::lexical_cast<std::string>(n));
+    setInt(Key_Key, n);
 }
 
 QString QOE_Key::text()
 {
-    return QString(getData(QOE_Key_Text).c_str());
+    return QString(getString(Key_KeyText).c_str());
 }
 
 void QOE_Key::text(const QString& s)
 {
-    addData(QOE_Key_Text,s.toStdString());
+    setString(Key_KeyText, s.toStdString());
 }
 
 Qt::KeyboardModifiers QOE_Key::modifiers()
 {
-    return static_cast<Qt::KeyboardModifiers>(boost::lexical_cast<int>(getData(QOE_Key_Modifiers)));
+    return static_cast<Qt::KeyboardModifiers>(getInt(Key_KeyModifiers));
 }
 
 void QOE_Key::modifiers(Qt::KeyboardModifiers n)
 {
-    addData(QOE_Key_Modifiers,boost::lexical_cast<std::string>(n));
+    setInt(Key_KeyModifiers, int(n));
 }
 
 ///